@@ -1,3 +1,5 @@
+#include "pch.h"
+
 // ImGui Platform Binding for: GLFW
 // This needs to be used along with a Renderer (e.g. OpenGL3, Vulkan..)
 // (Info: GLFW is a cross-platform general purpose library for handling windows, inputs, OpenGL/Vulkan graphics context creation, etc.)
@@ -1,3 +1,5 @@
+#include "pch.h"
+
 // ImGui Renderer for: OpenGL3 / OpenGL ES2 / OpenGL ES3 (modern OpenGL with shaders / programmatic pipeline)
 // This needs to be used along with a Platform Binding (e.g. GLFW, SDL, Win32, custom..)
 // (Note: We are using GL3W as a helper library to access OpenGL functions since there is no standard header to access modern OpenGL functions easily. Alternatives are GLEW, Glad, etc..)
@@ -76,10 +78,10 @@
 // (About OpenGL function loaders: modern OpenGL doesn't have a standard header file and requires individual functions to be loaded manually. 
 //  Helper libraries are often used for this purpose! Here we are using gl3w.h, which requires a call to gl3wInit(). 
 //  You may use another any other loader/header of your choice, such as glew, glext, glad, glLoadGen, etc.)
-#include <GL/gl3w.h>
+//#include <GL/gl3w.h>
 //#include <glew.h>
 //#include <glext.h>
-//#include <glad/glad.h>
+#include <glad/glad.h>
 #endif
 
 // OpenGL Data
@@ -1,19 +1,36 @@
 #version 460 core
 
+// BINDLESS 0 replaces the handles in the material buffer by the textures of the surface bound to the units 0-2
+#ifndef BINDLESS
+#define BINDLESS 1
+#endif
+
+#if BINDLESS
 #extension GL_ARB_bindless_texture : require
+#endif
 
 in vec3 ex_color;
 in vec3 ex_normal;
+in vec3 ex_tangent;
+in float ex_tangent_sign;
 in vec2 ex_tex_coord;
-in float light;
+in vec3 ex_light_dir;
 
 flat in int ex_material_index;
 struct Material
 {
 	vec3 diffuse;
-	vec3 specular;
 	vec3 ambient;
+	vec3 specular;
+#if BINDLESS
 	sampler2D tex_diffuse_handle;
+	sampler2D tex_opacity_handle; // single channel
+	sampler2D tex_normal_handle; // tangent space
+#else
+	uvec2 tex_diffuse_handle; // unused, keep the layout of GLMaterial
+	uvec2 tex_opacity_handle;
+	uvec2 tex_normal_handle;
+#endif
 };
 
 layout (std430, binding = 0) readonly buffer Materials
@@ -21,13 +38,43 @@ layout (std430, binding = 0) readonly buffer Materials
 	Material materials[];
 };
 
+#if BINDLESS
+#define TEX_DIFFUSE materials[ex_material_index].tex_diffuse_handle
+#define TEX_OPACITY materials[ex_material_index].tex_opacity_handle
+#define TEX_NORMAL materials[ex_material_index].tex_normal_handle
+#else
+layout (binding = 0) uniform sampler2D tex_diffuse;
+layout (binding = 1) uniform sampler2D tex_opacity;
+layout (binding = 2) uniform sampler2D tex_normal;
+#define TEX_DIFFUSE tex_diffuse
+#define TEX_OPACITY tex_opacity
+#define TEX_NORMAL tex_normal
+#endif
 
 out vec4 FragColor;
 
 void main( void )
 {
+	if ( texture( TEX_OPACITY, ex_tex_coord ).r < 0.5f )
+	{
+		discard;
+	}
+
+	// tangent frame reconstructed as in MikkTSpace, the bitangent is not interpolated
+	vec3 n = normalize( ex_normal );
+	vec3 t = normalize( ex_tangent - n * dot( n, ex_tangent ) );
+	vec3 b = ex_tangent_sign * cross( n, t );
+	vec3 n_ts = texture( TEX_NORMAL, ex_tex_coord ).rgb * 2.0f - 1.0f;
+	n = normalize( mat3( t, b, n ) * n_ts );
+	if ( !gl_FrontFacing )
+	{
+		n = -n; // back faces are lit too, the frame above keeps the handedness of the front face
+	}
+
+	float light = dot( n, normalize( ex_light_dir ) );
+
 	vec4 diff = vec4(materials[ex_material_index].diffuse.rgb *
-		texture( materials[ex_material_index].tex_diffuse_handle, ex_tex_coord ).rgb,1)*light;
+		texture( TEX_DIFFUSE, ex_tex_coord ).rgb,1)*light;
 
 	vec4 amb = vec4(materials[ex_material_index].ambient.rgb, 1.0f);
 
@@ -1,24 +1,37 @@
 #version 460 core
 layout (location = 0) in vec3 in_position;
-layout (location = 1) in vec3 in_normal;
-layout (location = 2) in vec3 in_color;
+layout (location = 1) in vec2 in_normal; // octahedral encoding
+layout (location = 2) in vec4 in_color; // alpha holds the bitangent sign
 layout (location = 3) in vec2 in_texcoord;
+layout (location = 4) in vec2 in_tangent; // octahedral encoding
 
-layout (location = 5) in int in_material_index;
+layout (location = 5) in uint in_material_index;
 
 uniform mat4 MVP;
 uniform mat4 MV; 
 
 out vec3 ex_color;
 out vec3 ex_normal;
+out vec3 ex_tangent;
+out float ex_tangent_sign;
 out vec2 ex_tex_coord;
 out vec3 ex_lightPos;
-out float light;
+out vec3 ex_light_dir;
 out vec3 ex_color_amb;
 out vec3 ex_color_spec;
 
 flat out int ex_material_index;
 
+// inverse of OctahedralEncode
+vec3 octahedral_decode( vec2 e )
+{
+	vec3 n = vec3( e.xy, 1.0f - abs( e.x ) - abs( e.y ) );
+	float t = max( -n.z, 0.0f );
+	n.xy += vec2( ( n.x >= 0.0f ) ? -t : t, ( n.y >= 0.0f ) ? -t : t );
+
+	return normalize( n );
+}
+
 void main( void )
 {
 	gl_Position = MVP * vec4(in_position.x, in_position.y, in_position.z, 1.0f);
@@ -26,22 +39,19 @@ void main( void )
 	vec3 lightPossition = vec3(100.0, 50.0, 200.0);
 	vec3 vectorToLight = normalize(lightPossition - in_position.xyz);
 
-	vec3 unified_normal_es = normalize( ( MV * vec4( in_normal.xyz, 0.0f ) ).xyz );
-	vec4 hit_es = MV * vec4(in_position.xyz,1.0f); // in_position = (nx, ny, nz, 0)
-	vec3 omega_i_es = normalize( hit_es.xyz / hit_es.w );
-	if ( dot( unified_normal_es, omega_i_es ) > 0.0f )
-	{
-		unified_normal_es *= -1.0f;
-	}
+	// the normal is turned towards the viewer per fragment, after the normal map is applied in the frame of the triangle
+	vec3 normal_es = normalize( ( MV * vec4( octahedral_decode( in_normal ), 0.0f ) ).xyz );
 
-	ex_material_index = in_material_index;
+	ex_material_index = int( in_material_index );
 
 	vectorToLight = normalize((MV * vec4(vectorToLight, 0.0f)).xyz);
 
-	light = dot(unified_normal_es, vectorToLight.xyz);
+	ex_light_dir = vectorToLight.xyz; // the lighting is evaluated per fragment with the normal map
 
-	ex_color = in_color;
-	ex_normal = unified_normal_es;
+	ex_color = in_color.rgb;
+	ex_normal = normal_es;
+	ex_tangent = ( MV * vec4( octahedral_decode( in_tangent ), 0.0f ) ).xyz;
+	ex_tangent_sign = ( in_color.a > 0.5f ) ? 1.0f : -1.0f;
 	ex_tex_coord = in_texcoord;
 
 }
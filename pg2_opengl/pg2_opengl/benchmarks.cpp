@@ -0,0 +1,1173 @@
+#include "pch.h"
+#include "benchmarks.h"
+#include "objloader.h"
+#include "utils.h"
+#include "mymath.h"
+#include "scanner.h"
+#include "materialregistry.h"
+#include "normals.h"
+#include "threadpool.h"
+#include "sceneloader.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "camera.h"
+#include "rasterizer.h"
+
+#include <thread>
+
+typedef std::function<int( const char *, std::vector<Surface *> &, std::vector<Material *> & )> OBJLoader;
+
+/* the original three pass (mtllib; v, vn, vt; g, usemtl, f) OBJ loader kept as the reference of BenchmarkOBJLoading,
+it only parses the file and builds the surfaces, i.e. it corresponds to LoadOBJ without the cache and post-processing */
+static int LoadOBJThreePass( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials,
+	const bool flip_yz = false, const Vector3 default_color = Vector3( 0.5f, 0.5f, 0.5f ) )
+{
+	// oteven soouboru
+	FILE * file = fopen( file_name, "rt" );
+	if ( file == NULL )
+	{
+		printf( "File %s not found.\n", file_name );
+
+		return -1;
+	}
+
+	// cesta k zadanmu souboru
+	char path[128] = { "" };
+	const char * tmp = strrchr( file_name, '/' );
+	if ( tmp != NULL )
+	{
+		memcpy( path, file_name, sizeof( char ) * ( tmp - file_name + 1 ) );
+	}
+
+	// naten celho souboru do pamti
+	/*const long long*/size_t file_size = static_cast<size_t>( GetFileSize64( file_name ) );
+	char * buffer = new char[file_size + 1]; // +1 protoe budeme za posledn naten byte dvat NULL
+	char * buffer_backup = new char[file_size + 1];	
+
+	printf( "Loading model from '%s' (%0.1f MB)...\n", file_name, file_size / sqr( 1024.0f ) );
+
+	size_t number_of_items_read = fread( buffer, sizeof( *buffer ), file_size, file );
+
+	// otestujeme korektnost naten dat
+	if ( !feof( file ) && ( number_of_items_read != file_size ) )
+	{
+		printf( "Unexpected end of file encountered.\n" );
+
+		fclose( file );
+		file = NULL;
+
+		SAFE_DELETE_ARRAY( buffer_backup );
+		SAFE_DELETE_ARRAY( buffer );
+
+		return -1;
+	}	
+
+	buffer[number_of_items_read] = 0; // zajistme korektn ukonen etzce
+
+	fclose( file ); // ukonme prci se souborem
+	file = NULL;
+
+	memcpy( buffer_backup, buffer, file_size + 1 ); // zloha bufferu
+
+	printf( "Done.\n\n");
+
+	printf( "Parsing material data...\n" );
+
+	char material_library[128] = { 0 };
+
+	std::vector<std::string> material_libraries;	
+
+	const char delim[] = "\n";
+	char * line = strtok( buffer, delim );	
+
+	// --- natn vech materilovch knihoven, prvn prchod ---
+	while ( line != NULL )
+	{
+		switch ( line[0] )
+		{	
+		case 'm': // mtllib
+			{
+				sscanf( line, "%*s %s", &material_library );
+				printf( "Material library: %s\n", material_library );				
+				material_libraries.push_back( std::string( path ).append( std::string( material_library ) ) );
+			}
+			break;
+		}
+
+		line = strtok( NULL, delim ); // naten dalho dku
+	}
+
+	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+
+	MaterialRegistry material_registry( materials );
+	for ( int i = 0; i < static_cast<int>( material_libraries.size() ); ++i )
+	{		
+		LoadMTL( material_libraries[i].c_str(), path, material_registry );
+	}
+
+	std::vector<Vector3> vertices; // cel jeden soubor
+	std::vector<Vector3> per_vertex_normals;
+	std::vector<Coord2f> texture_coords;	
+
+	line = strtok( buffer, delim );	
+	//line = Trim( line );
+
+	// --- natn vech souadnic, druh prchod ---
+	while ( line != NULL )
+	{
+		switch ( line[0] )
+		{
+		case 'v': // seznam vrchol, norml nebo texturovacch souadnic aktuln skupiny			
+			{
+				switch ( line[1] )
+				{
+				case ' ': // vertex
+					{
+						Vector3 vertex;
+						if ( flip_yz )
+						{
+							//float x, y, z;
+							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.z, &vertex.y );
+							vertex.y *= -1;
+						}
+						else
+						{
+							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.y, &vertex.z );
+						}
+
+						vertices.push_back( vertex );
+					}
+					break;
+
+				case 'n': // normla vertexu
+					{
+						Vector3 normal;
+						if ( flip_yz )
+						{			
+							//float x, y, z;
+							sscanf( line, "%*s %f %f %f", &normal.x, &normal.z, &normal.y );							
+							normal.y *= -1;
+						}
+						else
+						{
+							sscanf( line, "%*s %f %f %f", &normal.x, &normal.y, &normal.z );
+						}
+						normal.Normalize();
+						per_vertex_normals.push_back( normal );
+					}
+					break;
+
+				case 't': // texturovac souadnice
+					{
+						Coord2f texture_coord;
+						float z = 0;
+						sscanf( line, "%*s %f %f %f",
+							&texture_coord.u, &texture_coord.v, &z );					
+						texture_coords.push_back( texture_coord );
+					}
+					break;
+				}
+			}
+			break;		
+		}
+
+		line = strtok( NULL, delim ); // naten dalho dku
+		//line = Trim( line );
+	}
+
+	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+
+	printf( "%I64u vertices, %I64u normals and %I64u texture coords.\n",
+		vertices.size(), per_vertex_normals.size(), texture_coords.size() );
+
+	/// buffery pro natn etzc	
+	char group_name[128];	
+	char material_name[128];
+	char vertices_indices[4][8 * 3 + 2];	// pomocn etzec pro natn index a 4 x "v/vt/vn"
+	char vertex_indices[3][8];				// pomocn etzec jednotlivch index "v", "vt" a "vn"	
+
+	std::vector<Vertex> face_vertices; // pole vech vertex prv natan face
+
+	int no_surfaces = 0; // poet natench ploch
+
+	line = strtok( buffer, delim ); // reset
+	//line = Trim( line );
+
+	// --- natn jednotlivch objekt (group), tet prchod ---
+	while ( line != NULL )
+	{
+		switch ( line[0] )
+		{
+		case 'g': // group
+			{
+				if ( face_vertices.size() > 0 )
+				{
+					surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
+					printf( "\r%I64u group(s)\t\t", surfaces.size() );
+					++no_surfaces;
+					face_vertices.clear();
+
+					for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+					{
+						if ( materials[i]->name().compare( material_name ) == 0 )
+						{
+							Surface * s = *--surfaces.end();
+							s->set_material( materials[i] );
+							break;
+						}
+					}
+				}
+
+				sscanf( line, "%*s %s", &group_name );
+				//printf( "Group name: %s\n", group_name );				
+			}
+			break;
+
+		case 'u': // usemtl			
+			{
+				sscanf( line, "%*s %s", &material_name );
+				//printf( "Material name: %s\n", material_name );						
+			}
+			break;
+
+		case 'f': // face
+			{
+				// ! pedpokldme pouze trojhelnky !
+				// ! pedpokldme vyuit vech t poloek v/vt/vn !				
+				int no_slashes = 0;
+				for ( int i = 0; i < int( strlen( line ) ); ++i )
+				{
+					if ( line[i] == '/' )
+					{
+						++no_slashes;
+					}
+				}
+				switch ( no_slashes )
+				{
+				case 2*3: // triangles
+					sscanf( line, "%*s %s %s %s",
+						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2] );
+					break;
+
+				case 2*4: // quadrilaterals				
+					sscanf( line, "%*s %s %s %s %s",
+						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2], &vertices_indices[3] );
+					break;
+				}
+
+				// TODO smoothing groups
+
+				for ( int i = 0; i < 3; ++i )				
+				{									
+					if (strstr(vertices_indices[i], "//"))
+					{
+						sscanf(vertices_indices[i], "%[0-9]//%[0-9]",
+							&vertex_indices[0], &vertex_indices[2]);
+						vertex_indices[1][0] = 0;
+					}
+					else
+					{
+						sscanf(vertices_indices[i], "%[0-9]/%[0-9]/%[0-9]",
+							&vertex_indices[0], &vertex_indices[1], &vertex_indices[2]);
+					}
+
+					const int vertex_index = atoi( vertex_indices[0] ) - 1;					
+					const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
+					const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
+
+					if (texture_coord_index >= 0)
+					{
+						face_vertices.push_back(Vertex(vertices[vertex_index],
+							per_vertex_normals[per_vertex_normal_index],
+							default_color, &texture_coords[texture_coord_index]));
+					}
+					else
+					{
+						face_vertices.push_back(Vertex(vertices[vertex_index],
+							per_vertex_normals[per_vertex_normal_index],
+							default_color));
+					}
+					
+				}
+
+				if ( no_slashes == 2*4 )
+				{
+					const int i[] = { 0, 2, 3 };
+					for ( int j = 0; j < 3; ++j )
+					{				
+						sscanf( vertices_indices[i[j]], "%[0-9]/%[0-9]/%[0-9]",					
+							&vertex_indices[0], &vertex_indices[1], &vertex_indices[2] );
+
+						const int vertex_index = atoi( vertex_indices[0] ) - 1;
+						const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
+						const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
+
+						face_vertices.push_back( Vertex( vertices[vertex_index],
+							per_vertex_normals[per_vertex_normal_index],
+							default_color, &texture_coords[texture_coord_index] ) );
+					}
+				}
+			}
+			break;
+		}
+
+		line = strtok( NULL, delim ); // naten dalho dku
+		//line = Trim( line );
+	}
+
+	if ( face_vertices.size() > 0 )
+	{
+		surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
+		printf( "\r%I64u group(s)\t\t", surfaces.size() );
+		++no_surfaces;
+		face_vertices.clear();
+
+		for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+		{
+			if ( materials[i]->name().compare( material_name ) == 0 )
+			{
+				Surface * s = *--surfaces.end();
+				s->set_material( materials[i] );
+				break;
+			}
+		}
+	}
+
+	texture_coords.clear();
+	per_vertex_normals.clear();
+	vertices.clear();	
+
+	SAFE_DELETE_ARRAY( buffer_backup );
+	SAFE_DELETE_ARRAY( buffer );	
+
+	printf( "\nDone.\n\n");
+
+	return no_surfaces;
+}
+
+/* returns the best wall time (s) of no_runs invocations of the given loader */
+static double TimeOBJLoader( OBJLoader loader, const char * file_name, const int no_runs, int & no_triangles )
+{
+	double best_time = DBL_MAX;
+
+	for ( int run = 0; run < no_runs; ++run )
+	{
+		std::vector<Surface *> surfaces;
+		std::vector<Material *> materials;
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		loader( file_name, surfaces, materials );
+		const auto t1 = std::chrono::high_resolution_clock::now();
+
+		best_time = min( best_time, std::chrono::duration<double>( t1 - t0 ).count() );
+
+		no_triangles = 0;
+		for ( Surface * surface : surfaces )
+		{
+			no_triangles += surface->no_triangles();
+		}
+
+		ReleaseScene( surfaces, materials );
+	}
+
+	return best_time;
+}
+
+int BenchmarkOBJLoading( const char * file_name, const int no_runs )
+{
+	int no_triangles_three_pass = 0;
+	int no_triangles = 0;
+
+	const double t_three_pass = TimeOBJLoader( []( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+	{
+		return LoadOBJThreePass( file_name, surfaces, materials );
+	}, file_name, no_runs, no_triangles_three_pass );
+
+	// the text parser is compared with the same work, i.e. without the cache and the post-processing of the surfaces
+	OBJLoaderOptions options;
+	options.use_cache = false;
+	options.optimize_meshes = false;
+	options.generate_tangents = false;
+	options.build_meshlets = false;
+	options.no_lods = 0;
+	const OBJLoader load_obj = [&options]( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+	{
+		return LoadOBJ( file_name, surfaces, materials, options );
+	};
+	const double t = TimeOBJLoader( load_obj, file_name, no_runs, no_triangles );
+
+	// the whole pipeline with the default options
+	options = OBJLoaderOptions();
+	options.use_cache = false;
+	int no_triangles_full = 0;
+	const double t_full = TimeOBJLoader( load_obj, file_name, no_runs, no_triangles_full );
+
+	// the cold start with a valid cache, the first call makes sure the cache exists
+	options.use_cache = true;
+	int no_triangles_cached = 0;
+	TimeOBJLoader( load_obj, file_name, 1, no_triangles_cached );
+	const double t_cached = TimeOBJLoader( load_obj, file_name, no_runs, no_triangles_cached );
+
+	printf( "OBJ loading benchmark '%s' (best of %d runs, %u hardware threads)\n",
+		file_name, no_runs, std::thread::hardware_concurrency() );
+	printf( "  LoadOBJThreePass: %s (%d triangles)\n", TimeToString( t_three_pass ).c_str(), no_triangles_three_pass );
+	printf( "  LoadOBJ (parser): %s (%d triangles)\n", TimeToString( t ).c_str(), no_triangles );
+	printf( "  speedup:          %0.2fx\n", t_three_pass / t );
+	printf( "  LoadOBJ (full):   %s (%d triangles)\n", TimeToString( t_full ).c_str(), no_triangles_full );
+	printf( "  LoadOBJ (cached): %s (%d triangles)\n", TimeToString( t_cached ).c_str(), no_triangles_cached );
+
+	return ( no_triangles_three_pass == no_triangles && no_triangles_full == no_triangles_cached ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* seconds elapsed since t0 */
+static double SecondsSince( const std::chrono::high_resolution_clock::time_point t0 )
+{
+	return std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - t0 ).count();
+}
+
+int BenchmarkScanner( const int no_lines )
+{
+	std::mt19937 generator( 1 );
+	std::uniform_real_distribution<float> coordinate( -1000.0f, 1000.0f );
+	std::uniform_int_distribution<int> index( 1, 1000000 );
+
+	// --- synthetic input, various float notations and all face vertex forms including relative indices ---
+	std::string vertex_lines;
+	std::string face_lines;
+	char line[256];
+
+	for ( int i = 0; i < no_lines; ++i )
+	{
+		const char * formats[] = { "v %f %f %f\n", "v %.9g %.9g %.9g\n", "v %e %e %e\n", "v %.2f %.0f %.4f\n" };
+		sprintf( line, formats[i % 4], coordinate( generator ), coordinate( generator ), coordinate( generator ) );
+		vertex_lines.append( line );
+
+		const int a = index( generator ), b = index( generator ), c = index( generator );
+		switch ( i % 4 )
+		{
+		case 0: sprintf( line, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, b, c, b, c, a, c, a, b ); break;
+		case 1: sprintf( line, "f %d//%d %d//%d %d//%d\n", a, b, b, c, c, a ); break;
+		case 2: sprintf( line, "f %d/%d %d/%d %d/%d\n", a, b, b, c, c, a ); break;
+		case 3: sprintf( line, "f -%d/-%d/-%d -%d/-%d/-%d -%d/-%d/-%d\n", a % 9 + 1, a % 9 + 1, a % 9 + 1, b % 9 + 1, b % 9 + 1, b % 9 + 1, c % 9 + 1, c % 9 + 1, c % 9 + 1 ); break;
+		}
+		face_lines.append( line );
+	}
+
+	// sscanf expects NULL terminated lines (this is what strtok used to produce)
+	std::string vertex_lines_terminated = vertex_lines;
+	std::replace( vertex_lines_terminated.begin(), vertex_lines_terminated.end(), '\n', '\0' );
+	std::string face_lines_terminated = face_lines;
+	std::replace( face_lines_terminated.begin(), face_lines_terminated.end(), '\n', '\0' );
+
+	std::vector<float> sscanf_floats, scanner_floats;
+	std::vector<int> sscanf_indices, scanner_indices;
+	sscanf_floats.reserve( no_lines * 3 );
+	scanner_floats.reserve( no_lines * 3 );
+	sscanf_indices.reserve( no_lines * 9 );
+	scanner_indices.reserve( no_lines * 9 );
+
+	// --- original path: sscanf per line and "%[0-9]" + atoi per face vertex ---
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for ( const char * p = vertex_lines_terminated.c_str(), *end = p + vertex_lines_terminated.size(); p < end; p += strlen( p ) + 1 )
+	{
+		float x, y, z;
+		sscanf( p, "%*s %f %f %f", &x, &y, &z );
+		sscanf_floats.push_back( x );
+		sscanf_floats.push_back( y );
+		sscanf_floats.push_back( z );
+	}
+	const double t_sscanf_vertices = SecondsSince( t0 );
+
+	t0 = std::chrono::high_resolution_clock::now();
+	for ( const char * p = face_lines_terminated.c_str(), *end = p + face_lines_terminated.size(); p < end; p += strlen( p ) + 1 )
+	{
+		char vertices_indices[3][64];
+		sscanf( p, "%*s %63s %63s %63s", vertices_indices[0], vertices_indices[1], vertices_indices[2] );
+		for ( int i = 0; i < 3; ++i )
+		{
+			char vertex_indices[3][16] = { { 0 }, { 0 }, { 0 } };
+			if ( strstr( vertices_indices[i], "//" ) )
+			{
+				sscanf( vertices_indices[i], "%15[-0-9]//%15[-0-9]", vertex_indices[0], vertex_indices[2] );
+			}
+			else
+			{
+				sscanf( vertices_indices[i], "%15[-0-9]/%15[-0-9]/%15[-0-9]", vertex_indices[0], vertex_indices[1], vertex_indices[2] );
+			}
+			sscanf_indices.push_back( atoi( vertex_indices[0] ) );
+			sscanf_indices.push_back( atoi( vertex_indices[1] ) );
+			sscanf_indices.push_back( atoi( vertex_indices[2] ) );
+		}
+	}
+	const double t_sscanf_faces = SecondsSince( t0 );
+
+	// --- scanner path directly on the newline separated text ---
+	t0 = std::chrono::high_resolution_clock::now();
+	for ( const char * p = vertex_lines.c_str(), *end = p + vertex_lines.size(); p < end; )
+	{
+		const char * line_end = static_cast<const char *>( memchr( p, '\n', end - p ) );
+		float values[3];
+		int no_values = 0;
+		ScanFloats( p + 1, line_end, values, 3, no_values );
+		scanner_floats.insert( scanner_floats.end(), values, values + 3 );
+		p = line_end + 1;
+	}
+	const double t_scanner_vertices = SecondsSince( t0 );
+
+	t0 = std::chrono::high_resolution_clock::now();
+	for ( const char * p = face_lines.c_str(), *end = p + face_lines.size(); p < end; )
+	{
+		const char * line_end = static_cast<const char *>( memchr( p, '\n', end - p ) );
+		const char * q = p + 1;
+		for ( int i = 0; i < 3; ++i )
+		{
+			int v = 0, vt = 0, vn = 0;
+			q = ScanIndexTriplet( q, line_end, v, vt, vn );
+			scanner_indices.push_back( v );
+			scanner_indices.push_back( vt );
+			scanner_indices.push_back( vn );
+		}
+		p = line_end + 1;
+	}
+	const double t_scanner_faces = SecondsSince( t0 );
+
+	// --- verification ---
+	int no_float_mismatches = 0;
+	float max_relative_error = 0.0f;
+	for ( size_t i = 0; i < sscanf_floats.size(); ++i )
+	{
+		if ( sscanf_floats[i] != scanner_floats[i] )
+		{
+			++no_float_mismatches;
+			max_relative_error = max( max_relative_error, fabsf( ( sscanf_floats[i] - scanner_floats[i] ) / sscanf_floats[i] ) );
+		}
+	}
+	const bool indices_match = ( sscanf_indices == scanner_indices );
+
+	printf( "Scanner benchmark (%d vertex and %d face lines)\n", no_lines, no_lines );
+	printf( "  vertices: sscanf %s, ScanFloats %s, speedup %0.1fx\n", TimeToString( t_sscanf_vertices ).c_str(),
+		TimeToString( t_scanner_vertices ).c_str(), t_sscanf_vertices / t_scanner_vertices );
+	printf( "  faces:    sscanf %s, ScanIndexTriplet %s, speedup %0.1fx\n", TimeToString( t_sscanf_faces ).c_str(),
+		TimeToString( t_scanner_faces ).c_str(), t_sscanf_faces / t_scanner_faces );
+	printf( "  %d of %I64u floats differ (max relative error %g), indices %s\n", no_float_mismatches,
+		sscanf_floats.size(), max_relative_error, indices_match ? "match" : "DIFFER" );
+
+	return indices_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int BenchmarkMaterialLookup( const int no_materials, const int no_groups )
+{
+	// --- synthetic scene, every group uses a different material in a scattered order ---
+	const char * obj_file_name = "material_lookup_benchmark.obj";
+	const char * mtl_file_name = "material_lookup_benchmark.mtl";
+
+	FILE * file = fopen( mtl_file_name, "wt" );
+	if ( file == NULL )
+	{
+		printf( "File %s cannot be created.\n", mtl_file_name );
+
+		return EXIT_FAILURE;
+	}
+	for ( int i = 0; i < no_materials; ++i )
+	{
+		fprintf( file, "newmtl material_%d\nKd 0.5 0.5 0.5\n", i );
+	}
+	fclose( file );
+
+	std::vector<std::string> group_material_names( no_groups );
+	file = fopen( obj_file_name, "wt" );
+	if ( file == NULL )
+	{
+		printf( "File %s cannot be created.\n", obj_file_name );
+
+		return EXIT_FAILURE;
+	}
+	fprintf( file, "mtllib %s\nv 0 0 0\nv 1 0 0\nv 0 1 0\n", mtl_file_name );
+	for ( int i = 0; i < no_groups; ++i )
+	{
+		group_material_names[i] = "material_" + std::to_string( ( i * 7919LL ) % no_materials );
+		fprintf( file, "g group_%d\nusemtl %s\nf 1 2 3\n", i, group_material_names[i].c_str() );
+	}
+	fclose( file );
+
+	// --- whole loader ---
+	OBJLoaderOptions options;
+	options.use_cache = false;
+	options.optimize_meshes = false;
+	std::vector<Surface *> surfaces;
+	std::vector<Material *> materials;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	LoadOBJ( obj_file_name, surfaces, materials, options );
+	const double t_load = SecondsSince( t0 );
+
+	bool materials_match = ( surfaces.size() == group_material_names.size() );
+	for ( size_t i = 0; materials_match && i < surfaces.size(); ++i )
+	{
+		materials_match = surfaces[i]->get_material() && surfaces[i]->get_material()->name() == group_material_names[i];
+	}
+
+	// --- lookups alone, the original linear scan compared each name in turn ---
+	std::vector<int> linear_indices( no_groups, -1 );
+	t0 = std::chrono::high_resolution_clock::now();
+	for ( int i = 0; i < no_groups; ++i )
+	{
+		for ( size_t j = 0; j < materials.size(); ++j )
+		{
+			if ( materials[j]->name().compare( group_material_names[i] ) == 0 )
+			{
+				linear_indices[i] = static_cast<int>( j );
+				break;
+			}
+		}
+	}
+	const double t_linear = SecondsSince( t0 );
+
+	std::vector<int> hashed_indices( no_groups, -1 );
+	t0 = std::chrono::high_resolution_clock::now();
+	MaterialRegistry registry( materials );
+	for ( int i = 0; i < no_groups; ++i )
+	{
+		hashed_indices[i] = registry.Find( group_material_names[i] );
+	}
+	const double t_hashed = SecondsSince( t0 );
+
+	const bool indices_match = ( linear_indices == hashed_indices );
+
+	printf( "Material lookup benchmark (%d materials, %d groups)\n", no_materials, no_groups );
+	printf( "  LoadOBJ:       %s (%I64u materials, %I64u surfaces, materials %s)\n", TimeToString( t_load ).c_str(),
+		materials.size(), surfaces.size(), materials_match ? "match" : "DIFFER" );
+	printf( "  linear scan:   %s\n", TimeToString( t_linear ).c_str() );
+	printf( "  registry:      %s (including indexing), speedup %0.0fx, indices %s\n", TimeToString( t_hashed ).c_str(),
+		t_linear / t_hashed, indices_match ? "match" : "DIFFER" );
+
+	ReleaseScene( surfaces, materials );
+	remove( obj_file_name );
+	remove( mtl_file_name );
+
+	return ( materials_match && indices_match ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int BenchmarkNormalGeneration( const int no_triangles )
+{
+	// --- n x n quads of the height field z = a sin( kx ) cos( ky ) over the unit square ---
+	const int n = max( 1, static_cast<int>( ceil( sqrt( no_triangles / 2.0 ) ) ) );
+	const float a = 0.05f;
+	const float k = 4.0f * float( M_PI );
+
+	std::vector<Vector3> positions( size_t( n + 1 ) * ( n + 1 ) );
+	for ( int y = 0; y <= n; ++y )
+	{
+		for ( int x = 0; x <= n; ++x )
+		{
+			const float u = x / float( n ), v = y / float( n );
+			positions[size_t( y ) * ( n + 1 ) + x] = Vector3( u, v, a * sinf( k * u ) * cosf( k * v ) );
+		}
+	}
+
+	std::vector<int> indices;
+	indices.reserve( size_t( n ) * n * 6 );
+	for ( int y = 0; y < n; ++y )
+	{
+		for ( int x = 0; x < n; ++x )
+		{
+			const int i = y * ( n + 1 ) + x;
+			const int quad[6] = { i, i + 1, i + n + 2, i, i + n + 2, i + n + 1 };
+			indices.insert( indices.end(), quad, quad + 6 );
+		}
+	}
+
+	const int no_generated_triangles = static_cast<int>( indices.size() / 3 );
+	std::vector<Vector3> normals( indices.size() );
+
+	auto run = [&]( ThreadPool & thread_pool )
+	{
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		GenerateNormals( positions.data(), static_cast<int>( positions.size() ), indices.data(), sizeof( int ), no_generated_triangles,
+			nullptr, deg2rad( 60.0f ), thread_pool, normals.data() );
+
+		return SecondsSince( t0 );
+	};
+
+	ThreadPool single_thread( 1 );
+	const double t_single = run( single_thread );
+	const std::vector<Vector3> single_thread_normals = normals;
+
+	ThreadPool all_threads;
+	const double t_all = run( all_threads );
+
+	// --- verification against the analytic normals ( -dz/dx, -dz/dy, 1 ) ---
+	float max_error = 0.0f;
+	for ( size_t c = 0; c < indices.size(); ++c )
+	{
+		const Vector3 & p = positions[indices[c]];
+		Vector3 analytic( -a * k * cosf( k * p.x ) * cosf( k * p.y ), a * k * sinf( k * p.x ) * sinf( k * p.y ), 1.0f );
+		analytic.Normalize();
+		max_error = max( max_error, acosf( clamp( analytic.DotProduct( normals[c] ), -1.0f, 1.0f ) ) );
+	}
+	const bool deterministic = memcmp( single_thread_normals.data(), normals.data(), normals.size() * sizeof( Vector3 ) ) == 0;
+
+	printf( "Normal generation benchmark (%d triangles, %I64u positions)\n", no_generated_triangles, positions.size() );
+	printf( "  1 thread:   %s, %0.1f Mtri/s\n", TimeToString( t_single ).c_str(), no_generated_triangles / t_single * 1e-6 );
+	printf( "  %d threads: %s, %0.1f Mtri/s, speedup %0.2fx\n", all_threads.no_threads(), TimeToString( t_all ).c_str(),
+		no_generated_triangles / t_all * 1e-6, t_single / t_all );
+	printf( "  max deviation from the analytic normals %0.3f deg, results of both runs %s\n", max_error * 180.0f / float( M_PI ),
+		deterministic ? "match" : "DIFFER" );
+
+	return ( deterministic && max_error < deg2rad( 1.0f ) ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int BenchmarkLodSelection( const char * file_name )
+{
+	// --- cost of the simplification ---
+	OBJLoaderOptions options;
+	options.use_cache = false;
+	options.no_lods = 0;
+
+	std::vector<Surface *> surfaces;
+	std::vector<Material *> materials;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	LoadOBJ( file_name, surfaces, materials, options );
+	const double t_without_lods = SecondsSince( t0 );
+	ReleaseScene( surfaces, materials );
+
+	options.no_lods = MAX_LODS - 1;
+	t0 = std::chrono::high_resolution_clock::now();
+	LoadOBJ( file_name, surfaces, materials, options );
+	const double t_with_lods = SecondsSince( t0 );
+
+	// --- bounds and levels of all surfaces as the renderer sees them ---
+	std::vector<SurfaceDraw> draws( surfaces.size() );
+	Vector3 lower( FLT_MAX, FLT_MAX, FLT_MAX );
+	Vector3 upper( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	size_t no_triangles = 0;
+
+	for ( size_t i = 0; i < surfaces.size(); ++i )
+	{
+		SurfaceDraw & draw = draws[i];
+		BoundingSphere( surfaces[i], draw.center, draw.radius );
+		draw.no_lods = 1 + surfaces[i]->no_lods();
+		draw.lods[0].count = surfaces[i]->no_triangles() * 3;
+		for ( int level = 1; level < draw.no_lods; ++level )
+		{
+			draw.lods[level].count = static_cast<GLsizei>( surfaces[i]->get_lod( level - 1 ).indices.size() * 3 );
+			draw.lod_errors[level] = surfaces[i]->get_lod( level - 1 ).error;
+		}
+
+		lower = Vector3( min( lower.x, draw.center.x - draw.radius ), min( lower.y, draw.center.y - draw.radius ), min( lower.z, draw.center.z - draw.radius ) );
+		upper = Vector3( max( upper.x, draw.center.x + draw.radius ), max( upper.y, draw.center.y + draw.radius ), max( upper.z, draw.center.z + draw.radius ) );
+		no_triangles += surfaces[i]->no_triangles();
+	}
+
+	ReleaseScene( surfaces, materials );
+
+	// --- triangles drawn from the distances of several scene radii, 1920x1080 with 45 deg vertical field of view ---
+	const Vector3 scene_center = ( lower + upper ) * 0.5f;
+	const float scene_radius = ( upper - lower ).L2Norm() * 0.5f;
+	const float focal_length = 1080 / ( 2.0f * tanf( deg2rad( 45.0f ) * 0.5f ) );
+	Vector3 direction( 1.0f, 1.0f, 1.0f );
+	direction.Normalize();
+
+	printf( "LOD selection benchmark '%s' (%I64u surfaces, %I64u triangles)\n", file_name, draws.size(), no_triangles );
+	printf( "  load time without LODs %s, with LODs %s\n", TimeToString( t_without_lods ).c_str(), TimeToString( t_with_lods ).c_str() );
+
+	bool monotonic = true;
+	size_t previous_triangles = SIZE_MAX;
+	for ( float factor = 1.0f; factor <= 32.0f; factor *= 2.0f )
+	{
+		const Vector3 eye = scene_center + direction * ( factor * scene_radius );
+		size_t drawn_triangles = 0;
+
+		for ( const SurfaceDraw & draw : draws )
+		{
+			const float distance = max( 0.1f, ( draw.center - eye ).L2Norm() - draw.radius );
+			drawn_triangles += draw.lods[SelectLod( draw, distance, focal_length )].count / 3;
+		}
+
+		printf( "  camera at %4.0fx scene radius: %9I64u triangles, %0.1fx less than full detail\n", factor, drawn_triangles,
+			no_triangles / double( max( drawn_triangles, size_t( 1 ) ) ) );
+
+		monotonic &= ( drawn_triangles <= previous_triangles );
+		previous_triangles = drawn_triangles;
+	}
+
+	return monotonic ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int BenchmarkConeCulling( const char * file_name, const int no_angles )
+{
+	OBJLoaderOptions options;
+	options.no_lods = 0; // the meshlets cover the full detail level only
+
+	std::vector<Surface *> surfaces;
+	std::vector<Material *> materials;
+	LoadOBJ( file_name, surfaces, materials, options );
+
+	Vector3 lower( FLT_MAX, FLT_MAX, FLT_MAX );
+	Vector3 upper( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	size_t no_triangles = 0;
+	size_t no_meshlets = 0;
+
+	for ( Surface * surface : surfaces )
+	{
+		Vector3 surface_lower, surface_upper;
+		BoundingBox( surface, surface_lower, surface_upper );
+		lower = Vector3( min( lower.x, surface_lower.x ), min( lower.y, surface_lower.y ), min( lower.z, surface_lower.z ) );
+		upper = Vector3( max( upper.x, surface_upper.x ), max( upper.y, surface_upper.y ), max( upper.z, surface_upper.z ) );
+		no_triangles += surface->no_triangles();
+		no_meshlets += surface->get_meshlets().meshlets.size();
+	}
+
+	// --- camera orbiting around the scene at twice its radius, 30 deg above the horizon (z is up) ---
+	const Vector3 scene_center = ( lower + upper ) * 0.5f;
+	const float scene_radius = ( upper - lower ).L2Norm() * 0.5f;
+	const float elevation = deg2rad( 30.0f );
+
+	printf( "Cone culling benchmark '%s' (%I64u surfaces, %I64u triangles, %I64u meshlets)\n", file_name, surfaces.size(), no_triangles, no_meshlets );
+
+	double sum_culled = 0.0;
+	double sum_back_facing = 0.0;
+	double t_tests = 0.0;
+	size_t no_wrong = 0; // front-facing triangles of culled meshlets, the cones must be conservative
+
+	for ( int i = 0; i < no_angles; ++i )
+	{
+		const float degrees = 360.0f * i / no_angles;
+		const float angle = deg2rad( degrees );
+		const Vector3 eye = scene_center + Vector3( cosf( angle ) * cosf( elevation ), sinf( angle ) * cosf( elevation ), sinf( elevation ) ) * ( 2.0f * scene_radius );
+		size_t culled = 0;
+		size_t back_facing = 0;
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		for ( Surface * surface : surfaces )
+		{
+			for ( const Meshlet & meshlet : surface->get_meshlets().meshlets )
+			{
+				culled += IsMeshletBackFacing( meshlet, eye ) ? meshlet.no_triangles : 0;
+			}
+		}
+		t_tests += SecondsSince( t0 );
+
+		// reference: triangles back-face culled by the GPU
+		for ( Surface * surface : surfaces )
+		{
+			const Vertex * vertices = surface->get_vertices();
+			for ( const Meshlet & meshlet : surface->get_meshlets().meshlets )
+			{
+				const bool meshlet_culled = IsMeshletBackFacing( meshlet, eye );
+				for ( unsigned int t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.no_triangles; ++t )
+				{
+					const Triangle3ui & triangle = surface->get_indices()[t];
+					const Vector3 & p0 = vertices[triangle.v0].position;
+					const Vector3 n = ( vertices[triangle.v1].position - p0 ).CrossProduct( vertices[triangle.v2].position - p0 );
+					const bool front_facing = n.DotProduct( eye - p0 ) > 0.0f;
+					back_facing += front_facing ? 0 : 1;
+					no_wrong += ( meshlet_culled && front_facing && n.DotProduct( eye - p0 ) > 1e-4f * n.L2Norm() * ( eye - p0 ).L2Norm() ) ? 1 : 0;
+				}
+			}
+		}
+
+		const double culled_ratio = culled / double( max( no_triangles, size_t( 1 ) ) );
+		const double back_facing_ratio = back_facing / double( max( no_triangles, size_t( 1 ) ) );
+		sum_culled += culled_ratio;
+		sum_back_facing += back_facing_ratio;
+
+		printf( "  orbit %5.1f deg: %5.1f %% triangles culled by cones, %5.1f %% back-facing\n", degrees, 100.0 * culled_ratio,
+			100.0 * back_facing_ratio );
+	}
+
+	printf( "  average %0.1f %% culled of %0.1f %% back-facing, %s per frame for the cone tests\n", 100.0 * sum_culled / no_angles,
+		100.0 * sum_back_facing / no_angles, TimeToString( t_tests / no_angles ).c_str() );
+
+	ReleaseScene( surfaces, materials );
+
+	if ( no_wrong > 0 )
+	{
+		printf( "  %I64u front-facing triangles were culled\n", no_wrong );
+
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* two triangles of the quad with the corners in the counterclockwise order */
+static void AddQuad( std::vector<Vertex> & face_vertices, const Vector3 & p0, const Vector3 & p1, const Vector3 & p2, const Vector3 & p3 )
+{
+	Vector3 normal = ( p1 - p0 ).CrossProduct( p2 - p0 );
+	normal.Normalize();
+	const Vector3 color( 0.5f, 0.5f, 0.5f );
+	const Vector3 corners[6] = { p0, p1, p2, p0, p2, p3 };
+
+	for ( const Vector3 & corner : corners )
+	{
+		face_vertices.push_back( Vertex( corner, normal, color ) );
+	}
+}
+
+int BenchmarkOcclusionCulling( const int no_rooms, const int no_objects, const int no_frames )
+{
+	// --- corridor of 10 x 10 x 4 m rooms along the x axis separated by walls with doors on alternating sides, small boxes in the rooms ---
+	std::vector<Surface *> surfaces;
+	std::vector<int> rooms; // room of each box, -1 for the walls
+	std::mt19937 generator( 7 );
+	std::uniform_real_distribution<float> random( 0.5f, 9.5f );
+
+	for ( int room = 1; room < no_rooms; ++room )
+	{
+		const float x = 10.0f * room;
+		const float door = ( room % 2 == 1 ) ? 3.0f : -3.0f;
+		std::vector<Vector3> rectangles = { Vector3( -5.0f, door - 0.75f, 0.0f ), Vector3( door + 0.75f, 5.0f, 0.0f ), Vector3( door - 0.75f, door + 0.75f, 2.5f ) };
+		std::vector<Vertex> face_vertices;
+
+		for ( const Vector3 & r : rectangles )
+		{
+			// r = ( y0, y1, z0 ), the rectangles reach the ceiling
+			AddQuad( face_vertices, Vector3( x, r.x, r.z ), Vector3( x, r.y, r.z ), Vector3( x, r.y, 4.0f ), Vector3( x, r.x, 4.0f ) );
+		}
+		surfaces.push_back( BuildSurface( "wall_" + std::to_string( room ), face_vertices ) );
+		rooms.push_back( -1 );
+	}
+
+	for ( int room = 0; room < no_rooms; ++room )
+	{
+		for ( int i = 0; i < no_objects; ++i )
+		{
+			const Vector3 lower( 10.0f * room + random( generator ), random( generator ) - 5.0f, random( generator ) * 0.3f );
+			const Vector3 upper = lower + Vector3( 0.4f, 0.4f, 0.4f );
+			std::vector<Vertex> face_vertices;
+
+			for ( int axis = 0; axis < 3; ++axis )
+			{
+				// two opposite faces perpendicular to the axis
+				for ( int side = 0; side < 2; ++side )
+				{
+					Vector3 c[4];
+					for ( int k = 0; k < 4; ++k )
+					{
+						const int u = ( k == 1 || k == 2 ) ? 1 : 0;
+						const int v = ( k >= 2 ) ? 1 : 0;
+						float p[3];
+						p[axis] = side ? upper.data[axis] : lower.data[axis];
+						p[( axis + 1 ) % 3] = u ? upper.data[( axis + 1 ) % 3] : lower.data[( axis + 1 ) % 3];
+						p[( axis + 2 ) % 3] = v ? upper.data[( axis + 2 ) % 3] : lower.data[( axis + 2 ) % 3];
+						c[side ? k : 3 - k] = Vector3( p[0], p[1], p[2] );
+					}
+					AddQuad( face_vertices, c[0], c[1], c[2], c[3] );
+				}
+			}
+			surfaces.push_back( BuildSurface( "box_" + std::to_string( room ) + "_" + std::to_string( i ), face_vertices ) );
+			rooms.push_back( room );
+		}
+	}
+
+	std::vector<SurfaceDraw> draws( surfaces.size() );
+	for ( size_t i = 0; i < surfaces.size(); ++i )
+	{
+		BoundingBox( surfaces[i], draws[i].lower, draws[i].upper );
+		draws[i].center = ( draws[i].lower + draws[i].upper ) * 0.5f;
+		draws[i].radius = ( draws[i].upper - draws[i].lower ).L2Norm() * 0.5f;
+	}
+
+	OcclusionCuller culler;
+	culler.SetScene( surfaces );
+
+	printf( "Occlusion culling benchmark (%d rooms, %I64u surfaces)\n", no_rooms, surfaces.size() );
+
+	// --- camera walking through the first room and looking down the corridor ---
+	double sum_ms = 0.0, max_ms = 0.0;
+	size_t sum_visible = 0, sum_occluded = 0, sum_in_frustum = 0;
+	int no_false_occlusions = 0; // boxes in the room of the camera must never be hidden
+	std::vector<int> visible;
+	std::vector<float> sizes;
+
+	for ( int frame = 0; frame < no_frames; ++frame )
+	{
+		const float t = frame / float( std::max( no_frames - 1, 1 ) );
+		const Vector3 view_from( 0.5f + 8.0f * t, -2.0f + 4.0f * t, 1.7f );
+		Camera camera( 1280, 720, deg2rad( 60.0f ), view_from, view_from + Vector3( 10.0f, 2.0f * sinf( 6.0f * t ), 0.0f ), 0.1f, 1000.0f );
+		const Matrix4x4 mvp = camera.projection() * camera.view();
+		const Frustum frustum( mvp );
+
+		visible.clear();
+		sizes.clear();
+		for ( size_t i = 0; i < draws.size(); ++i )
+		{
+			if ( frustum.IsBoxVisible( draws[i].lower, draws[i].upper ) )
+			{
+				visible.push_back( static_cast<int>( i ) );
+				// only the walls occlude, so that the boxes of the first room (in front of all walls) must stay visible
+				sizes.push_back( ( rooms[i] < 0 ) ? draws[i].radius / max( 0.1f, ( draws[i].center - view_from ).L2Norm() - draws[i].radius ) : 0.0f );
+			}
+		}
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		culler.Start( mvp, draws, visible, sizes );
+		const std::vector<unsigned char> & result = culler.Finish();
+		const double ms = 1e3 * SecondsSince( t0 );
+
+		for ( size_t k = 0; k < result.size(); ++k )
+		{
+			sum_occluded += result[k] ? 0 : 1;
+			no_false_occlusions += ( !result[k] && rooms[culler.occludees()[k]] == 0 ) ? 1 : 0;
+		}
+		sum_visible += visible.size() - ( result.size() - std::count( result.begin(), result.end(), 1 ) );
+		sum_in_frustum += visible.size();
+		sum_ms += ms;
+		max_ms = max( max_ms, ms );
+	}
+
+	printf( "  %0.1f surfaces in the frustum, %0.1f drawn, %0.1f occluded per frame\n", sum_in_frustum / double( no_frames ),
+		sum_visible / double( no_frames ), sum_occluded / double( no_frames ) );
+	printf( "  culling %0.3f ms on average, %0.3f ms at most (including the wait for the workers)\n", sum_ms / no_frames, max_ms );
+
+	std::vector<Material *> materials;
+	ReleaseScene( surfaces, materials );
+
+	if ( no_false_occlusions > 0 )
+	{
+		printf( "  %d boxes in the room of the camera were culled\n", no_false_occlusions );
+
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* minimum, average and nearest-rank percentiles of the frame times */
+struct FrameTimeStatistics
+{
+	double min{ 0.0 };
+	double avg{ 0.0 };
+	double p95{ 0.0 };
+	double p99{ 0.0 };
+};
+
+static FrameTimeStatistics ComputeFrameTimeStatistics( const std::vector<FrameTime> & frame_times, double FrameTime::* time )
+{
+	FrameTimeStatistics statistics;
+	if ( frame_times.empty() ) return statistics;
+
+	std::vector<double> times( frame_times.size() );
+	for ( size_t i = 0; i < frame_times.size(); ++i )
+	{
+		times[i] = frame_times[i].*time;
+		statistics.avg += times[i];
+	}
+	std::sort( times.begin(), times.end() );
+
+	auto percentile = [&times]( const double p ) { return times[static_cast<size_t>( ceil( p * times.size() ) ) - 1]; };
+	statistics.min = times.front();
+	statistics.avg /= times.size();
+	statistics.p95 = percentile( 0.95 );
+	statistics.p99 = percentile( 0.99 );
+
+	return statistics;
+}
+
+/* file names may contain backslashes (Windows paths) */
+static std::string JsonString( const char * text )
+{
+	std::string result = "\"";
+	for ( const char * c = text; *c; ++c )
+	{
+		if ( *c == '\\' || *c == '"' ) result += '\\';
+		result += *c;
+	}
+
+	return result + "\"";
+}
+
+int BenchmarkHeadlessRendering( const char * file_name, const int no_frames, const int width, const int height )
+{
+	// the view of tutorial_1
+	Rasterizer rasterizer( width, height, deg2rad( 45.0 ), Vector3( 150, -500, 200 ), Vector3( 0, 0, 35 ), 1.0f, 1000.0f );
+
+	if ( rasterizer.InitDeviceAndScene( file_name, max( no_frames, 1 ) ) != EXIT_SUCCESS )
+	{
+		printf( "Headless rendering: no offscreen OpenGL context could be created\n" );
+
+		return EXIT_FAILURE;
+	}
+
+	rasterizer.MainLoop();
+
+	const std::vector<FrameTime> & frame_times = rasterizer.frame_times();
+	if ( frame_times.empty() )
+	{
+		return EXIT_FAILURE;
+	}
+
+	const FrameTimeStatistics cpu = ComputeFrameTimeStatistics( frame_times, &FrameTime::cpu_ms );
+	const FrameTimeStatistics gpu = ComputeFrameTimeStatistics( frame_times, &FrameTime::gpu_ms );
+	const FrameTimeStatistics frame = ComputeFrameTimeStatistics( frame_times, &FrameTime::frame_ms );
+
+	printf( "Headless rendering of '%s' (%dx%d, %I64u frames)\n", file_name, width, height, frame_times.size() );
+	printf( "  frame time %0.3f ms on average (CPU %0.3f ms, GPU %0.3f ms), %0.3f ms at least\n", frame.avg, cpu.avg, gpu.avg, frame.min );
+
+	return EXIT_SUCCESS;
+}
+
+int BenchmarkCameraPath( const char * file_name, const int no_frames, const char * path_file_name, const char * json_file_name,
+	const bool headless, const int width, const int height )
+{
+	// the view and the animation of tutorial_1 unless a path is given
+	const Vector3 view_from( 150, -500, 200 );
+	const Vector3 view_at( 0, 0, 35 );
+	CameraPath path = CameraPath::Spin( view_from, view_at, deg2rad( 45.0f ), 1e-2f, no_frames );
+	if ( path_file_name && !path.Load( path_file_name ) )
+	{
+		return EXIT_FAILURE;
+	}
+
+	Rasterizer rasterizer( width, height, deg2rad( 45.0 ), view_from, view_at, 1.0f, 1000.0f );
+	if ( rasterizer.InitDeviceAndScene( file_name, headless ? max( no_frames, 1 ) : 0 ) != EXIT_SUCCESS )
+	{
+		printf( "Camera path benchmark: no OpenGL context could be created\n" );
+
+		return EXIT_FAILURE;
+	}
+	rasterizer.SetCameraPath( path, max( no_frames, 1 ) );
+	rasterizer.MainLoop();
+
+	const std::vector<FrameTime> & frame_times = rasterizer.frame_times();
+	if ( static_cast<int>( frame_times.size() ) < no_frames )
+	{
+		printf( "Camera path benchmark: only %I64u of %d frames were rendered\n", frame_times.size(), no_frames );
+
+		return EXIT_FAILURE;
+	}
+
+	const std::pair<const char *, double FrameTime::*> times[] = { { "cpu_ms", &FrameTime::cpu_ms }, { "gpu_ms", &FrameTime::gpu_ms },
+		{ "frame_ms", &FrameTime::frame_ms } };
+
+	std::string json = "{\n\t\"scene\": " + JsonString( file_name ) + ",\n\t\"path\": " + JsonString( path_file_name ? path_file_name : "spin" ) +
+		",\n\t\"width\": " + std::to_string( width ) + ",\n\t\"height\": " + std::to_string( height ) + ",\n\t\"frames\": " +
+		std::to_string( frame_times.size() ) + ",\n\t\"headless\": " + ( headless ? "true" : "false" );
+	for ( const auto & time : times )
+	{
+		const FrameTimeStatistics statistics = ComputeFrameTimeStatistics( frame_times, time.second );
+		char line[256];
+		snprintf( line, sizeof( line ), ",\n\t\"%s\": { \"min\": %0.4f, \"avg\": %0.4f, \"p95\": %0.4f, \"p99\": %0.4f }", time.first,
+			statistics.min, statistics.avg, statistics.p95, statistics.p99 );
+		json += line;
+	}
+	json += "\n}\n";
+
+	printf( "%s", json.c_str() );
+
+	if ( json_file_name )
+	{
+		FILE * file = fopen( json_file_name, "wt" );
+		if ( !file )
+		{
+			printf( "IO error: File '%s' cannot be written.\n", json_file_name );
+
+			return EXIT_FAILURE;
+		}
+		fputs( json.c_str(), file );
+		fclose( file );
+	}
+
+	return EXIT_SUCCESS;
+}
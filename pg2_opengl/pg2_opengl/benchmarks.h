@@ -0,0 +1,68 @@
+#ifndef BENCHMARKS_H_
+#define BENCHMARKS_H_
+
+/*! \fn int BenchmarkOBJLoading( const char * file_name, const int no_runs )
+\brief Measures the load time of the OBJ file \a file_name with LoadOBJ and with the original three pass LoadOBJThreePass.
+\param file_name full path to the OBJ file.
+\param no_runs number of repetitions of each loader, the best time is reported.
+*/
+int BenchmarkOBJLoading( const char * file_name, const int no_runs = 3 );
+
+/*! \fn int BenchmarkScanner( const int no_lines )
+\brief Compares sscanf with the hand-written scanners (ScanFloats, ScanIndexTriplet) on synthetic OBJ vertex and face lines.
+\param no_lines number of generated lines of each kind.
+*/
+int BenchmarkScanner( const int no_lines = 1000000 );
+
+/*! \fn int BenchmarkMaterialLookup( const int no_materials, const int no_groups )
+\brief Loads a generated OBJ file with many materials and groups and compares the hashed MaterialRegistry lookup
+with the original linear scan over the material names.
+\param no_materials number of materials in the generated MTL file.
+\param no_groups number of groups (with one triangle each) in the generated OBJ file.
+*/
+int BenchmarkMaterialLookup( const int no_materials = 10000, const int no_groups = 100000 );
+
+/*! \fn int BenchmarkNormalGeneration( const int no_triangles )
+\brief Measures the throughput of GenerateNormals on a generated height field with one and with all hardware threads
+and checks the normals against the analytic ones.
+\param no_triangles approximate number of triangles of the height field.
+*/
+int BenchmarkNormalGeneration( const int no_triangles = 10000000 );
+
+/*! \fn int BenchmarkLodSelection( const char * file_name )
+\brief Measures the cost of the level of detail generation when loading the OBJ file \a file_name and reports the number of triangles
+drawn with the levels selected by SelectLod when the camera moves away from the scene.
+\param file_name full path to the OBJ file.
+*/
+int BenchmarkLodSelection( const char * file_name );
+
+/*! \fn int BenchmarkConeCulling( const char * file_name, const int no_angles )
+\brief Reports the ratio of triangles rejected by the normal cones of the meshlets (IsMeshletBackFacing) and of all back-facing
+triangles while the camera orbits around the scene loaded from \a file_name, fails if a front-facing triangle is culled.
+\param no_angles number of camera positions along the orbit.
+*/
+int BenchmarkConeCulling( const char * file_name, const int no_angles = 24 );
+
+/*! \fn int BenchmarkOcclusionCulling( const int no_rooms, const int no_objects, const int no_frames )
+\brief Walks the camera through the first room of a generated corridor of rooms separated by walls with doors and reports
+the number of surfaces hidden by the OcclusionCuller and its time per frame, fails if a box in the first room is culled.
+\param no_objects number of small boxes in each room.
+*/
+int BenchmarkOcclusionCulling( const int no_rooms = 32, const int no_objects = 128, const int no_frames = 200 );
+
+/*! \fn int BenchmarkHeadlessRendering( const char * file_name, const int no_frames, const int width, const int height )
+\brief Renders the scene by the Rasterizer without a window (see Rasterizer::InitDeviceAndScene) and reports the times of
+\a no_frames frames drawn after the scene was fully loaded.
+*/
+int BenchmarkHeadlessRendering( const char * file_name, const int no_frames = 1000, const int width = 640, const int height = 480 );
+
+/*! \fn int BenchmarkCameraPath( const char * file_name, const int no_frames, const char * path_file_name, const char * json_file_name, const bool headless, const int width, const int height )
+\brief Replays the camera path (see CameraPath) in \a no_frames frames with vsync off once the scene is loaded and prints
+the minimum, average, 95th and 99th percentile of the CPU, GPU and whole frame times as JSON.
+\param path_file_name keys of the path, the model of tutorial_1 spins in front of its camera if NULL.
+\param json_file_name the JSON is also written to this file if not NULL.
+*/
+int BenchmarkCameraPath( const char * file_name, const int no_frames = 1000, const char * path_file_name = nullptr,
+	const char * json_file_name = nullptr, const bool headless = false, const int width = 640, const int height = 480 );
+
+#endif
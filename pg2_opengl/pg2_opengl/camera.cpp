@@ -44,6 +44,14 @@ void Camera::set_fov_y( const float fov_y )
 	fov_y_ = fov_y;
 }
 
+void Camera::set_view( const Vector3 view_from, const Vector3 view_at )
+{
+	view_from_ = view_from;
+	view_at_ = view_at;
+
+	Update( width_, height_ );
+}
+
 void Camera::Update(int widthN, int heightN)
 {
 	width_ = widthN;
@@ -29,6 +29,9 @@ public:
 
 	void set_fov_y( const float fov_y );
 
+	/* moves the camera and updates the view matrix */
+	void set_view( const Vector3 view_from, const Vector3 view_at );
+
 	void Update(int width, int height);
 
 	float aspect_ratio;
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "camerapath.h"
+#include "mappedfile.h"
+#include "scanner.h"
+#include "mymath.h"
+
+CameraPath CameraPath::Spin( const Vector3 & view_from, const Vector3 & view_at, const float start_angle, const float angle_step, const int no_frames )
+{
+	CameraPath path;
+	CameraKey key;
+	key.view_from = view_from;
+	key.view_at = view_at;
+
+	key.model_angle = start_angle;
+	path.keys_.push_back( key );
+	key.model_angle = start_angle + angle_step * std::max( no_frames - 1, 1 );
+	path.keys_.push_back( key );
+
+	return path;
+}
+
+bool CameraPath::Load( const char * file_name )
+{
+	MappedFile file( file_name );
+
+	if ( !file.is_open() )
+	{
+		printf( "IO error: File '%s' not found.\n", file_name );
+
+		return false;
+	}
+
+	std::vector<CameraKey> keys;
+	const char * end = file.end();
+	int line_number = 1;
+
+	for ( const char * p = file.data(); p < end; ++line_number )
+	{
+		const char * line_end = static_cast<const char *>( memchr( p, '\n', end - p ) );
+		if ( !line_end ) line_end = end;
+
+		const char * q = SkipSpaces( p, line_end );
+		if ( q < line_end && *q != '#' )
+		{
+			float values[7];
+			int no_values = 0;
+			q = SkipSpaces( ScanFloats( q, line_end, values, 7, no_values ), line_end );
+
+			if ( no_values != 7 || q != line_end )
+			{
+				printf( "Camera path error: Line %d of '%s' is not a key.\n", line_number, file_name );
+
+				return false;
+			}
+
+			CameraKey key;
+			key.view_from = Vector3( values[0], values[1], values[2] );
+			key.view_at = Vector3( values[3], values[4], values[5] );
+			key.model_angle = deg2rad( values[6] );
+			keys.push_back( key );
+		}
+
+		p = line_end + 1;
+	}
+
+	if ( keys.size() < 2 )
+	{
+		printf( "Camera path error: '%s' has less than two keys.\n", file_name );
+
+		return false;
+	}
+
+	keys_ = std::move( keys );
+
+	return true;
+}
+
+bool CameraPath::empty() const
+{
+	return keys_.empty();
+}
+
+CameraKey CameraPath::at( const int frame, const int no_frames ) const
+{
+	assert( !keys_.empty() );
+
+	if ( keys_.size() == 1 || no_frames < 2 )
+	{
+		return keys_.front();
+	}
+
+	const float t = std::min( std::max( frame, 0 ), no_frames - 1 ) * float( keys_.size() - 1 ) / ( no_frames - 1 );
+	const size_t i = std::min( static_cast<size_t>( t ), keys_.size() - 2 );
+	const float s = t - i;
+	const CameraKey & a = keys_[i];
+	const CameraKey & b = keys_[i + 1];
+
+	CameraKey key;
+	key.view_from = a.view_from * ( 1.0f - s ) + b.view_from * s;
+	key.view_at = a.view_at * ( 1.0f - s ) + b.view_at * s;
+	key.model_angle = a.model_angle * ( 1.0f - s ) + b.model_angle * s;
+
+	return key;
+}
@@ -0,0 +1,42 @@
+#ifndef CAMERA_PATH_H_
+#define CAMERA_PATH_H_
+
+#include "vector3.h"
+
+/*! \struct CameraKey
+\brief Pose of the camera and of the model in one key of a CameraPath.
+*/
+struct CameraKey
+{
+	Vector3 view_from;
+	Vector3 view_at;
+	float model_angle{ 0.0f }; /*!< Rotation of the model about the z axis (rad). */
+};
+
+/*! \class CameraPath
+\brief Camera and model poses replayed frame by frame, independently of the time, so that every run draws the same images.
+
+A path file has one key per line "from_x from_y from_z at_x at_y at_z angle" with the model angle in degrees, lines
+starting with # are comments. The keys are spread evenly over the frames and interpolated linearly.
+*/
+class CameraPath
+{
+public:
+	CameraPath() { }
+
+	/* fixed camera and the model spinning by angle_step per frame, i.e. the animation of Rasterizer::MainLoop */
+	static CameraPath Spin( const Vector3 & view_from, const Vector3 & view_at, const float start_angle, const float angle_step, const int no_frames );
+
+	/* false if the file cannot be read or contains less than two keys */
+	bool Load( const char * file_name );
+
+	bool empty() const;
+
+	/* pose of the given frame out of no_frames */
+	CameraKey at( const int frame, const int no_frames ) const;
+
+private:
+	std::vector<CameraKey> keys_;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "culling.h"
+
+Frustum::Frustum( const Matrix4x4 & clip_from_object )
+{
+	const Matrix4x4 & m = clip_from_object;
+
+	// plane i is the fourth row plus or minus the (i / 2)-th row
+	for ( int i = 0; i < 6; ++i )
+	{
+		const int row = i / 2;
+		const float sign = ( i % 2 == 0 ) ? 1.0f : -1.0f;
+
+		normals[i] = Vector3( m.get( 3, 0 ) + sign * m.get( row, 0 ), m.get( 3, 1 ) + sign * m.get( row, 1 ),
+			m.get( 3, 2 ) + sign * m.get( row, 2 ) );
+		distances[i] = m.get( 3, 3 ) + sign * m.get( row, 3 );
+
+		const float length = normals[i].Normalize();
+		if ( length > 0.0f )
+		{
+			distances[i] /= length;
+		}
+	}
+}
+
+bool Frustum::IsSphereVisible( const Vector3 & center, const float radius ) const
+{
+	for ( int i = 0; i < 6; ++i )
+	{
+		if ( normals[i].DotProduct( center ) + distances[i] < -radius )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Frustum::IsBoxVisible( const Vector3 & lower, const Vector3 & upper ) const
+{
+	for ( int i = 0; i < 6; ++i )
+	{
+		// corner of the box farthest along the normal
+		const Vector3 & n = normals[i];
+		const Vector3 p( ( n.x >= 0.0f ) ? upper.x : lower.x, ( n.y >= 0.0f ) ? upper.y : lower.y, ( n.z >= 0.0f ) ? upper.z : lower.z );
+
+		if ( n.DotProduct( p ) + distances[i] < 0.0f )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool IsMeshletBackFacing( const Meshlet & meshlet, const Vector3 & eye )
+{
+	if ( meshlet.cone_cutoff >= 1.0f )
+	{
+		return false;
+	}
+
+	// the direction from the camera to the apex lies within the cone around the axis, compared without normalization
+	const Vector3 d = meshlet.cone_apex - eye;
+
+	return d.DotProduct( meshlet.cone_axis ) >= meshlet.cone_cutoff * d.L2Norm();
+}
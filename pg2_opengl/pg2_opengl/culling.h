@@ -0,0 +1,54 @@
+#ifndef CULLING_H_
+#define CULLING_H_
+
+#include "vector3.h"
+#include "matrix4x4.h"
+#include "surface.h"
+
+/*! \struct Frustum
+\brief Six planes bounding the view volume, extracted from the clip space transformation (Gribb and Hartmann,
+"Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix").
+
+The planes live in the space the matrix transforms from, so bounds in object space are tested against the frustum
+of the model-view-projection matrix without being transformed.
+*/
+struct Frustum
+{
+	Vector3 normals[6]; /*!< Unit normals of the left, right, bottom, top, near and far planes pointing inside. */
+	float distances[6] = { 0.0f }; /*!< Points p with normals[i] . p + distances[i] >= 0 lie inside of the i-th plane. */
+
+	Frustum() { }
+
+	/*! Frustum of the OpenGL clip space -w <= x, y, z <= w of the given transformation. */
+	explicit Frustum( const Matrix4x4 & clip_from_object );
+
+	/*! False if the sphere lies completely outside of some plane. */
+	bool IsSphereVisible( const Vector3 & center, const float radius ) const;
+
+	/*! False if the axis aligned box lies completely outside of some plane. */
+	bool IsBoxVisible( const Vector3 & lower, const Vector3 & upper ) const;
+};
+
+/*! \fn bool IsMeshletBackFacing( const Meshlet & meshlet, const Vector3 & eye )
+\brief True if all triangles of the meshlet face away from the camera at \a eye (in object space), see Meshlet.
+*/
+bool IsMeshletBackFacing( const Meshlet & meshlet, const Vector3 & eye );
+
+/*! \struct CullingStatistics
+\brief Numbers of surfaces and meshlets submitted and rejected in a single frame.
+*/
+struct CullingStatistics
+{
+	int visible_surfaces{ 0 }; /*!< Surfaces drawn in the frame. */
+	int draw_calls{ 0 }; /*!< glDrawElementsBaseVertex and glMultiDrawElementsBaseVertex calls. */
+	int culled_surfaces{ 0 }; /*!< Surfaces outside of the view frustum. */
+	int visible_meshlets{ 0 }; /*!< Meshlets drawn in the frame. */
+	int culled_meshlets{ 0 }; /*!< Meshlets of the visible surfaces facing away from the camera. */
+	size_t visible_triangles{ 0 }; /*!< Triangles of the drawn levels of detail and meshlets. */
+	size_t culled_triangles{ 0 }; /*!< Triangles of the back-facing meshlets. */
+	int occluded_surfaces{ 0 }; /*!< Surfaces hidden behind the occluders. */
+	int occluders{ 0 }; /*!< Surfaces drawn into the occlusion buffer. */
+	double occlusion_ms{ 0.0 }; /*!< Time spent by the occlusion culling on the worker threads. */
+};
+
+#endif
@@ -14,3 +14,21 @@ void SetMatrix4x4( const GLuint program, const GLfloat * data, const char * matr
 		glUniformMatrix4fv( location, 1, GL_TRUE, data );
 	}
 }
+
+void SetVertexFormat( const VertexAttribute * attributes, const int no_attributes, const GLsizei stride )
+{
+	for ( int i = 0; i < no_attributes; ++i )
+	{
+		const VertexAttribute & attribute = attributes[i];
+
+		if ( attribute.integer )
+		{
+			glVertexAttribIPointer( attribute.location, attribute.size, attribute.type, stride, ( void * )attribute.offset );
+		}
+		else
+		{
+			glVertexAttribPointer( attribute.location, attribute.size, attribute.type, attribute.normalized, stride, ( void * )attribute.offset );
+		}
+		glEnableVertexAttribArray( attribute.location );
+	}
+}
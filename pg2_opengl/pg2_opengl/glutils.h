@@ -1,6 +1,13 @@
 #ifndef GL_UTILS_H_
 #define GL_UTILS_H_
 
+#include "vertex.h"
+
 void SetMatrix4x4( const GLuint program, const GLfloat * data, const char * matrix_name );
 
+/*! \fn void SetVertexFormat( const VertexAttribute * attributes, const int no_attributes, const GLsizei stride )
+\brief Sets and enables vertex attribute pointers of the currently bound VAO and VBO.
+*/
+void SetVertexFormat( const VertexAttribute * attributes, const int no_attributes, const GLsizei stride );
+
 #endif
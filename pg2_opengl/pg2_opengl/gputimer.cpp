@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "gputimer.h"
+
+GpuTimer::~GpuTimer()
+{
+	assert( !initialized_ ); // Release needs the context, so it cannot be left to the destructor
+}
+
+void GpuTimer::Init()
+{
+	glGenQueries( kLatency * 2 * kMaxPasses, &queries_[0][0] );
+	frame_.name = "frame";
+	initialized_ = true;
+}
+
+void GpuTimer::Release()
+{
+	if ( !initialized_ ) return;
+
+	glDeleteQueries( kLatency * 2 * kMaxPasses, &queries_[0][0] );
+	for ( Frame & frame : frames_ )
+	{
+		frame = Frame();
+	}
+	initialized_ = false;
+}
+
+size_t GpuTimer::BeginFrame()
+{
+	assert( !in_pass_ );
+
+	const int slot = static_cast<int>( no_frames_ % kLatency );
+	if ( frames_[slot].pending )
+	{
+		Resolve( slot );
+	}
+
+	frames_[slot].number = no_frames_;
+	frames_[slot].passes.clear();
+	frames_[slot].pending = initialized_;
+
+	return no_frames_++;
+}
+
+void GpuTimer::BeginPass( const char * name )
+{
+	assert( !in_pass_ );
+
+	const int slot = static_cast<int>( ( no_frames_ - 1 ) % kLatency );
+	Frame & frame = frames_[slot];
+	if ( !frame.pending || frame.passes.size() >= size_t( kMaxPasses ) )
+	{
+		return;
+	}
+
+	// a handful of passes, linear search is fine
+	int pass = 0;
+	while ( pass < static_cast<int>( passes_.size() ) && passes_[pass].name != name ) ++pass;
+	if ( pass == static_cast<int>( passes_.size() ) )
+	{
+		passes_.push_back( Pass() );
+		passes_.back().name = name;
+	}
+
+	glQueryCounter( queries_[slot][2 * frame.passes.size()], GL_TIMESTAMP );
+	frame.passes.push_back( pass );
+	in_pass_ = true;
+}
+
+void GpuTimer::EndPass()
+{
+	if ( !in_pass_ ) return;
+
+	const int slot = static_cast<int>( ( no_frames_ - 1 ) % kLatency );
+	glQueryCounter( queries_[slot][2 * frames_[slot].passes.size() - 1], GL_TIMESTAMP );
+	in_pass_ = false;
+}
+
+void GpuTimer::Flush()
+{
+	assert( !in_pass_ );
+
+	for ( size_t number = no_frames_ - std::min( no_frames_, size_t( kLatency ) ); number < no_frames_; ++number )
+	{
+		if ( frames_[number % kLatency].pending )
+		{
+			Resolve( static_cast<int>( number % kLatency ) );
+		}
+	}
+}
+
+const std::vector<GpuTimer::Pass> & GpuTimer::passes() const
+{
+	return passes_;
+}
+
+const GpuTimer::Pass & GpuTimer::frame() const
+{
+	return frame_;
+}
+
+void GpuTimer::Resolve( const int slot )
+{
+	Frame & frame = frames_[slot];
+	frame.pending = false;
+	if ( frame.passes.empty() ) return;
+
+	GLuint64 first = 0, last = 0;
+	for ( size_t k = 0; k < frame.passes.size(); ++k )
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v( queries_[slot][2 * k], GL_QUERY_RESULT, &begin );
+		glGetQueryObjectui64v( queries_[slot][2 * k + 1], GL_QUERY_RESULT, &end );
+		AddSample( passes_[frame.passes[k]], ( end - begin ) * 1e-6 );
+
+		if ( k == 0 ) first = begin;
+		last = end;
+	}
+
+	AddSample( frame_, ( last - first ) * 1e-6 );
+
+	if ( on_frame_resolved )
+	{
+		on_frame_resolved( frame.number, frame_.last_ms );
+	}
+}
+
+void GpuTimer::AddSample( Pass & pass, const double ms )
+{
+	if ( pass.samples.empty() )
+	{
+		pass.samples.resize( kNoAverageFrames );
+	}
+
+	double & sample = pass.samples[pass.no_samples % kNoAverageFrames];
+	pass.sum_ms += ms - ( ( pass.no_samples >= kNoAverageFrames ) ? sample : 0.0 );
+	sample = ms;
+	++pass.no_samples;
+
+	pass.last_ms = ms;
+	pass.average_ms = pass.sum_ms / std::min( pass.no_samples, size_t( kNoAverageFrames ) );
+}
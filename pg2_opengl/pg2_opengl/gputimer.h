@@ -0,0 +1,84 @@
+#ifndef GPU_TIMER_H_
+#define GPU_TIMER_H_
+
+/*! \class GpuTimer
+\brief Measures GPU times of named passes of the frame by timestamp queries.
+
+Each pass is bracketed by two glQueryCounter( GL_TIMESTAMP ) queries. The queries of a frame are read back kLatency
+frames later when their slot of the ring is reused, i.e. when the GPU has long finished them, so that the render thread
+never waits. The results are kept as rolling averages over the last kNoAverageFrames frames in which the pass ran.
+Passes must not overlap, they are registered on the fly by their names.
+*/
+class GpuTimer
+{
+public:
+	static const int kLatency = 4; // frames in flight
+	static const int kMaxPasses = 16; // per frame
+	static const int kNoAverageFrames = 64;
+
+	/*! \struct Pass
+	\brief Times of one named pass (or of the whole frame).
+	*/
+	struct Pass
+	{
+		std::string name;
+		double last_ms{ 0.0 }; /*!< Time of the last resolved frame. */
+		double average_ms{ 0.0 }; /*!< Rolling average. */
+
+		std::vector<double> samples; // ring of the last kNoAverageFrames times
+		size_t no_samples{ 0 };
+		double sum_ms{ 0.0 };
+	};
+
+	GpuTimer() { }
+	~GpuTimer();
+
+	/* creates the queries, needs the current GL context */
+	void Init();
+
+	/* deletes the queries, pending results are lost */
+	void Release();
+
+	/* resolves the frame issued kLatency frames ago and returns the number of the frame being started */
+	size_t BeginFrame();
+
+	/* starts the pass, ignored once kMaxPasses passes were issued in the frame */
+	void BeginPass( const char * name );
+	void EndPass();
+
+	/* waits for the frames in flight and resolves them */
+	void Flush();
+
+	const std::vector<Pass> & passes() const;
+
+	/* from the start of the first pass to the end of the last one */
+	const Pass & frame() const;
+
+	/* called on the render thread with the number and the GPU time of each resolved frame */
+	std::function<void( const size_t frame, const double frame_ms )> on_frame_resolved;
+
+private:
+	struct Frame
+	{
+		size_t number{ 0 };
+		std::vector<int> passes; // pass of each pair of queries
+		bool pending{ false };
+	};
+
+	void Resolve( const int slot );
+
+	static void AddSample( Pass & pass, const double ms );
+
+	GLuint queries_[kLatency][2 * kMaxPasses] = { { 0 } }; // begin and end timestamps of the passes of each slot
+	Frame frames_[kLatency];
+	std::vector<Pass> passes_;
+	Pass frame_;
+	size_t no_frames_{ 0 };
+	bool in_pass_{ false }; // the current pass was issued (BeginPass was not ignored)
+	bool initialized_{ false };
+
+	GpuTimer( const GpuTimer & ) = delete;
+	GpuTimer & operator=( const GpuTimer & ) = delete;
+};
+
+#endif
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "headlesscontext.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+// the subset of egl.h, eglext.h and osmesa.h used below, the headers are not needed to build
+typedef void * ( APIENTRYP PFNEGLGETPROCADDRESS )( const char * name );
+typedef void * ( APIENTRYP PFNEGLGETPLATFORMDISPLAYEXT )( unsigned int platform, void * native_display, const int * attribs );
+typedef void * ( APIENTRYP PFNEGLGETDISPLAY )( void * native_display );
+typedef unsigned int ( APIENTRYP PFNEGLINITIALIZE )( void * display, int * major, int * minor );
+typedef const char * ( APIENTRYP PFNEGLQUERYSTRING )( void * display, int name );
+typedef unsigned int ( APIENTRYP PFNEGLBINDAPI )( unsigned int api );
+typedef unsigned int ( APIENTRYP PFNEGLCHOOSECONFIG )( void * display, const int * attribs, void ** configs, int config_size, int * no_configs );
+typedef void * ( APIENTRYP PFNEGLCREATECONTEXT )( void * display, void * config, void * share_context, const int * attribs );
+typedef unsigned int ( APIENTRYP PFNEGLMAKECURRENT )( void * display, void * draw, void * read, void * context );
+typedef unsigned int ( APIENTRYP PFNEGLDESTROYCONTEXT )( void * display, void * context );
+typedef unsigned int ( APIENTRYP PFNEGLTERMINATE )( void * display );
+
+static const unsigned int kEGLPlatformSurfacelessMesa = 0x31DD; // EGL_PLATFORM_SURFACELESS_MESA
+static const int kEGLExtensions = 0x3055;
+static const int kEGLRenderableType = 0x3040;
+static const int kEGLSurfaceType = 0x3033;
+static const int kEGLOpenGLBit = 0x0008;
+static const int kEGLNone = 0x3038;
+static const unsigned int kEGLOpenGLAPI = 0x30A2;
+static const int kEGLContextMajorVersion = 0x3098;
+static const int kEGLContextMinorVersion = 0x30FB;
+static const int kEGLContextOpenGLProfileMask = 0x30FD;
+static const int kEGLContextOpenGLCoreProfileBit = 0x0001;
+
+typedef void * ( APIENTRYP PFNOSMESACREATECONTEXTATTRIBS )( const int * attribs, void * share_list );
+typedef unsigned char ( APIENTRYP PFNOSMESAMAKECURRENT )( void * context, void * buffer, unsigned int type, int width, int height );
+typedef void ( APIENTRYP PFNOSMESADESTROYCONTEXT )( void * context );
+typedef void * ( APIENTRYP PFNOSMESAGETPROCADDRESS )( const char * name );
+
+static const int kOSMesaFormat = 0x22;
+static const int kOSMesaRGBA = 0x1908;
+static const int kOSMesaDepthBits = 0x30;
+static const int kOSMesaStencilBits = 0x31;
+static const int kOSMesaProfile = 0x33;
+static const int kOSMesaCoreProfile = 0x34;
+static const int kOSMesaContextMajorVersion = 0x36;
+static const int kOSMesaContextMinorVersion = 0x37;
+
+/* loader of GL functions of the current headless context */
+static void * ( APIENTRYP proc_address )( const char * name ) = nullptr;
+
+static void * LoadLibraryByName( const char * const names[], const int no_names )
+{
+	for ( int i = 0; i < no_names; ++i )
+	{
+#ifdef _WIN32
+		void * library = LoadLibraryA( names[i] );
+#else
+		void * library = dlopen( names[i], RTLD_NOW | RTLD_LOCAL );
+#endif
+		if ( library )
+		{
+			return library;
+		}
+	}
+
+	return nullptr;
+}
+
+static void * LibrarySymbol( void * library, const char * name )
+{
+#ifdef _WIN32
+	return reinterpret_cast<void *>( ::GetProcAddress( static_cast<HMODULE>( library ), name ) );
+#else
+	return dlsym( library, name );
+#endif
+}
+
+static void FreeLibraryHandle( void * library )
+{
+#ifdef _WIN32
+	FreeLibrary( static_cast<HMODULE>( library ) );
+#else
+	dlclose( library );
+#endif
+}
+
+static bool HasExtension( const char * extensions, const char * name )
+{
+	const size_t length = strlen( name );
+
+	for ( const char * p = extensions ? strstr( extensions, name ) : nullptr; p; p = strstr( p + length, name ) )
+	{
+		if ( ( p == extensions || p[-1] == ' ' ) && ( p[length] == ' ' || p[length] == '\0' ) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	Release();
+}
+
+bool HeadlessContext::Create( const int major, const int minor, const int width, const int height )
+{
+	Release();
+
+	if ( CreateEGL( major, minor ) || CreateOSMesa( major, minor, width, height ) )
+	{
+		return true;
+	}
+
+	printf( "Headless context: neither surfaceless EGL nor OSMesa can create an OpenGL %d.%d core context.\n", major, minor );
+
+	return false;
+}
+
+bool HeadlessContext::CreateEGL( const int major, const int minor )
+{
+#ifdef _WIN32
+	const char * const names[] = { "libEGL.dll" };
+#else
+	const char * const names[] = { "libEGL.so.1", "libEGL.so" };
+#endif
+	library_ = LoadLibraryByName( names, sizeof( names ) / sizeof( *names ) );
+	if ( !library_ )
+	{
+		return false;
+	}
+
+	auto eglGetProcAddress = reinterpret_cast<PFNEGLGETPROCADDRESS>( LibrarySymbol( library_, "eglGetProcAddress" ) );
+	auto eglGetDisplay = reinterpret_cast<PFNEGLGETDISPLAY>( LibrarySymbol( library_, "eglGetDisplay" ) );
+	auto eglInitialize = reinterpret_cast<PFNEGLINITIALIZE>( LibrarySymbol( library_, "eglInitialize" ) );
+	auto eglQueryString = reinterpret_cast<PFNEGLQUERYSTRING>( LibrarySymbol( library_, "eglQueryString" ) );
+	auto eglBindAPI = reinterpret_cast<PFNEGLBINDAPI>( LibrarySymbol( library_, "eglBindAPI" ) );
+	auto eglChooseConfig = reinterpret_cast<PFNEGLCHOOSECONFIG>( LibrarySymbol( library_, "eglChooseConfig" ) );
+	auto eglCreateContext = reinterpret_cast<PFNEGLCREATECONTEXT>( LibrarySymbol( library_, "eglCreateContext" ) );
+	auto eglMakeCurrent = reinterpret_cast<PFNEGLMAKECURRENT>( LibrarySymbol( library_, "eglMakeCurrent" ) );
+	auto eglTerminate = reinterpret_cast<PFNEGLTERMINATE>( LibrarySymbol( library_, "eglTerminate" ) );
+
+	if ( !eglGetProcAddress || !eglGetDisplay || !eglInitialize || !eglQueryString || !eglBindAPI || !eglChooseConfig ||
+		!eglCreateContext || !eglMakeCurrent || !eglTerminate )
+	{
+		Release();
+		return false;
+	}
+
+	// the surfaceless platform needs no X11 or Wayland display, the default display is the fallback
+	if ( HasExtension( eglQueryString( nullptr, kEGLExtensions ), "EGL_MESA_platform_surfaceless" ) )
+	{
+		auto eglGetPlatformDisplayEXT = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXT>( eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+		if ( eglGetPlatformDisplayEXT )
+		{
+			display_ = eglGetPlatformDisplayEXT( kEGLPlatformSurfacelessMesa, nullptr, nullptr );
+		}
+	}
+	if ( !display_ )
+	{
+		display_ = eglGetDisplay( nullptr );
+	}
+
+	int egl_major = 0, egl_minor = 0;
+	if ( !display_ || !eglInitialize( display_, &egl_major, &egl_minor ) )
+	{
+		display_ = nullptr;
+		Release();
+		return false;
+	}
+
+	if ( !HasExtension( eglQueryString( display_, kEGLExtensions ), "EGL_KHR_surfaceless_context" ) || !eglBindAPI( kEGLOpenGLAPI ) )
+	{
+		eglTerminate( display_ );
+		display_ = nullptr;
+		Release();
+		return false;
+	}
+
+	// any config rendering by OpenGL will do as the context never gets a surface
+	const int config_attribs[] = { kEGLRenderableType, kEGLOpenGLBit, kEGLSurfaceType, 0, kEGLNone };
+	void * config = nullptr;
+	int no_configs = 0;
+	eglChooseConfig( display_, config_attribs, &config, 1, &no_configs );
+
+	for ( int version = major * 10 + minor; version >= 45 && !context_; --version )
+	{
+		const int context_attribs[] = { kEGLContextMajorVersion, version / 10, kEGLContextMinorVersion, version % 10,
+			kEGLContextOpenGLProfileMask, kEGLContextOpenGLCoreProfileBit, kEGLNone };
+		context_ = eglCreateContext( display_, ( no_configs > 0 ) ? config : nullptr, nullptr, context_attribs );
+	}
+
+	if ( !context_ || !eglMakeCurrent( display_, nullptr, nullptr, context_ ) )
+	{
+		Release();
+		return false;
+	}
+
+	proc_address = eglGetProcAddress;
+	api_ = "surfaceless EGL";
+
+	return true;
+}
+
+bool HeadlessContext::CreateOSMesa( const int major, const int minor, const int width, const int height )
+{
+#ifdef _WIN32
+	const char * const names[] = { "osmesa.dll", "libOSMesa.dll", "OSMesa.dll" };
+#else
+	const char * const names[] = { "libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so" };
+#endif
+	library_ = LoadLibraryByName( names, sizeof( names ) / sizeof( *names ) );
+	if ( !library_ )
+	{
+		return false;
+	}
+
+	auto OSMesaCreateContextAttribs = reinterpret_cast<PFNOSMESACREATECONTEXTATTRIBS>( LibrarySymbol( library_, "OSMesaCreateContextAttribs" ) );
+	auto OSMesaMakeCurrent = reinterpret_cast<PFNOSMESAMAKECURRENT>( LibrarySymbol( library_, "OSMesaMakeCurrent" ) );
+	auto OSMesaGetProcAddress = reinterpret_cast<PFNOSMESAGETPROCADDRESS>( LibrarySymbol( library_, "OSMesaGetProcAddress" ) );
+
+	if ( !OSMesaCreateContextAttribs || !OSMesaMakeCurrent || !OSMesaGetProcAddress )
+	{
+		Release();
+		return false;
+	}
+
+	for ( int version = major * 10 + minor; version >= 45 && !context_; --version )
+	{
+		const int attribs[] = { kOSMesaFormat, kOSMesaRGBA, kOSMesaDepthBits, 24, kOSMesaStencilBits, 8,
+			kOSMesaProfile, kOSMesaCoreProfile, kOSMesaContextMajorVersion, version / 10, kOSMesaContextMinorVersion, version % 10, 0 };
+		context_ = OSMesaCreateContextAttribs( attribs, nullptr );
+	}
+
+	buffer_.resize( size_t( width ) * height * 4 );
+	if ( !context_ || !OSMesaMakeCurrent( context_, buffer_.data(), GL_UNSIGNED_BYTE, width, height ) )
+	{
+		Release();
+		return false;
+	}
+
+	proc_address = OSMesaGetProcAddress;
+	api_ = "OSMesa";
+
+	return true;
+}
+
+void HeadlessContext::Release()
+{
+	if ( library_ && context_ )
+	{
+		if ( display_ )
+		{
+			auto eglMakeCurrent = reinterpret_cast<PFNEGLMAKECURRENT>( LibrarySymbol( library_, "eglMakeCurrent" ) );
+			auto eglDestroyContext = reinterpret_cast<PFNEGLDESTROYCONTEXT>( LibrarySymbol( library_, "eglDestroyContext" ) );
+			eglMakeCurrent( display_, nullptr, nullptr, nullptr );
+			eglDestroyContext( display_, context_ );
+		}
+		else
+		{
+			auto OSMesaDestroyContext = reinterpret_cast<PFNOSMESADESTROYCONTEXT>( LibrarySymbol( library_, "OSMesaDestroyContext" ) );
+			OSMesaDestroyContext( context_ );
+		}
+	}
+
+	if ( library_ && display_ )
+	{
+		auto eglTerminate = reinterpret_cast<PFNEGLTERMINATE>( LibrarySymbol( library_, "eglTerminate" ) );
+		eglTerminate( display_ );
+	}
+
+	if ( library_ )
+	{
+		FreeLibraryHandle( library_ );
+	}
+
+	library_ = nullptr;
+	display_ = nullptr;
+	context_ = nullptr;
+	std::vector<unsigned char>().swap( buffer_ );
+	api_ = "none";
+	proc_address = nullptr;
+}
+
+bool HeadlessContext::is_created() const
+{
+	return context_ != nullptr;
+}
+
+const char * HeadlessContext::api() const
+{
+	return api_;
+}
+
+void * HeadlessContext::GetProcAddress( const char * name )
+{
+	return proc_address ? proc_address( name ) : nullptr;
+}
@@ -0,0 +1,47 @@
+#ifndef HEADLESS_CONTEXT_H_
+#define HEADLESS_CONTEXT_H_
+
+/*! \class HeadlessContext
+\brief OpenGL core profile context without any window, display or GLFW.
+
+The context is created by surfaceless EGL (EGL_MESA_platform_surfaceless with EGL_KHR_surfaceless_context,
+e.g. Mesa's llvmpipe on machines without a GPU) and by OSMesa as the fallback. Both libraries are loaded at
+runtime, so neither is needed to build or to run the windowed application. The context has no default
+framebuffer (OSMesa renders into a private buffer nobody reads), all drawing goes to framebuffer objects.
+*/
+class HeadlessContext
+{
+public:
+	HeadlessContext() { }
+	~HeadlessContext();
+
+	/* creates the context of the highest version from major.minor down to 4.5 and makes it current
+	on the calling thread, returns false if neither API is available */
+	bool Create( const int major, const int minor, const int width, const int height );
+
+	/* destroys the context and unloads the library */
+	void Release();
+
+	bool is_created() const;
+
+	/* name of the API which created the context */
+	const char * api() const;
+
+	/* address of a GL function of the current headless context, the loader of gladLoadGLLoader */
+	static void * GetProcAddress( const char * name );
+
+private:
+	bool CreateEGL( const int major, const int minor );
+	bool CreateOSMesa( const int major, const int minor, const int width, const int height );
+
+	void * library_{ nullptr }; // libEGL or OSMesa
+	void * display_{ nullptr }; // EGLDisplay
+	void * context_{ nullptr }; // EGLContext or OSMesaContext
+	std::vector<unsigned char> buffer_; // colour buffer of OSMesa
+	const char * api_{ "none" };
+
+	HeadlessContext( const HeadlessContext & ) = delete;
+	HeadlessContext & operator=( const HeadlessContext & ) = delete;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile( const char * file_name )
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA( file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+	{
+		return;
+	}
+	file_ = file;
+
+	LARGE_INTEGER file_size;
+	if ( !GetFileSizeEx( file, &file_size ) )
+	{
+		return;
+	}
+	size_ = static_cast<size_t>( file_size.QuadPart );
+	is_open_ = true;
+
+	if ( size_ > 0 ) // zero-length files cannot be mapped
+	{
+		mapping_ = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+		if ( mapping_ != NULL )
+		{
+			data_ = static_cast<const char *>( MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 ) );
+		}
+		if ( data_ == NULL )
+		{
+			size_ = 0;
+			is_open_ = false;
+		}
+	}
+#else
+	file_ = open( file_name, O_RDONLY );
+	if ( file_ < 0 )
+	{
+		return;
+	}
+
+	struct stat file_stat;
+	if ( fstat( file_, &file_stat ) != 0 )
+	{
+		return;
+	}
+	size_ = static_cast<size_t>( file_stat.st_size );
+	is_open_ = true;
+
+	if ( size_ > 0 ) // zero-length files cannot be mapped
+	{
+		void * view = mmap( NULL, size_, PROT_READ, MAP_PRIVATE, file_, 0 );
+		if ( view == MAP_FAILED )
+		{
+			size_ = 0;
+			is_open_ = false;
+		}
+		else
+		{
+			madvise( view, size_, MADV_SEQUENTIAL );
+			data_ = static_cast<const char *>( view );
+		}
+	}
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if ( data_ )
+	{
+		UnmapViewOfFile( data_ );
+	}
+	if ( mapping_ )
+	{
+		CloseHandle( mapping_ );
+	}
+	if ( file_ )
+	{
+		CloseHandle( file_ );
+	}
+	mapping_ = nullptr;
+	file_ = nullptr;
+#else
+	if ( data_ )
+	{
+		munmap( const_cast<char *>( data_ ), size_ );
+	}
+	if ( file_ >= 0 )
+	{
+		close( file_ );
+	}
+	file_ = -1;
+#endif
+	data_ = nullptr;
+	size_ = 0;
+	is_open_ = false;
+}
+
+bool MappedFile::is_open() const
+{
+	return is_open_;
+}
+
+const char * MappedFile::data() const
+{
+	return data_;
+}
+
+const char * MappedFile::end() const
+{
+	return data_ + size_;
+}
+
+size_t MappedFile::size() const
+{
+	return size_;
+}
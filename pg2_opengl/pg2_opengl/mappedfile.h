@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+/*! \class MappedFile
+\brief Read-only memory mapped view of a whole file.
+
+The content is read straight from the page cache, i.e. there is no heap copy and
+the data are NOT terminated by NULL. Use data() and end() to delimit the content.
+*/
+class MappedFile
+{
+public:
+	MappedFile( const char * file_name );
+	~MappedFile();
+
+	/* true if the file was opened (empty files are open but have no data) */
+	bool is_open() const;
+
+	const char * data() const;
+	const char * end() const;
+	size_t size() const;
+
+private:
+	const char * data_{ nullptr }; // first byte of the view
+	size_t size_{ 0 }; // size of the view (bytes)
+	bool is_open_{ false };
+
+#ifdef _WIN32
+	void * file_{ nullptr }; // HANDLE of the file
+	void * mapping_{ nullptr }; // HANDLE of the file mapping object
+#else
+	int file_{ -1 }; // file descriptor
+#endif
+
+	MappedFile( const MappedFile & ) = delete;
+	MappedFile & operator=( const MappedFile & ) = delete;
+};
+
+#endif
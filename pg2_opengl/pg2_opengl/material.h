@@ -154,6 +154,8 @@ struct GLMaterial
 	Color3f specular; //3 * 4B
 	GLbyte pad2[4]; // + 4 B = 16 B
 	GLuint64 tex_diffuse_handle{ 0 }; // 1 * 8 B
+	GLuint64 tex_opacity_handle{ 0 }; // + 8 B = 16 B, single channel (GL_R8 or GL_R16)
+	GLuint64 tex_normal_handle{ 0 }; // 1 * 8 B, tangent space normal map
 	GLbyte pad3[8]; // + 8 B = 16 B
 };
 #pragma pack( pop )
@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "materialregistry.h"
+
+MaterialRegistry::MaterialRegistry( std::vector<Material *> & materials ) : materials_( materials )
+{
+	indices_.reserve( materials_.size() );
+
+	for ( size_t i = 0; i < materials_.size(); ++i )
+	{
+		indices_.emplace( materials_[i]->name(), static_cast<int>( i ) ); // the first of the same names wins
+	}
+}
+
+bool MaterialRegistry::Add( Material * material )
+{
+	const int index = static_cast<int>( materials_.size() );
+
+	if ( !indices_.emplace( material->name(), index ).second )
+	{
+		return false;
+	}
+
+	material->material_index = index;
+	materials_.push_back( material );
+
+	return true;
+}
+
+int MaterialRegistry::Find( const std::string & material_name ) const
+{
+	const auto it = indices_.find( material_name );
+
+	return ( it != indices_.end() ) ? it->second : -1;
+}
+
+Material * MaterialRegistry::Get( const std::string & material_name ) const
+{
+	const int index = Find( material_name );
+
+	return ( index >= 0 ) ? materials_[index] : nullptr;
+}
+
+size_t MaterialRegistry::size() const
+{
+	return materials_.size();
+}
@@ -0,0 +1,39 @@
+#ifndef MATERIAL_REGISTRY_H_
+#define MATERIAL_REGISTRY_H_
+
+#include <unordered_map>
+
+#include "material.h"
+
+/*! \class MaterialRegistry
+\brief Hashed name to index map over an array of materials, shared by LoadMTL and LoadOBJ.
+
+Materials are appended to the array through Add which also sets their material_index,
+so the index of a material is its position in the array.
+*/
+class MaterialRegistry
+{
+public:
+	/* indexes the materials already present in the array */
+	MaterialRegistry( std::vector<Material *> & materials );
+
+	/* appends the material unless a material of the same name is already registered, returns false in that case */
+	bool Add( Material * material );
+
+	/* returns the index of the material of the given name or -1 */
+	int Find( const std::string & material_name ) const;
+
+	/* returns the material of the given name or nullptr */
+	Material * Get( const std::string & material_name ) const;
+
+	size_t size() const;
+
+private:
+	std::vector<Material *> & materials_;
+	std::unordered_map<std::string, int> indices_;
+
+	MaterialRegistry( const MaterialRegistry & ) = delete;
+	MaterialRegistry & operator=( const MaterialRegistry & ) = delete;
+};
+
+#endif
@@ -0,0 +1,473 @@
+#include "pch.h"
+#include "meshcache.h"
+#include "objloader.h"
+#include "mymath.h"
+#include "utils.h"
+#include "meshlets.h"
+#include "profiler.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+static const char kMeshCacheMagic[4] = { 'P', 'G', '2', 'C' };
+static const unsigned int kMeshCacheVersion = 6; // increase whenever the layout below or the Vertex structure changes
+
+/*
+layout of the cache file:
+
+header: magic, version, key, mtl_key, sizeof( Vertex ), sizeof( Meshlet )
+material libraries: count, paths
+materials: count, for each: name, colors, scalars, shader, texture paths of all slots
+surfaces: count, for each: name, material index (-1 = none), number of vertices, number of triangles, raw vertices,
+	number of meshlets, either the vertex indices (no meshlets) or raw meshlets, number of meshlet vertices, meshlet vertices
+	and 8-bit local indices of all triangles (the vertex indices are unpacked from them) followed by the closed flag,
+	number of levels of detail, for each: error, number of triangles, vertex indices
+*/
+
+/* sequential writer of the binary cache */
+class CacheWriter
+{
+public:
+	CacheWriter( FILE * file ) : file_( file ) { }
+
+	void Write( const void * data, const size_t size )
+	{
+		if ( ok_ && size > 0 )
+		{
+			ok_ = ( fwrite( data, 1, size, file_ ) == size );
+		}
+	}
+
+	template<typename T> void Write( const T & value )
+	{
+		Write( &value, sizeof( T ) );
+	}
+
+	void WriteString( const std::string & s )
+	{
+		Write( static_cast<unsigned int>( s.size() ) );
+		Write( s.data(), s.size() );
+	}
+
+	bool ok() const { return ok_; }
+
+private:
+	FILE * file_{ nullptr };
+	bool ok_{ true };
+};
+
+/* sequential bounds checked reader of the mapped cache */
+class CacheReader
+{
+public:
+	CacheReader( const MappedFile & file ) : p_( file.data() ), end_( file.end() ) { }
+
+	void Read( void * data, const size_t size )
+	{
+		if ( ok_ && size <= static_cast<size_t>( end_ - p_ ) )
+		{
+			memcpy( data, p_, size );
+			p_ += size;
+		}
+		else
+		{
+			ok_ = false;
+		}
+	}
+
+	template<typename T> T Read()
+	{
+		T value{};
+		Read( &value, sizeof( T ) );
+
+		return value;
+	}
+
+	std::string ReadString()
+	{
+		const unsigned int size = Read<unsigned int>();
+		if ( !ok_ || size > static_cast<size_t>( end_ - p_ ) )
+		{
+			ok_ = false;
+
+			return std::string();
+		}
+		std::string s( p_, p_ + size );
+		p_ += size;
+
+		return s;
+	}
+
+	void Fail() { ok_ = false; }
+
+	bool ok() const { return ok_; }
+
+	size_t remaining() const { return static_cast<size_t>( end_ - p_ ); }
+
+private:
+	const char * p_{ nullptr };
+	const char * end_{ nullptr };
+	bool ok_{ true };
+};
+
+/* replaces the file in a single step, so readers see either the old or the new file but never none */
+static bool ReplaceCacheFile( const char * src_file_name, const char * dst_file_name )
+{
+#ifdef _WIN32
+	return MoveFileExA( src_file_name, dst_file_name, MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+	return rename( src_file_name, dst_file_name ) == 0; // POSIX rename replaces the target atomically
+#endif
+}
+
+/* textures of these slots are single channel maps */
+static bool IsSingleChannelSlot( const int slot )
+{
+	return ( slot == Material::kOpacityMapSlot ) || ( slot == Material::kRoughnessMapSlot ) || ( slot == Material::kMetallicnessMapSlot );
+}
+
+unsigned long long HashFile( const MappedFile & file, ThreadPool & thread_pool )
+{
+	// fixed block size keeps the hash independent of the number of threads
+	const size_t block_size = 4 << 20;
+	const int no_blocks = static_cast<int>( ( file.size() + block_size - 1 ) / block_size );
+
+	std::vector<unsigned long long> block_hashes( no_blocks );
+	thread_pool.ParallelFor( no_blocks, [&]( const int i )
+	{
+		const size_t offset = i * block_size;
+		block_hashes[i] = QuickHash( reinterpret_cast<const BYTE *>( file.data() + offset ),
+			std::min( block_size, file.size() - offset ), i + 1 );
+	} );
+
+	return QuickHash( reinterpret_cast<const BYTE *>( block_hashes.data() ),
+		block_hashes.size() * sizeof( unsigned long long ), file.size() );
+}
+
+/* combined hash of all MTL files, missing files contribute by their name only */
+static unsigned long long HashMaterialLibraries( const std::vector<std::string> & material_libraries, ThreadPool & thread_pool )
+{
+	std::vector<unsigned long long> hashes;
+
+	for ( const std::string & material_library : material_libraries )
+	{
+		MappedFile file( material_library.c_str() );
+		hashes.push_back( QuickHash( reinterpret_cast<const BYTE *>( material_library.c_str() ), material_library.size() ) );
+		hashes.push_back( file.is_open() ? HashFile( file, thread_pool ) : 0 );
+	}
+
+	return QuickHash( reinterpret_cast<const BYTE *>( hashes.data() ), hashes.size() * sizeof( unsigned long long ) );
+}
+
+std::string MeshCacheFileName( const char * file_name )
+{
+	return std::string( file_name ).append( ".cache" );
+}
+
+int LoadMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool,
+	std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+{
+	PROFILE_ZONE( "LoadMeshCache" );
+
+	const std::string cache_file_name = MeshCacheFileName( file_name );
+	MappedFile file( cache_file_name.c_str() );
+	if ( !file.is_open() )
+	{
+		return -1;
+	}
+
+	CacheReader reader( file );
+
+	// --- header ---
+	char magic[4] = { 0 };
+	reader.Read( magic, sizeof( magic ) );
+	if ( memcmp( magic, kMeshCacheMagic, sizeof( magic ) ) != 0 || reader.Read<unsigned int>() != kMeshCacheVersion ||
+		reader.Read<unsigned long long>() != key )
+	{
+		return -1;
+	}
+	const unsigned long long mtl_key = reader.Read<unsigned long long>();
+	if ( reader.Read<unsigned int>() != sizeof( Vertex ) || reader.Read<unsigned int>() != sizeof( Meshlet ) )
+	{
+		return -1;
+	}
+
+	std::vector<std::string> material_libraries( reader.Read<unsigned int>() );
+	for ( std::string & material_library : material_libraries )
+	{
+		material_library = reader.ReadString();
+	}
+	if ( !reader.ok() || HashMaterialLibraries( material_libraries, thread_pool ) != mtl_key )
+	{
+		printf( "Cache '%s' is stale.\n", cache_file_name.c_str() );
+
+		return -1;
+	}
+
+	printf( "Loading scene from cache '%s' (%0.1f MB)...\n", cache_file_name.c_str(), file.size() / sqr( 1024.0f ) );
+
+	std::vector<Surface *> cached_surfaces;
+	std::vector<Material *> cached_materials;
+	std::map<std::string, Texture *> already_loaded_textures;
+
+	// --- materials ---
+	const unsigned int no_materials = reader.Read<unsigned int>();
+	for ( unsigned int i = 0; reader.ok() && i < no_materials; ++i )
+	{
+		Material * material = new Material();
+		cached_materials.push_back( material );
+
+		material->set_name( reader.ReadString().c_str() );
+		material->ambient_ = reader.Read<Color3f>();
+		material->diffuse_ = reader.Read<Color3f>();
+		material->specular_ = reader.Read<Color3f>();
+		material->emission_ = reader.Read<Color3f>();
+		material->shininess = reader.Read<float>();
+		material->roughness_ = reader.Read<float>();
+		material->metallicness = reader.Read<float>();
+		material->reflectivity = reader.Read<float>();
+		material->ior = reader.Read<float>();
+		material->set_shader( reader.Read<Shader>() );
+		material->material_index = reader.Read<int>();
+
+		for ( int slot = 0; slot < NO_TEXTURES; ++slot )
+		{
+			const std::string texture_file_name = reader.ReadString();
+			if ( !texture_file_name.empty() )
+			{
+				material->set_texture( slot, TextureProxy( texture_file_name, already_loaded_textures, -1, IsSingleChannelSlot( slot ), &thread_pool ) );
+			}
+		}
+	}
+
+	// --- surfaces ---
+	const unsigned int no_surfaces = reader.Read<unsigned int>();
+	for ( unsigned int i = 0; reader.ok() && i < no_surfaces; ++i )
+	{
+		const std::string name = reader.ReadString();
+		const int material_index = reader.Read<int>();
+		const int no_vertices = reader.Read<int>();
+		const int no_triangles = reader.Read<int>();
+		if ( no_vertices <= 0 || no_triangles <= 0 || material_index >= static_cast<int>( cached_materials.size() ) ||
+			sizeof( Vertex ) * no_vertices + 3 * size_t( no_triangles ) > reader.remaining() )
+		{
+			reader.Fail();
+			break;
+		}
+
+		Surface * surface = new Surface( name, no_vertices, no_triangles );
+		cached_surfaces.push_back( surface );
+
+		reader.Read( surface->get_vertices(), sizeof( Vertex ) * no_vertices );
+		Triangle3ui * indices = surface->get_indices();
+
+		// out of range indices would be dereferenced by get_triangle
+		auto check_indices = [&reader, no_vertices]( const Triangle3ui * indices, const size_t no_triangles )
+		{
+			for ( size_t j = 0; reader.ok() && j < no_triangles; ++j )
+			{
+				if ( std::max( indices[j].v0, std::max( indices[j].v1, indices[j].v2 ) ) >= static_cast<unsigned int>( no_vertices ) )
+				{
+					reader.Fail();
+				}
+			}
+		};
+
+		const int no_meshlets = reader.Read<int>();
+		if ( no_meshlets == 0 )
+		{
+			if ( sizeof( Triangle3ui ) * no_triangles > reader.remaining() )
+			{
+				reader.Fail();
+				break;
+			}
+			reader.Read( indices, sizeof( Triangle3ui ) * no_triangles );
+			check_indices( indices, no_triangles );
+		}
+		else
+		{
+			SurfaceMeshlets & meshlets = surface->get_meshlets();
+			if ( no_meshlets < 0 || no_meshlets > no_triangles || sizeof( Meshlet ) * no_meshlets > reader.remaining() )
+			{
+				reader.Fail();
+				break;
+			}
+			meshlets.meshlets.resize( no_meshlets );
+			reader.Read( meshlets.meshlets.data(), sizeof( Meshlet ) * no_meshlets );
+
+			const int no_meshlet_vertices = reader.Read<int>();
+			if ( no_meshlet_vertices <= 0 || sizeof( unsigned int ) * no_meshlet_vertices + 3 * size_t( no_triangles ) > reader.remaining() )
+			{
+				reader.Fail();
+				break;
+			}
+			meshlets.vertices.resize( no_meshlet_vertices );
+			reader.Read( meshlets.vertices.data(), sizeof( unsigned int ) * no_meshlet_vertices );
+			meshlets.triangles.resize( 3 * size_t( no_triangles ) );
+			reader.Read( meshlets.triangles.data(), meshlets.triangles.size() );
+			meshlets.closed = reader.Read<int>() != 0;
+
+			if ( !UnpackMeshlets( meshlets, no_vertices, no_triangles, indices ) )
+			{
+				reader.Fail();
+			}
+		}
+
+		const int no_lods = reader.Read<int>();
+		if ( no_lods < 0 || no_lods >= MAX_LODS )
+		{
+			reader.Fail();
+		}
+		for ( int j = 0; reader.ok() && j < no_lods; ++j )
+		{
+			SurfaceLod lod;
+			lod.error = reader.Read<float>();
+			const int no_lod_triangles = reader.Read<int>();
+			if ( no_lod_triangles <= 0 || sizeof( Triangle3ui ) * no_lod_triangles > reader.remaining() )
+			{
+				reader.Fail();
+				break;
+			}
+			lod.indices.resize( no_lod_triangles );
+			reader.Read( lod.indices.data(), sizeof( Triangle3ui ) * no_lod_triangles );
+			check_indices( lod.indices.data(), lod.indices.size() );
+			surface->add_lod( std::move( lod ) );
+		}
+
+		if ( material_index >= 0 )
+		{
+			surface->set_material( cached_materials[material_index] );
+		}
+	}
+
+	thread_pool.Wait(); // the textures were decoded while the surfaces were read
+
+	if ( !reader.ok() )
+	{
+		printf( "Cache '%s' is corrupted.\n", cache_file_name.c_str() );
+
+		ReleaseScene( cached_surfaces, cached_materials );
+
+		return -1;
+	}
+
+	surfaces.insert( surfaces.end(), cached_surfaces.begin(), cached_surfaces.end() );
+	materials.insert( materials.end(), cached_materials.begin(), cached_materials.end() );
+
+	printf( "%I64u group(s) and %I64u material(s) loaded from cache.\n\n", cached_surfaces.size(), cached_materials.size() );
+
+	return static_cast<int>( cached_surfaces.size() );
+}
+
+bool SaveMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool,
+	const std::vector<std::string> & material_libraries, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+{
+	PROFILE_ZONE( "SaveMeshCache" );
+
+	const std::string cache_file_name = MeshCacheFileName( file_name );
+	const std::string tmp_file_name = cache_file_name + ".tmp"; // the cache is replaced in a single step once complete, see ReplaceCacheFile
+
+	FILE * file = fopen( tmp_file_name.c_str(), "wb" );
+	if ( file == NULL )
+	{
+		printf( "Cache '%s' cannot be written.\n", cache_file_name.c_str() );
+
+		return false;
+	}
+
+	CacheWriter writer( file );
+
+	// --- header ---
+	writer.Write( kMeshCacheMagic, sizeof( kMeshCacheMagic ) );
+	writer.Write( kMeshCacheVersion );
+	writer.Write( key );
+	writer.Write( HashMaterialLibraries( material_libraries, thread_pool ) );
+	writer.Write( static_cast<unsigned int>( sizeof( Vertex ) ) );
+	writer.Write( static_cast<unsigned int>( sizeof( Meshlet ) ) );
+
+	writer.Write( static_cast<unsigned int>( material_libraries.size() ) );
+	for ( const std::string & material_library : material_libraries )
+	{
+		writer.WriteString( material_library );
+	}
+
+	// --- materials ---
+	writer.Write( static_cast<unsigned int>( materials.size() ) );
+	for ( const Material * material : materials )
+	{
+		writer.WriteString( material->name() );
+		writer.Write( material->ambient_ );
+		writer.Write( material->diffuse_ );
+		writer.Write( material->specular_ );
+		writer.Write( material->emission_ );
+		writer.Write( material->shininess );
+		writer.Write( material->roughness_ );
+		writer.Write( material->metallicness );
+		writer.Write( material->reflectivity );
+		writer.Write( material->ior );
+		writer.Write( material->shader() );
+		writer.Write( material->material_index );
+
+		for ( int slot = 0; slot < NO_TEXTURES; ++slot )
+		{
+			const Texture * texture = material->texture( slot );
+			writer.WriteString( texture ? texture->file_name() : std::string() );
+		}
+	}
+
+	// --- surfaces ---
+	writer.Write( static_cast<unsigned int>( surfaces.size() ) );
+	for ( Surface * surface : surfaces )
+	{
+		const std::vector<Material *>::const_iterator material = std::find( materials.begin(), materials.end(), surface->get_material() );
+
+		writer.WriteString( surface->get_name() );
+		writer.Write( ( material != materials.end() ) ? static_cast<int>( material - materials.begin() ) : -1 );
+		writer.Write( surface->no_vertices() );
+		writer.Write( surface->no_triangles() );
+		writer.Write( surface->get_vertices(), sizeof( Vertex ) * surface->no_vertices() );
+
+		// meshlets store the triangles by 8-bit local indices, the 32-bit ones are written only for surfaces without them
+		const SurfaceMeshlets & meshlets = surface->get_meshlets();
+		writer.Write( static_cast<int>( meshlets.meshlets.size() ) );
+		if ( meshlets.meshlets.empty() )
+		{
+			writer.Write( surface->get_indices(), sizeof( Triangle3ui ) * surface->no_triangles() );
+		}
+		else
+		{
+			writer.Write( meshlets.meshlets.data(), sizeof( Meshlet ) * meshlets.meshlets.size() );
+			writer.Write( static_cast<int>( meshlets.vertices.size() ) );
+			writer.Write( meshlets.vertices.data(), sizeof( unsigned int ) * meshlets.vertices.size() );
+			writer.Write( meshlets.triangles.data(), meshlets.triangles.size() );
+			writer.Write( static_cast<int>( meshlets.closed ) );
+		}
+
+		writer.Write( surface->no_lods() );
+		for ( int j = 0; j < surface->no_lods(); ++j )
+		{
+			const SurfaceLod & lod = surface->get_lod( j );
+			writer.Write( lod.error );
+			writer.Write( static_cast<int>( lod.indices.size() ) );
+			writer.Write( lod.indices.data(), sizeof( Triangle3ui ) * lod.indices.size() );
+		}
+	}
+
+	const bool ok = writer.ok();
+	fclose( file );
+	file = NULL;
+
+	if ( !ok || !ReplaceCacheFile( tmp_file_name.c_str(), cache_file_name.c_str() ) )
+	{
+		remove( tmp_file_name.c_str() );
+		printf( "Cache '%s' cannot be written.\n", cache_file_name.c_str() );
+
+		return false;
+	}
+
+	printf( "Scene cached to '%s'.\n\n", cache_file_name.c_str() );
+
+	return true;
+}
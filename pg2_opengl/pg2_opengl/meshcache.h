@@ -0,0 +1,41 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include "surface.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+
+/*
+Binary cache of the finished scene (surfaces and materials) stored next to the OBJ file as <file_name>.cache.
+
+The cache is keyed by QuickHash of the OBJ and all its MTL files and by the loader parameters,
+so it is invalidated automatically whenever any of the sources changes.
+*/
+
+/*! \fn unsigned long long HashFile( const MappedFile & file, ThreadPool & thread_pool )
+\brief QuickHash of the whole file, blocks of the file are hashed in parallel.
+*/
+unsigned long long HashFile( const MappedFile & file, ThreadPool & thread_pool );
+
+/*! \fn std::string MeshCacheFileName( const char * file_name )
+\brief Returns the name of the cache file of the given OBJ file.
+*/
+std::string MeshCacheFileName( const char * file_name );
+
+/*! \fn int LoadMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+\brief Loads the scene from the cache of the OBJ file \a file_name.
+\param key hash of the OBJ file and the loader parameters.
+\return Number of loaded surfaces or -1 if the cache is missing, stale or corrupted.
+*/
+int LoadMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool,
+	std::vector<Surface *> & surfaces, std::vector<Material *> & materials );
+
+/*! \fn bool SaveMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool, const std::vector<std::string> & material_libraries, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+\brief Writes the scene into the cache of the OBJ file \a file_name.
+\param key hash of the OBJ file and the loader parameters.
+\param material_libraries full paths of all MTL files used by the OBJ file.
+*/
+bool SaveMeshCache( const char * file_name, const unsigned long long key, ThreadPool & thread_pool,
+	const std::vector<std::string> & material_libraries, std::vector<Surface *> & surfaces, std::vector<Material *> & materials );
+
+#endif
@@ -0,0 +1,318 @@
+#include "pch.h"
+#include "meshlets.h"
+#include "mymath.h"
+
+static const float kConeWeight = 0.5f; // penalty of a triangle facing perpendicularly to the meshlet relative to one new vertex
+static const float kMinConeDot = 0.1f; // normal cones wider than about 84 degrees cannot be culled
+
+/* unit normal of the triangle, zero for degenerate ones */
+static Vector3 TriangleNormal( const Triangle3ui & triangle, const Vertex * vertices )
+{
+	const Vector3 & p0 = vertices[triangle.v0].position;
+	Vector3 n = ( vertices[triangle.v1].position - p0 ).CrossProduct( vertices[triangle.v2].position - p0 );
+
+	return ( n.Normalize() > 0.0f ) ? n : Vector3( 0.0f, 0.0f, 0.0f );
+}
+
+/* sphere around the bounding box of the triangles and the cone of their normals */
+static void ComputeMeshletBounds( Meshlet & meshlet, const Triangle3ui * triangles, const Vertex * vertices )
+{
+	Vector3 lower = vertices[triangles[0].v0].position;
+	Vector3 upper = lower;
+
+	for ( int t = 0; t < meshlet.no_triangles; ++t )
+	{
+		for ( int k = 0; k < 3; ++k )
+		{
+			const Vector3 & p = vertices[( &triangles[t].v0 )[k]].position;
+			lower = Vector3( std::min( lower.x, p.x ), std::min( lower.y, p.y ), std::min( lower.z, p.z ) );
+			upper = Vector3( std::max( upper.x, p.x ), std::max( upper.y, p.y ), std::max( upper.z, p.z ) );
+		}
+	}
+
+	meshlet.center = ( lower + upper ) * 0.5f;
+	float sqr_radius = 0.0f;
+	for ( int t = 0; t < meshlet.no_triangles; ++t )
+	{
+		for ( int k = 0; k < 3; ++k )
+		{
+			sqr_radius = std::max( sqr_radius, ( vertices[( &triangles[t].v0 )[k]].position - meshlet.center ).SqrL2Norm() );
+		}
+	}
+	meshlet.radius = sqrtf( sqr_radius );
+
+	// the axis is the average normal, the cone is open if some triangle faces too far from it
+	Vector3 axis;
+	for ( int t = 0; t < meshlet.no_triangles; ++t )
+	{
+		axis += TriangleNormal( triangles[t], vertices );
+	}
+
+	meshlet.cone_apex = meshlet.center;
+	meshlet.cone_axis = Vector3( 0.0f, 0.0f, 1.0f );
+	meshlet.cone_cutoff = 1.0f;
+
+	if ( axis.Normalize() <= 0.0f )
+	{
+		return;
+	}
+	meshlet.cone_axis = axis;
+
+	float min_dot = 1.0f;
+	for ( int t = 0; t < meshlet.no_triangles; ++t )
+	{
+		const Vector3 n = TriangleNormal( triangles[t], vertices );
+		if ( n.SqrL2Norm() > 0.0f )
+		{
+			min_dot = std::min( min_dot, n.DotProduct( axis ) );
+		}
+	}
+
+	if ( min_dot <= kMinConeDot )
+	{
+		return;
+	}
+
+	// the apex is moved against the axis until it lies behind the planes of all triangles
+	float max_t = 0.0f;
+	for ( int t = 0; t < meshlet.no_triangles; ++t )
+	{
+		const Vector3 n = TriangleNormal( triangles[t], vertices );
+		if ( n.SqrL2Norm() > 0.0f )
+		{
+			max_t = std::max( max_t, ( meshlet.center - vertices[triangles[t].v0].position ).DotProduct( n ) / n.DotProduct( axis ) );
+		}
+	}
+
+	meshlet.cone_apex = meshlet.center - axis * max_t;
+	meshlet.cone_cutoff = sqrtf( 1.0f - sqr( min_dot ) );
+}
+
+/* true if each edge of the nondegenerate triangles is shared by exactly two of them with opposite directions and the
+enclosed volume is positive, vertices split by normals or texture coordinates are welded by their positions */
+static bool IsClosed( const Triangle3ui * triangles, const int no_triangles, const Vertex * vertices, const int no_vertices )
+{
+	std::vector<unsigned int> order( no_vertices );
+	for ( int v = 0; v < no_vertices; ++v ) order[v] = v;
+	auto less = [vertices]( const unsigned int a, const unsigned int b )
+	{
+		const Vector3 & p = vertices[a].position;
+		const Vector3 & q = vertices[b].position;
+		return ( p.x != q.x ) ? p.x < q.x : ( ( p.y != q.y ) ? p.y < q.y : p.z < q.z );
+	};
+	std::sort( order.begin(), order.end(), less );
+
+	std::vector<unsigned int> welded( no_vertices );
+	for ( int i = 0, first = 0; i < no_vertices; ++i )
+	{
+		if ( less( order[first], order[i] ) ) first = i;
+		welded[order[i]] = order[first];
+	}
+
+	std::vector<unsigned long long> edges;
+	edges.reserve( 3 * size_t( no_triangles ) );
+	double volume = 0.0;
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		const unsigned int v[3] = { welded[triangles[t].v0], welded[triangles[t].v1], welded[triangles[t].v2] };
+		if ( v[0] == v[1] || v[1] == v[2] || v[2] == v[0] )
+		{
+			continue;
+		}
+		for ( int k = 0; k < 3; ++k )
+		{
+			edges.push_back( ( static_cast<unsigned long long>( v[k] ) << 32 ) | v[( k + 1 ) % 3] );
+		}
+
+		const Vector3 & p0 = vertices[v[0]].position;
+		volume += p0.DotProduct( vertices[v[1]].position.CrossProduct( vertices[v[2]].position ) );
+	}
+
+	std::sort( edges.begin(), edges.end() );
+	for ( size_t i = 0; i < edges.size(); ++i )
+	{
+		const unsigned long long opposite = ( edges[i] << 32 ) | ( edges[i] >> 32 );
+		if ( ( i + 1 < edges.size() && edges[i + 1] == edges[i] ) || !std::binary_search( edges.begin(), edges.end(), opposite ) )
+		{
+			return false;
+		}
+	}
+
+	return !edges.empty() && volume > 0.0;
+}
+
+void BuildMeshlets( Surface * surface, const int max_vertices, const int max_triangles )
+{
+	assert( max_vertices >= 3 && max_vertices <= 255 && max_triangles >= 1 && max_triangles <= 255 );
+
+	const int no_triangles = surface->no_triangles();
+	const int no_vertices = surface->no_vertices();
+	const Triangle3ui * indices = surface->get_indices();
+	const Vertex * vertices = surface->get_vertices();
+
+	// triangles around each vertex
+	std::vector<int> offsets( no_vertices + 1, 0 );
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		for ( int k = 0; k < 3; ++k ) ++offsets[( &indices[t].v0 )[k] + 1];
+	}
+	for ( size_t v = 1; v < offsets.size(); ++v )
+	{
+		offsets[v] += offsets[v - 1];
+	}
+	std::vector<int> adjacency( 3 * size_t( no_triangles ) );
+	std::vector<int> cursors( offsets.begin(), offsets.end() - 1 );
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		for ( int k = 0; k < 3; ++k ) adjacency[cursors[( &indices[t].v0 )[k]]++] = t;
+	}
+
+	std::vector<Vector3> normals( no_triangles );
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		normals[t] = TriangleNormal( indices[t], vertices );
+	}
+
+	SurfaceMeshlets & result = surface->get_meshlets();
+	result = SurfaceMeshlets();
+	result.triangles.reserve( 3 * size_t( no_triangles ) );
+
+	std::vector<Triangle3ui> ordered;
+	ordered.reserve( no_triangles );
+	std::vector<bool> used( no_triangles, false );
+	std::vector<int> candidate_of( no_triangles, -1 ); // last meshlet the triangle became a candidate of
+	std::vector<int> local( no_vertices, -1 ); // index of the vertex in the meshlet being built
+	std::vector<int> candidates; // unused triangles sharing a vertex with the meshlet
+	int next = 0; // all triangles before this one are used
+
+	auto no_new_vertices = [&]( const int t )
+	{
+		return ( local[indices[t].v0] < 0 ) + ( local[indices[t].v1] < 0 ) + ( local[indices[t].v2] < 0 );
+	};
+
+	while ( static_cast<int>( ordered.size() ) < no_triangles )
+	{
+		const int id = static_cast<int>( result.meshlets.size() );
+		Meshlet meshlet;
+		meshlet.vertex_offset = static_cast<unsigned int>( result.vertices.size() );
+		meshlet.triangle_offset = static_cast<unsigned int>( ordered.size() );
+		Vector3 normal_sum;
+		candidates.clear();
+
+		while ( meshlet.no_triangles < max_triangles )
+		{
+			Vector3 normal = normal_sum;
+			normal.Normalize();
+
+			int best = -1;
+			float best_score = FLT_MAX;
+			for ( size_t i = 0; i < candidates.size(); )
+			{
+				const int t = candidates[i];
+				if ( used[t] )
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				++i;
+
+				const int no_new = no_new_vertices( t );
+				const float score = no_new + kConeWeight * ( 1.0f - normal.DotProduct( normals[t] ) );
+				if ( meshlet.no_vertices + no_new <= max_vertices && ( score < best_score || ( score == best_score && t < best ) ) )
+				{
+					best = t;
+					best_score = score;
+				}
+			}
+
+			if ( best < 0 )
+			{
+				// no neighbour fits in, the meshlet continues by the next triangle in the order of the index buffer
+				while ( next < no_triangles && used[next] ) ++next;
+				if ( next == no_triangles || meshlet.no_vertices + no_new_vertices( next ) > max_vertices )
+				{
+					break;
+				}
+				best = next;
+			}
+
+			used[best] = true;
+			unsigned char triangle[3];
+			for ( int k = 0; k < 3; ++k )
+			{
+				const unsigned int v = ( &indices[best].v0 )[k];
+				if ( local[v] < 0 )
+				{
+					local[v] = meshlet.no_vertices++;
+					result.vertices.push_back( v );
+
+					for ( int j = offsets[v]; j < offsets[v + 1]; ++j )
+					{
+						const int neighbour = adjacency[j];
+						if ( !used[neighbour] && candidate_of[neighbour] != id )
+						{
+							candidate_of[neighbour] = id;
+							candidates.push_back( neighbour );
+						}
+					}
+				}
+				triangle[k] = static_cast<unsigned char>( local[v] );
+			}
+
+			result.triangles.insert( result.triangles.end(), triangle, triangle + 3 );
+			ordered.push_back( indices[best] );
+			normal_sum += normals[best];
+			++meshlet.no_triangles;
+		}
+
+		for ( size_t j = meshlet.vertex_offset; j < result.vertices.size(); ++j )
+		{
+			local[result.vertices[j]] = -1;
+		}
+
+		ComputeMeshletBounds( meshlet, &ordered[meshlet.triangle_offset], vertices );
+		result.meshlets.push_back( meshlet );
+	}
+
+	std::copy( ordered.begin(), ordered.end(), surface->get_indices() );
+	result.closed = IsClosed( indices, no_triangles, vertices, no_vertices );
+}
+
+bool UnpackMeshlets( const SurfaceMeshlets & meshlets, const int no_vertices, const int no_triangles, Triangle3ui * indices )
+{
+	if ( meshlets.triangles.size() != 3 * size_t( no_triangles ) )
+	{
+		return false;
+	}
+
+	size_t no_unpacked = 0;
+	for ( const Meshlet & meshlet : meshlets.meshlets )
+	{
+		if ( meshlet.triangle_offset != no_unpacked || no_unpacked + meshlet.no_triangles > size_t( no_triangles ) ||
+			size_t( meshlet.vertex_offset ) + meshlet.no_vertices > meshlets.vertices.size() )
+		{
+			return false;
+		}
+
+		const unsigned int * meshlet_vertices = &meshlets.vertices[meshlet.vertex_offset];
+		for ( int t = 0; t < meshlet.no_triangles; ++t )
+		{
+			const unsigned char * triangle = &meshlets.triangles[3 * ( no_unpacked + t )];
+			unsigned int * index = &indices[no_unpacked + t].v0;
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				if ( triangle[k] >= meshlet.no_vertices || meshlet_vertices[triangle[k]] >= static_cast<unsigned int>( no_vertices ) )
+				{
+					return false;
+				}
+				index[k] = meshlet_vertices[triangle[k]];
+			}
+		}
+
+		no_unpacked += meshlet.no_triangles;
+	}
+
+	return no_unpacked == size_t( no_triangles );
+}
@@ -0,0 +1,31 @@
+#ifndef MESHLETS_H_
+#define MESHLETS_H_
+
+#include "surface.h"
+
+/*
+Decomposition of surfaces into meshlets, small clusters of adjacent triangles with 8-bit local vertex indices.
+
+A meshlet is grown from the first unassigned triangle in the order of the index buffer, it is repeatedly extended by the
+neighbouring triangle adding the fewest new vertices and deviating the least from the average normal of the meshlet,
+which keeps the meshlets compact and their normal cones narrow. Triangles of the surface are then reordered so that each
+meshlet is a contiguous range of its index buffer and can be drawn (or culled) on its own by glDrawElements.
+
+The renderer draws both sides of the triangles, so the meshlets facing away may be skipped only on closed surfaces,
+those whose vertices welded by position form a watertight mesh oriented outwards (SurfaceMeshlets::closed).
+*/
+
+/*! \fn void BuildMeshlets( Surface * surface, const int max_vertices, const int max_triangles )
+\brief Splits the surface into meshlets stored in Surface::get_meshlets() and reorders its triangles accordingly.
+\param max_vertices maximal number of vertices of a meshlet, at most 255.
+\param max_triangles maximal number of triangles of a meshlet, at most 255.
+*/
+void BuildMeshlets( Surface * surface, const int max_vertices = MAX_MESHLET_VERTICES, const int max_triangles = MAX_MESHLET_TRIANGLES );
+
+/*! \fn bool UnpackMeshlets( const SurfaceMeshlets & meshlets, const int no_vertices, const int no_triangles, Triangle3ui * indices )
+\brief Rebuilds the vertex indices of a surface from the local indices of its meshlets.
+\return False if the meshlets do not cover all \a no_triangles triangles in order or reference vertices out of range.
+*/
+bool UnpackMeshlets( const SurfaceMeshlets & meshlets, const int no_vertices, const int no_triangles, Triangle3ui * indices );
+
+#endif
@@ -0,0 +1,369 @@
+#include "pch.h"
+#include "meshopt.h"
+
+static const int kForsythCacheSize = 32; // size of the LRU cache modelled by the scoring function
+static const int kForsythMaxValence = 32;
+
+/* simulation of a FIFO post-transform vertex cache */
+class FIFOCache
+{
+public:
+	FIFOCache( const int no_vertices, const int cache_size ) : timestamps_( no_vertices, 0 ), cache_size_( cache_size )
+	{
+		timestamp_ = cache_size_ + 1;
+	}
+
+	// returns the number of vertices of the triangle which had to be transformed
+	int Touch( const Triangle3ui & triangle )
+	{
+		return Touch( triangle.v0 ) + Touch( triangle.v1 ) + Touch( triangle.v2 );
+	}
+
+	void Flush()
+	{
+		timestamp_ += cache_size_ + 1;
+	}
+
+private:
+	int Touch( const unsigned int v )
+	{
+		// the vertex is in the cache if it was inserted less than cache_size insertions ago
+		if ( timestamp_ - timestamps_[v] > static_cast<unsigned int>( cache_size_ ) )
+		{
+			timestamps_[v] = timestamp_++;
+
+			return 1;
+		}
+
+		return 0;
+	}
+
+	std::vector<unsigned int> timestamps_;
+	unsigned int timestamp_{ 0 };
+	int cache_size_{ 0 };
+};
+
+VertexCacheStatistics AnalyzeVertexCache( Surface * surface, const int cache_size )
+{
+	VertexCacheStatistics statistics;
+	statistics.no_triangles = surface->no_triangles();
+	statistics.no_vertices = surface->no_vertices();
+
+	FIFOCache cache( surface->no_vertices(), cache_size );
+	const Triangle3ui * indices = surface->get_indices();
+
+	for ( int i = 0; i < surface->no_triangles(); ++i )
+	{
+		statistics.no_misses += cache.Touch( indices[i] );
+	}
+
+	return statistics;
+}
+
+/* Forsyth's score of a vertex, triangles with the highest sum of their vertex scores are emitted first */
+static float ForsythVertexScore( const int cache_position, const int remaining_triangles )
+{
+	if ( remaining_triangles == 0 )
+	{
+		return -1.0f; // the vertex is not used anymore
+	}
+
+	float score = 0.0f;
+
+	if ( cache_position >= 0 )
+	{
+		// vertices of the last triangle get a fixed score so that strips are not preferred over fans
+		score = ( cache_position < 3 ) ? 0.75f : powf( 1.0f - ( cache_position - 3 ) / static_cast<float>( kForsythCacheSize - 3 ), 1.5f );
+	}
+
+	// boost vertices with few remaining triangles to finish them off
+	score += 2.0f / sqrtf( static_cast<float>( std::min( remaining_triangles, kForsythMaxValence ) ) );
+
+	return score;
+}
+
+void OptimizeVertexCache( Triangle3ui * indices, const int no_triangles, const int no_vertices )
+{
+	const unsigned int * triangle_vertices = &indices[0].v0;
+
+	// triangles adjacent to every vertex, the first remaining[v] entries are the not yet emitted ones
+	std::vector<int> remaining( no_vertices, 0 );
+	for ( int i = 0; i < no_triangles * 3; ++i )
+	{
+		++remaining[triangle_vertices[i]];
+	}
+
+	std::vector<int> offsets( no_vertices + 1, 0 );
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+
+	std::vector<int> adjacency( no_triangles * 3 );
+	{
+		std::vector<int> cursors( offsets.begin(), offsets.end() - 1 );
+		for ( int i = 0; i < no_triangles * 3; ++i )
+		{
+			adjacency[cursors[triangle_vertices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<int> cache_position( no_vertices, -1 );
+	std::vector<float> vertex_score( no_vertices );
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		vertex_score[v] = ForsythVertexScore( -1, remaining[v] );
+	}
+
+	std::vector<float> triangle_score( no_triangles );
+	int best_triangle = 0;
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		const Triangle3ui & triangle = indices[t];
+		triangle_score[t] = vertex_score[triangle.v0] + vertex_score[triangle.v1] + vertex_score[triangle.v2];
+		if ( triangle_score[t] > triangle_score[best_triangle] ) best_triangle = t;
+	}
+
+	std::vector<char> emitted( no_triangles, 0 );
+	std::vector<Triangle3ui> result;
+	result.reserve( no_triangles );
+
+	int cache[kForsythCacheSize + 3];
+	int cache_count = 0;
+
+	// when no triangle touches the cache, we continue from the most recently used vertex with remaining triangles
+	// to avoid starting a new island of triangles, the linear scan is the last resort
+	std::vector<unsigned int> dead_end;
+	dead_end.reserve( no_triangles * 3 );
+	int next_unemitted = 0;
+
+	while ( static_cast<int>( result.size() ) < no_triangles )
+	{
+		while ( best_triangle < 0 && !dead_end.empty() )
+		{
+			const unsigned int v = dead_end.back();
+			dead_end.pop_back();
+			if ( remaining[v] > 0 ) best_triangle = adjacency[offsets[v]];
+		}
+
+		if ( best_triangle < 0 )
+		{
+			while ( emitted[next_unemitted] ) ++next_unemitted;
+			best_triangle = next_unemitted;
+		}
+
+		const Triangle3ui triangle = indices[best_triangle];
+		result.push_back( triangle );
+		emitted[best_triangle] = 1;
+
+		const unsigned int triangle_indices[3] = { triangle.v0, triangle.v1, triangle.v2 };
+		dead_end.insert( dead_end.end(), triangle_indices, triangle_indices + 3 );
+
+		// remove the triangle from the adjacency of its vertices
+		for ( const unsigned int v : triangle_indices )
+		{
+			int * adjacent = &adjacency[offsets[v]];
+			const int count = remaining[v];
+			for ( int i = 0; i < count; ++i )
+			{
+				if ( adjacent[i] == best_triangle )
+				{
+					std::swap( adjacent[i], adjacent[count - 1] );
+					--remaining[v];
+					break;
+				}
+			}
+		}
+
+		// the vertices of the emitted triangle move to the front of the LRU cache
+		int new_cache[kForsythCacheSize + 3];
+		int new_cache_count = 0;
+		for ( const unsigned int v : triangle_indices )
+		{
+			if ( std::find( new_cache, new_cache + new_cache_count, static_cast<int>( v ) ) == new_cache + new_cache_count )
+			{
+				new_cache[new_cache_count++] = v;
+			}
+		}
+		for ( int i = 0; i < cache_count; ++i )
+		{
+			if ( std::find( new_cache, new_cache + new_cache_count, cache[i] ) == new_cache + new_cache_count )
+			{
+				new_cache[new_cache_count++] = cache[i];
+			}
+		}
+
+		// update scores of all vertices which were in the cache, including the ones just evicted
+		for ( int i = 0; i < new_cache_count; ++i )
+		{
+			const int v = new_cache[i];
+			cache_position[v] = ( i < kForsythCacheSize ) ? i : -1;
+			vertex_score[v] = ForsythVertexScore( cache_position[v], remaining[v] );
+		}
+
+		best_triangle = -1;
+		float best_score = -1.0f;
+		for ( int i = 0; i < new_cache_count; ++i )
+		{
+			const int v = new_cache[i];
+			for ( int j = offsets[v]; j < offsets[v] + remaining[v]; ++j )
+			{
+				const int t = adjacency[j];
+				const Triangle3ui & adjacent_triangle = indices[t];
+				triangle_score[t] = vertex_score[adjacent_triangle.v0] + vertex_score[adjacent_triangle.v1] + vertex_score[adjacent_triangle.v2];
+				if ( triangle_score[t] > best_score )
+				{
+					best_score = triangle_score[t];
+					best_triangle = t;
+				}
+			}
+		}
+
+		cache_count = std::min( new_cache_count, kForsythCacheSize );
+		std::copy( new_cache, new_cache + cache_count, cache );
+	}
+
+	std::copy( result.begin(), result.end(), indices );
+}
+
+void OptimizeOverdraw( Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices,
+	const float threshold )
+{
+	const int cache_size = 16;
+
+	// hard boundaries are triangles with all three vertices missing the cache, i.e. where the cache is effectively flushed
+	std::vector<int> hard_clusters;
+	{
+		FIFOCache cache( no_vertices, cache_size );
+		for ( int t = 0; t < no_triangles; ++t )
+		{
+			if ( cache.Touch( indices[t] ) == 3 || t == 0 ) hard_clusters.push_back( t );
+		}
+	}
+	hard_clusters.push_back( no_triangles );
+
+	// hard clusters are further split as long as it does not increase ACMR of the cluster above threshold
+	std::vector<int> clusters;
+	FIFOCache cache( no_vertices, cache_size );
+	for ( size_t i = 0; i + 1 < hard_clusters.size(); ++i )
+	{
+		const int begin = hard_clusters[i];
+		const int end = hard_clusters[i + 1];
+
+		cache.Flush();
+		int no_misses = 0;
+		for ( int t = begin; t < end; ++t ) no_misses += cache.Touch( indices[t] );
+		const float limit = threshold * no_misses / static_cast<float>( end - begin );
+
+		cache.Flush();
+		clusters.push_back( begin );
+		int cluster_begin = begin;
+		no_misses = 0;
+		for ( int t = begin; t < end - 1; ++t )
+		{
+			no_misses += cache.Touch( indices[t] );
+			if ( no_misses <= limit * ( t + 1 - cluster_begin ) )
+			{
+				clusters.push_back( t + 1 );
+				cluster_begin = t + 1;
+				no_misses = 0;
+				cache.Flush();
+			}
+		}
+	}
+	clusters.push_back( no_triangles );
+
+	const int no_clusters = static_cast<int>( clusters.size() ) - 1;
+	if ( no_clusters < 2 )
+	{
+		return;
+	}
+
+	// area weighted centroids and normals of the clusters
+	std::vector<Vector3> centroids( no_clusters ), normals( no_clusters );
+	std::vector<float> areas( no_clusters, 0.0f );
+	Vector3 mesh_centroid;
+	float mesh_area = 0.0f;
+
+	for ( int c = 0; c < no_clusters; ++c )
+	{
+		for ( int t = clusters[c]; t < clusters[c + 1]; ++t )
+		{
+			const Vector3 & p0 = vertices[indices[t].v0].position;
+			const Vector3 & p1 = vertices[indices[t].v1].position;
+			const Vector3 & p2 = vertices[indices[t].v2].position;
+
+			const Vector3 normal = ( p1 - p0 ).CrossProduct( p2 - p0 ); // length is twice the area
+			const float area = normal.L2Norm();
+
+			centroids[c] += ( p0 + p1 + p2 ) * ( area / 3.0f );
+			normals[c] += normal;
+			areas[c] += area;
+		}
+
+		mesh_centroid += centroids[c];
+		mesh_area += areas[c];
+	}
+
+	if ( mesh_area > 0.0f ) mesh_centroid /= mesh_area;
+
+	// clusters facing outwards from the centre of the mesh are likely to occlude the others, they go first
+	std::vector<float> sort_keys( no_clusters, 0.0f );
+	for ( int c = 0; c < no_clusters; ++c )
+	{
+		if ( areas[c] > 0.0f && normals[c].SqrL2Norm() > 0.0f )
+		{
+			normals[c].Normalize();
+			sort_keys[c] = ( centroids[c] / areas[c] - mesh_centroid ).DotProduct( normals[c] );
+		}
+	}
+
+	std::vector<int> order( no_clusters );
+	for ( int c = 0; c < no_clusters; ++c ) order[c] = c;
+	std::stable_sort( order.begin(), order.end(), [&sort_keys]( const int a, const int b )
+	{
+		return sort_keys[a] > sort_keys[b];
+	} );
+
+	std::vector<Triangle3ui> result;
+	result.reserve( no_triangles );
+	for ( const int c : order )
+	{
+		result.insert( result.end(), indices + clusters[c], indices + clusters[c + 1] );
+	}
+
+	std::copy( result.begin(), result.end(), indices );
+}
+
+void OptimizeVertexFetch( Surface * surface )
+{
+	const int no_vertices = surface->no_vertices();
+	unsigned int * triangle_vertices = &surface->get_indices()[0].v0;
+	Vertex * vertices = surface->get_vertices();
+
+	std::vector<int> remap( no_vertices, -1 );
+	int next_vertex = 0;
+
+	for ( int i = 0; i < surface->no_triangles() * 3; ++i )
+	{
+		int & new_index = remap[triangle_vertices[i]];
+		if ( new_index < 0 ) new_index = next_vertex++;
+		triangle_vertices[i] = new_index;
+	}
+
+	std::vector<Vertex> reordered( no_vertices );
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		if ( remap[v] < 0 ) remap[v] = next_vertex++; // unreferenced vertices are kept at the end
+		reordered[remap[v]] = vertices[v];
+	}
+
+	std::copy( reordered.begin(), reordered.end(), vertices );
+}
+
+void OptimizeSurface( Surface * surface )
+{
+	OptimizeVertexCache( surface->get_indices(), surface->no_triangles(), surface->no_vertices() );
+	OptimizeOverdraw( surface->get_indices(), surface->no_triangles(), surface->get_vertices(), surface->no_vertices() );
+	OptimizeVertexFetch( surface );
+}
@@ -0,0 +1,65 @@
+#ifndef MESH_OPT_H_
+#define MESH_OPT_H_
+
+#include "surface.h"
+
+/*
+Offline reordering of indexed surfaces for the GPU.
+
+Triangles are first sorted for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache
+Optimisation"), then the sequence is cut into clusters which are sorted to reduce overdraw independently
+of the view direction (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+Finally, the vertex pool is reordered in the order of the first use to improve locality of vertex fetch.
+*/
+
+/*! \struct VertexCacheStatistics
+\brief Result of the simulation of a FIFO post-transform vertex cache.
+*/
+struct VertexCacheStatistics
+{
+	size_t no_misses{ 0 }; /*!< Number of transformed vertices. */
+	size_t no_triangles{ 0 }; /*!< Number of triangles. */
+	size_t no_vertices{ 0 }; /*!< Number of unique vertices. */
+
+	/*! Average cache miss ratio, i.e. transformed vertices per triangle, 0.5 is the optimum for regular meshes and 3 the worst case. */
+	float acmr() const { return ( no_triangles > 0 ) ? no_misses / static_cast<float>( no_triangles ) : 0.0f; }
+
+	/*! Average transform to vertex ratio, 1 is the optimum. */
+	float atvr() const { return ( no_vertices > 0 ) ? no_misses / static_cast<float>( no_vertices ) : 0.0f; }
+
+	void operator+=( const VertexCacheStatistics & s )
+	{
+		no_misses += s.no_misses;
+		no_triangles += s.no_triangles;
+		no_vertices += s.no_vertices;
+	}
+};
+
+/*! \fn VertexCacheStatistics AnalyzeVertexCache( Surface * surface, const int cache_size = 16 )
+\brief Simulates a FIFO vertex cache of the given size while drawing the surface.
+*/
+VertexCacheStatistics AnalyzeVertexCache( Surface * surface, const int cache_size = 16 );
+
+/*! \fn void OptimizeVertexCache( Triangle3ui * indices, const int no_triangles, const int no_vertices )
+\brief Reorders triangles for the post-transform vertex cache.
+*/
+void OptimizeVertexCache( Triangle3ui * indices, const int no_triangles, const int no_vertices );
+
+/*! \fn void OptimizeOverdraw( Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices, const float threshold = 1.05f )
+\brief Reorders clusters of the vertex cache optimized triangles so that outer parts of the mesh are drawn first.
+\param threshold allowed increase of ACMR caused by splitting the sequence into more clusters.
+*/
+void OptimizeOverdraw( Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices,
+	const float threshold = 1.05f );
+
+/*! \fn void OptimizeVertexFetch( Surface * surface )
+\brief Reorders the vertex pool in the order of the first use by the index buffer.
+*/
+void OptimizeVertexFetch( Surface * surface );
+
+/*! \fn void OptimizeSurface( Surface * surface )
+\brief Applies all above optimizations to the surface.
+*/
+void OptimizeSurface( Surface * surface );
+
+#endif
@@ -14,3 +14,64 @@ unsigned long long QuickHash( const BYTE * data, const size_t length, unsigned l
 
 	return mix ^ ( mix << 37 );
 }
+
+unsigned short FloatToHalf( const float x )
+{
+	unsigned int bits = 0;
+	memcpy( &bits, &x, sizeof( bits ) );
+
+	const unsigned int sign = ( bits >> 16 ) & 0x8000;
+	const int exponent = static_cast<int>( ( bits >> 23 ) & 0xff ) - 127 + 15;
+	unsigned int mantissa = bits & 0x7fffff;
+
+	if ( ( ( bits >> 23 ) & 0xff ) == 0xff ) // inf or nan
+	{
+		return static_cast<unsigned short>( sign | 0x7c00 | ( mantissa ? 0x200 : 0 ) );
+	}
+
+	if ( exponent >= 31 ) // overflow to inf
+	{
+		return static_cast<unsigned short>( sign | 0x7c00 );
+	}
+
+	if ( exponent <= 0 ) // subnormal or zero
+	{
+		if ( exponent < -10 )
+		{
+			return static_cast<unsigned short>( sign );
+		}
+
+		mantissa |= 0x800000; // implicit leading one
+		const int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		if ( ( mantissa >> ( shift - 1 ) ) & 1 ) ++half;
+
+		return static_cast<unsigned short>( sign | half );
+	}
+
+	unsigned int half = sign | ( exponent << 10 ) | ( mantissa >> 13 );
+	if ( mantissa & 0x1000 ) ++half; // the carry propagates correctly into the exponent
+
+	return static_cast<unsigned short>( half );
+}
+
+Coord2f OctahedralEncode( const Vector3 & n )
+{
+	const float l1 = fabsf( n.x ) + fabsf( n.y ) + fabsf( n.z );
+	if ( l1 <= 0.0f )
+	{
+		return Coord2f{ 0.0f, 0.0f };
+	}
+
+	float u = n.x / l1;
+	float v = n.y / l1;
+
+	if ( n.z < 0.0f ) // the lower hemisphere is folded over the diagonals
+	{
+		const float u0 = u;
+		u = ( 1.0f - fabsf( v ) ) * ( ( u0 >= 0.0f ) ? 1.0f : -1.0f );
+		v = ( 1.0f - fabsf( u0 ) ) * ( ( v >= 0.0f ) ? 1.0f : -1.0f );
+	}
+
+	return Coord2f{ u, v };
+}
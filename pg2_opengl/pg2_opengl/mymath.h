@@ -54,4 +54,14 @@ inline Vector3 reflect( const Vector3 & v, const Vector3 & n )
 
 unsigned long long QuickHash( const BYTE * data, const size_t length, unsigned long long mix = 0 );
 
+/*! \fn unsigned short FloatToHalf( const float x )
+\brief Converts the value to IEEE 754 half precision (GL_HALF_FLOAT), the mantissa is rounded to nearest.
+*/
+unsigned short FloatToHalf( const float x );
+
+/*! \fn Coord2f OctahedralEncode( const Vector3 & n )
+\brief Maps the unit vector onto the octahedron unfolded into the square <-1, 1>^2.
+*/
+Coord2f OctahedralEncode( const Vector3 & n );
+
 #endif
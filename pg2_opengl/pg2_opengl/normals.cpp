@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "normals.h"
+#include "threadpool.h"
+#include "mymath.h"
+
+#include <atomic>
+#include <memory>
+
+void GenerateNormals( const Vector3 * positions, const int no_positions, const int * position_indices, const size_t index_stride,
+	const int no_triangles, const unsigned int * smoothing_groups, const float crease_angle, ThreadPool & thread_pool,
+	Vector3 * normals, const NormalWeighting weighting )
+{
+	const size_t no_corners = size_t( no_triangles ) * 3;
+	const float cos_crease_angle = cosf( crease_angle );
+
+	// position index of the corner, -1 if it is out of range
+	auto position_index = [=]( const size_t corner )
+	{
+		const int index = *reinterpret_cast<const int *>( reinterpret_cast<const char *>( position_indices ) + corner * index_stride );
+
+		return ( index >= 0 && index < no_positions ) ? index : -1;
+	};
+
+	auto smoothing_group = [=]( const size_t triangle )
+	{
+		return smoothing_groups ? smoothing_groups[triangle] : 1u;
+	};
+
+	// --- unit face normals and weights of the corners ---
+	std::vector<Vector3> face_normals( no_triangles );
+	std::vector<float> corner_weights( no_corners, 0.0f );
+
+	thread_pool.ParallelForBlocks( no_triangles, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t t = first; t < last; ++t )
+		{
+			const int i0 = position_index( 3 * t ), i1 = position_index( 3 * t + 1 ), i2 = position_index( 3 * t + 2 );
+			if ( i0 < 0 || i1 < 0 || i2 < 0 )
+			{
+				continue;
+			}
+
+			const Vector3 p[3] = { positions[i0], positions[i1], positions[i2] };
+			Vector3 n = ( p[1] - p[0] ).CrossProduct( p[2] - p[0] );
+			const float double_area = n.L2Norm();
+			if ( !( double_area > 0.0f ) )
+			{
+				continue; // degenerate triangle
+			}
+			face_normals[t] = n / double_area;
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				if ( weighting == kAreaWeighted )
+				{
+					corner_weights[3 * t + k] = 0.5f * double_area;
+				}
+				else
+				{
+					Vector3 e1 = p[( k + 1 ) % 3] - p[k];
+					Vector3 e2 = p[( k + 2 ) % 3] - p[k];
+					e1.Normalize();
+					e2.Normalize();
+					corner_weights[3 * t + k] = acosf( clamp( e1.DotProduct( e2 ), -1.0f, 1.0f ) );
+				}
+			}
+		}
+	} );
+
+	// --- corners around each position (compressed rows), the slots are taken by atomic increments ---
+	std::unique_ptr<std::atomic<int>[]> counters( new std::atomic<int>[no_positions + 1]() );
+
+	thread_pool.ParallelForBlocks( no_corners, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t c = first; c < last; ++c )
+		{
+			const int p = position_index( c );
+			if ( p >= 0 )
+			{
+				counters[p].fetch_add( 1, std::memory_order_relaxed );
+			}
+		}
+	} );
+
+	std::vector<int> offsets( no_positions + 1 );
+	int no_adjacent_corners = 0;
+	for ( int p = 0; p < no_positions; ++p )
+	{
+		offsets[p] = no_adjacent_corners;
+		no_adjacent_corners += counters[p].load( std::memory_order_relaxed );
+		counters[p].store( offsets[p], std::memory_order_relaxed );
+	}
+	offsets[no_positions] = no_adjacent_corners;
+
+	std::vector<int> adjacent_corners( no_adjacent_corners );
+
+	thread_pool.ParallelForBlocks( no_corners, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t c = first; c < last; ++c )
+		{
+			const int p = position_index( c );
+			if ( p >= 0 )
+			{
+				adjacent_corners[counters[p].fetch_add( 1, std::memory_order_relaxed )] = static_cast<int>( c );
+			}
+		}
+	} );
+
+	// --- corners around each position gather the weighted normals of the compatible faces ---
+	thread_pool.ParallelForBlocks( no_positions, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t p = first; p < last; ++p )
+		{
+			const auto begin = adjacent_corners.begin() + offsets[p];
+			const auto end = adjacent_corners.begin() + offsets[p + 1];
+
+			// the order of the slots depends on the scheduling, sorting makes the sums reproducible
+			std::sort( begin, end );
+
+			for ( auto corner = begin; corner != end; ++corner )
+			{
+				const size_t t = *corner / 3;
+				const unsigned int group = smoothing_group( t );
+				const Vector3 & face_normal = face_normals[t];
+				const bool degenerate = face_normal.SqrL2Norm() == 0.0f;
+
+				if ( group == 0 )
+				{
+					normals[*corner] = face_normal;
+					continue;
+				}
+
+				Vector3 normal;
+				for ( auto adjacent_corner = begin; adjacent_corner != end; ++adjacent_corner )
+				{
+					const size_t adjacent_triangle = *adjacent_corner / 3;
+
+					// degenerate faces take the normals of all their neighbours in the group
+					if ( smoothing_group( adjacent_triangle ) == group &&
+						( degenerate || face_normal.DotProduct( face_normals[adjacent_triangle] ) >= cos_crease_angle ) )
+					{
+						normal += face_normals[adjacent_triangle] * corner_weights[*adjacent_corner];
+					}
+				}
+
+				normals[*corner] = ( normal.Normalize() > 0.0f ) ? normal : face_normal;
+			}
+		}
+	} );
+
+	// corners without a valid position
+	thread_pool.ParallelForBlocks( no_corners, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t c = first; c < last; ++c )
+		{
+			if ( position_index( c ) < 0 )
+			{
+				normals[c] = Vector3();
+			}
+		}
+	} );
+}
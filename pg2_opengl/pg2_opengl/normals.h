@@ -0,0 +1,35 @@
+#ifndef NORMALS_H_
+#define NORMALS_H_
+
+#include "vector3.h"
+
+class ThreadPool;
+
+/*! \enum NormalWeighting
+\brief Weights of the face normals summed into a vertex normal.
+*/
+enum NormalWeighting
+{
+	kAreaWeighted, /*!< Area of the triangle, large faces dominate. */
+	kAngleWeighted /*!< Angle of the triangle at the vertex, independent of the tessellation. */
+};
+
+/*! \fn void GenerateNormals( const Vector3 * positions, const int no_positions, const int * position_indices, const size_t index_stride, const int no_triangles, const unsigned int * smoothing_groups, const float crease_angle, ThreadPool & thread_pool, Vector3 * normals, const NormalWeighting weighting = kAngleWeighted )
+\brief Computes a normal for every face vertex (corner) of the triangles.
+
+Normals of the faces sharing a position are averaged if the faces belong to the same smoothing group and the angle
+between them does not exceed the crease angle. Smoothing group 0 stands for flat shaded faces. The work runs in parallel
+over triangles, vertex to corner adjacency is built with atomic counters and every corner gathers its neighbours,
+so no locks are needed and the result does not depend on the number of threads.
+
+\param positions array of no_positions positions.
+\param position_indices position index of the first corner, indices of the following corners are index_stride bytes apart.
+\param smoothing_groups smoothing group of each triangle, nullptr puts all triangles into group 1.
+\param crease_angle maximal angle (in radians) between smoothed faces.
+\param normals output array of 3 * no_triangles unit normals, invalid and degenerate triangles get zero normals.
+*/
+void GenerateNormals( const Vector3 * positions, const int no_positions, const int * position_indices, const size_t index_stride,
+	const int no_triangles, const unsigned int * smoothing_groups, const float crease_angle, ThreadPool & thread_pool,
+	Vector3 * normals, const NormalWeighting weighting = kAngleWeighted );
+
+#endif
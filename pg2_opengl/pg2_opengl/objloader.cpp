@@ -4,32 +4,55 @@ http://en.wikipedia.org/wiki/Wavefront_.obj_file
 */
 
 #include "pch.h"
+#include "objloader.h"
 #include "material.h"
 #include "utils.h"
 #include "surface.h"
 #include "mymath.h"
-
-int MaterialIndex( std::vector<Material *> & materials, const char * material_name )
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "scanner.h"
+#include "meshcache.h"
+#include "meshopt.h"
+#include "materialregistry.h"
+#include "normals.h"
+#include "tangents.h"
+#include "simplify.h"
+#include "meshlets.h"
+#include "profiler.h"
+
+#include <atomic>
+
+void ReleaseScene( std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
 {
-	int index = 0;
+	std::vector<Texture *> textures;
 
 	for ( Material * material : materials )
-	{		
-		if ( material->name().compare( material_name ) == 0 )
+	{
+		for ( int slot = 0; slot < NO_TEXTURES; ++slot )
 		{
-			return index;
+			Texture * texture = material->texture( slot );
+			if ( texture && std::find( textures.begin(), textures.end(), texture ) == textures.end() )
+			{
+				textures.push_back( texture );
+			}
+			material->set_texture( slot, nullptr );
 		}
-
-		index++;
 	}
 
-	return -1;
+	SafeDeleteVectorItems( surfaces );
+	SafeDeleteVectorItems( materials );
+	SafeDeleteVectorItems( textures );
+	surfaces.clear();
+	materials.clear();
 }
 
 Texture * TextureProxy(const std::string & full_name, std::map<std::string, Texture*> & already_loaded_textures,
-	const int flip = -1, const bool single_channel = false )
+	const int flip, const bool single_channel, ThreadPool * decoding_pool )
 {
-	std::map<std::string, Texture*>::iterator already_loaded_texture = already_loaded_textures.find(full_name);
+	// the same image may be used both as a color and a single channel map, those are different textures
+	const std::string key = single_channel ? full_name + "|single_channel" : full_name;
+	std::map<std::string, Texture*>::iterator already_loaded_texture = already_loaded_textures.find(key);
 	Texture * texture = NULL;
 	if (already_loaded_texture != already_loaded_textures.end())
 	{
@@ -37,217 +60,424 @@ Texture * TextureProxy(const std::string & full_name, std::map<std::string, Text
 	}
 	else
 	{
-		texture = new Texture( full_name.c_str() );// , flip, single_channel);
-		already_loaded_textures[full_name] = texture;
+		texture = new Texture( full_name.c_str(), decoding_pool != nullptr, single_channel );// , flip );
+		already_loaded_textures[key] = texture;
+
+		if ( decoding_pool )
+		{
+			decoding_pool->Enqueue( [texture]()
+			{
+				texture->Load();
+			} );
+		}
 	}
 
 	return texture;
 }
 
-/*! \fn LoadMTL( const char * file_name, const char * path, std::vector<Material *> & materials )
-\brief Nate materily z MTL souboru \a file_name.
-Soubor \a file_name se mus nachzet v cest \a path. Naten materily budou vrceny pes pole \a materials.
-\param file_name nzev MTL souboru vetn ppony.
-\param path cesta k zadanmu souboru.
-\param materials pole materil, do kterho se budou ukldat naten materily.
-*/
-int LoadMTL( const char * file_name, const char * path, std::vector<Material *> & materials )
+int LoadMTL( const char * file_name, const char * path, MaterialRegistry & materials, ThreadPool * decoding_pool )
 {
-	// oteven soouboru
-	FILE * file = fopen( file_name, "rt" );
-	if ( file == NULL )
+	PROFILE_ZONE( "LoadMTL" );
+
+	// the file is parsed straight from the page cache
+	MappedFile file( file_name );
+	if ( !file.is_open() )
 	{
 		printf( "File %s not found.\n", file_name );
 
 		return -1;
 	}
 
-	// naten celho souboru do pamti	
-	size_t file_size = static_cast<size_t>( GetFileSize64( file_name ) );	
-	char * buffer = new char[file_size + 1]; // +1 protoe budeme za posledn naten byte dvat NULL
-	char * buffer_backup = new char[file_size + 1];
+	printf( "Loading materials from '%s' (%0.1f KB)...\n", file_name, file.size() / 1024.0f );
 
-	printf( "Loading materials from '%s' (%0.1f KB)...\n", file_name, file_size / 1024.0f );
+	std::string material_name;
 
-	size_t number_of_items_read = fread( buffer, sizeof( *buffer ), file_size, file );
+	std::map<std::string, Texture*> already_loaded_textures;
+
+	Material * material = NULL;
 
-	// otestujeme korektnost naten dat
-	if ( !feof( file ) && ( number_of_items_read != file_size ) )
+	// registers the finished material, redefined names never get here (see newmtl)
+	auto add_material = [&materials, &material_name]( Material * new_material )
 	{
-		printf( "Unexpected end of file encountered.\n" );
+		new_material->set_name( material_name.c_str() );
+		materials.Add( new_material );
+		printf( "\r%I64u material(s)\t\t", materials.size() );
+	};
 
-		fclose( file );
-		file = NULL;
+	// scans a RGB triplet
+	auto scan_color = []( const char * p, const char * end, Color3f & color )
+	{
+		float values[3];
+		int no_values = 0;
+		ScanFloats( p, end, values, 3, no_values );
+		if ( no_values == 3 )
+		{
+			color = Color3f{ values[0], values[1], values[2] };
+		}
+	};
 
-		return -1;
-	}	
+	// scans a file name and returns its full path
+	auto scan_file_name = [path]( const char * p, const char * end )
+	{
+		const char * name_begin = p;
+		const char * name_end = p;
+		ScanToken( p, end, name_begin, name_end );
 
-	buffer[number_of_items_read] = 0; // zajistme korektn ukonen etzce
+		return std::string( path ).append( name_begin, name_end );
+	};
 
-	fclose( file ); // ukonme prci se souborem
-	file = NULL;
+	// --- all materials ---
+	const char * next_line = file.data();
+	while ( next_line < file.end() )
+	{
+		const char * line_end = static_cast<const char *>( memchr( next_line, '\n', file.end() - next_line ) );
+		if ( line_end == NULL )
+		{
+			line_end = file.end();
+		}
+		const char * line = next_line;
+		next_line = line_end + 1;
 
-	memcpy( buffer_backup, buffer, file_size + 1 ); // zloha bufferu
+		const char * keyword_begin = nullptr;
+		const char * keyword_end = nullptr;
+		const char * p = ScanToken( line, line_end, keyword_begin, keyword_end );
+		if ( ( p == line ) || ( keyword_begin[0] == '#' ) )
+		{
+			continue; // blank line or comment
+		}
+
+		auto is = [keyword_begin, keyword_end]( const char * keyword )
+		{
+			return TokenEquals( keyword_begin, keyword_end, keyword );
+		};
 
-	printf( "Done.\n\n");
+		if ( is( "newmtl" ) )
+		{
+			if ( material != NULL )
+			{
+				add_material( material );
+			}
 
-	printf( "Parsing mesh data...\n" );
+			const char * name_begin = p;
+			const char * name_end = p;
+			ScanToken( p, line_end, name_begin, name_end );
+			material_name.assign( name_begin, name_end );
 
-	char material_name[128] = { 0 };
-	char image_file_name[256] = { 0 };
+			// the first definition of a name wins, the statements of a redefinition are skipped so none of its textures is created
+			material = ( materials.Find( material_name ) < 0 ) ? new Material() : NULL;
+		}
+		else if ( material == NULL )
+		{
+			continue; // statements preceding the first newmtl or belonging to a redefined material
+		}
+		else if ( is( "Ka" ) ) // ambient color of the material
+		{
+			scan_color( p, line_end, material->ambient_ );
+			material->ambient_ = material->ambient_.linear();
+		}
+		else if ( is( "Kd" ) ) // diffuse color of the material
+		{
+			scan_color( p, line_end, material->diffuse_ );
+			material->diffuse_ = material->diffuse_.linear();
+		}
+		else if ( is( "Ks" ) ) // specular color of the material
+		{
+			scan_color( p, line_end, material->specular_ );
+			material->specular_ = material->specular_.linear();
+		}
+		else if ( is( "Ke" ) ) // emission color of the material
+		{
+			scan_color( p, line_end, material->emission_ );
+		}
+		else if ( is( "Ns" ) ) // specular coefficient
+		{
+			ScanFloat( p, line_end, material->shininess );
+		}
+		else if ( is( "map_Kd" ) ) // diffuse map
+		{
+			material->set_texture( Material::kDiffuseMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, false, decoding_pool ) );
+		}
+		else if ( is( "map_Ks" ) ) // specular map
+		{
+			material->set_texture( Material::kSpecularMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, false, decoding_pool ) );
+		}
+		else if ( is( "map_bump" ) ) // normal map
+		{
+			material->set_texture( Material::kNormalMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, false, decoding_pool ) );
+		}
+		else if ( is( "map_D" ) ) // opacity map
+		{
+			material->set_texture( Material::kOpacityMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, true, decoding_pool ) );
+		}
+		else if ( is( "map_Pr" ) ) // roughness map
+		{
+			material->set_texture( Material::kRoughnessMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, true, decoding_pool ) );
+		}
+		else if ( is( "map_Pm" ) ) // metallicness map
+		{
+			material->set_texture( Material::kMetallicnessMapSlot, TextureProxy( scan_file_name( p, line_end ), already_loaded_textures, -1, true, decoding_pool ) );
+		}
+		else if ( is( "shader" ) ) // used shader
+		{
+			int shader = 0;
+			ScanInt( p, line_end, shader );
+			material->set_shader( Shader( shader ) );
+		}
+		else if ( is( "Ni" ) || is( "ior" ) ) // index of refraction
+		{
+			ScanFloat( p, line_end, material->ior );
+		}
+		else if ( is( "Pr" ) ) // roughness
+		{
+			ScanFloat( p, line_end, material->roughness_ );
+		}
+		else if ( is( "Pm" ) ) // metallicness
+		{
+			ScanFloat( p, line_end, material->metallicness );
+		}
+	}
 
-	const char delim[] = "\n";
-	char * line = strtok( buffer, delim );
+	if ( material != NULL )
+	{
+		add_material( material );
+	}
+	material = NULL;
 
-	std::map<std::string, Texture*> already_loaded_textures;
+	printf( "\n" );
 
-	Material * material = NULL;
+	return 0;
+}
 
-	// --- natn vech materil ---
-	int material_index = 0;
-	while ( line != NULL )
+/* zero-based indices of a single face vertex, -1 stands for a missing index */
+struct OBJFaceVertex
+{
+	int position;
+	int texture_coord;
+	int normal;
+	char chunk_relative; // kRelative* flags of indices counted from the beginning of the chunk, see ResolveIndex
+};
+
+static const char kRelativePosition = 1;
+static const char kRelativeTextureCoord = 2;
+static const char kRelativeNormal = 4;
+
+/* group, usemtl or s statement, it applies to all face vertices from first_face_vertex on */
+struct OBJStatement
+{
+	enum Type : char { GROUP, USEMTL, SMOOTHING } type;
+	size_t first_face_vertex; // position in the face vertices of the same chunk
+	std::string name;
+	unsigned int smoothing_group{ 0 }; // 0 for s off
+};
+
+/* data parsed from a single newline aligned chunk of an OBJ file */
+struct OBJChunk
+{
+	const char * begin{ nullptr };
+	const char * end{ nullptr };
+
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> per_vertex_normals;
+	std::vector<Coord2f> texture_coords;
+	std::vector<OBJFaceVertex> face_vertices;
+	std::vector<OBJStatement> statements;
+	std::vector<std::string> material_libraries;
+
+	// offsets of this chunk's data in the merged arrays
+	size_t first_vertex{ 0 };
+	size_t first_per_vertex_normal{ 0 };
+	size_t first_texture_coord{ 0 };
+	size_t first_face_vertex{ 0 };
+};
+
+/* faces of a single group sharing one material */
+struct OBJGroup
+{
+	std::string name;
+	std::string material_name;
+	size_t first_face_vertex;
+	size_t no_face_vertices;
+};
+
+/* converts 1-based (positive) or relative (negative) OBJ index into a zero-based index, missing index is -1,
+relative indices are counted from the beginning of the chunk (they may even reach into preceding chunks) */
+static int ChunkIndex( const int obj_index, const size_t no_items_so_far, const char relative_flag, char & chunk_relative )
+{
+	if ( obj_index > 0 )
 	{
-		if ( line[0] != '#' )
+		return obj_index - 1;
+	}
+	else if ( obj_index < 0 )
+	{
+		chunk_relative |= relative_flag;
+
+		return static_cast<int>( no_items_so_far ) + obj_index; // -1 refers to the last item defined so far
+	}
+
+	return -1;
+}
+
+/* adds the chunk offset to chunk relative indices */
+static int ResolveIndex( const int index, const size_t chunk_offset, const char chunk_relative, const char relative_flag )
+{
+	return ( chunk_relative & relative_flag ) ? static_cast<int>( chunk_offset ) + index : index;
+}
+
+/* converts indices of a single face vertex as written in the file into zero-based chunk indices, missing indices are set to -1 */
+static void MakeFaceVertex( const int v, const int vt, const int vn, const OBJChunk & chunk, OBJFaceVertex & face_vertex )
+{
+	face_vertex.chunk_relative = 0;
+	face_vertex.position = ChunkIndex( v, chunk.vertices.size(), kRelativePosition, face_vertex.chunk_relative );
+	face_vertex.texture_coord = ChunkIndex( vt, chunk.texture_coords.size(), kRelativeTextureCoord, face_vertex.chunk_relative );
+	face_vertex.normal = ChunkIndex( vn, chunk.per_vertex_normals.size(), kRelativeNormal, face_vertex.chunk_relative );
+}
+
+/* parses all lines of the chunk */
+static void ParseOBJChunk( OBJChunk & chunk, const bool flip_yz )
+{
+	const char * next_line = chunk.begin;
+	while ( next_line < chunk.end )
+	{
+		const char * line_end = static_cast<const char *>( memchr( next_line, '\n', chunk.end - next_line ) );
+		if ( line_end == NULL )
 		{
-			if ( strstr( line, "newmtl" ) == line )
-			{
-				if ( material != NULL )
-				{
-					material->set_name( material_name );
-					if ( MaterialIndex( materials, material_name ) < 0 )
-					{
-						material->material_index = material_index;
-						materials.push_back( material );
-						printf( "\r%I64u material(s)\t\t", materials.size() );
-						material_index++;
-					}
-				}
-				material = NULL;
+			line_end = chunk.end;
+		}
+		const char * line = next_line;
+		next_line = line_end + 1;
 
-				sscanf( line, "%*s %s", &material_name );
-				//printf( "material name=%s\n", material_name );				
+		const char * keyword_begin = nullptr;
+		const char * keyword_end = nullptr;
+		const char * p = ScanToken( line, line_end, keyword_begin, keyword_end );
+		if ( p == line )
+		{
+			continue; // blank line
+		}
+		const size_t keyword_length = keyword_end - keyword_begin;
 
-				material = new Material();
-			}
-			else
+		switch ( keyword_begin[0] )
+		{
+		case 'm': // mtllib
 			{
-				char * tmp = Trim( line );				
-				if ( strstr( tmp, "Ka" ) == tmp ) // ambient color of the material
-				{
-					sscanf( tmp, "%*s %f %f %f", &material->ambient_.r, &material->ambient_.g, &material->ambient_.b );
-					material->ambient_ = material->ambient_.linear();
-				}
-				else if ( strstr( tmp, "Kd" ) == tmp ) // diffuse color of the material
+				const char * name_begin = nullptr;
+				const char * name_end = nullptr;
+				if ( TokenEquals( keyword_begin, keyword_end, "mtllib" ) && ScanToken( p, line_end, name_begin, name_end ) != p )
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->diffuse_.r, &material->diffuse_.g, &material->diffuse_.b );
-					material->diffuse_ = material->diffuse_.linear();
+					chunk.material_libraries.push_back( std::string( name_begin, name_end ) );
 				}
-				else if ( strstr( tmp, "Ks" ) == tmp ) // specular color of the material
-				{
-					sscanf( tmp, "%*s %f %f %f", &material->specular_.r, &material->specular_.g, &material->specular_.b );
-					material->specular_ = material->specular_.linear();
-				}
-				else if ( strstr( tmp, "Ke" ) == tmp ) // emission color of the material
+			}
+			break;
+
+		case 'v': // vertex, normal or texture coordinate
+			{
+				float values[3] = { 0.0f, 0.0f, 0.0f };
+				int no_values = 0;
+				ScanFloats( p, line_end, values, 3, no_values );
+
+				if ( keyword_length == 1 ) // vertex
 				{
-					sscanf( tmp, "%*s %f %f %f", &material->emission_.r, &material->emission_.g, &material->emission_.b );
-					//material->emission_ = material->emission_.linear();
+					chunk.vertices.push_back( flip_yz ? Vector3( values[0], -values[2], values[1] ) : Vector3( values ) );
 				}
-				else if ( strstr( tmp, "Ns" ) == tmp ) // specular coefficient
+				else if ( keyword_length == 2 && keyword_begin[1] == 'n' ) // vertex normal
 				{
-					sscanf( tmp, "%*s %f", &material->shininess );
-				}
-				else if ( strstr( tmp, "map_Kd" ) == tmp ) // diffuse map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture( Material::kDiffuseMapSlot, TextureProxy( full_name, already_loaded_textures ) );
-				}
-				else if ( strstr( tmp, "map_Ks" ) == tmp ) // specular map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture( Material::kSpecularMapSlot, TextureProxy( full_name, already_loaded_textures ) );
+					Vector3 normal = flip_yz ? Vector3( values[0], -values[2], values[1] ) : Vector3( values );
+					normal.Normalize();
+					chunk.per_vertex_normals.push_back( normal );
 				}
-				else if ( strstr( tmp, "map_bump" ) == tmp ) // normal map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string(path).append(image_file_name);
-					material->set_texture( Material::kNormalMapSlot, TextureProxy( full_name, already_loaded_textures ) );
-				}
-				else if ( strstr( tmp, "map_D" ) == tmp ) // opacity map
-				{					
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string(path).append(image_file_name);
-					material->set_texture( Material::kOpacityMapSlot, TextureProxy( full_name, already_loaded_textures, -1, true ) );
-				}
-				else if ( strstr( tmp, "map_Pr" ) == tmp ) // roughness map
+				else if ( keyword_length == 2 && keyword_begin[1] == 't' ) // texture coordinates
 				{
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture( Material::kRoughnessMapSlot, TextureProxy( full_name, already_loaded_textures, -1, true ) );
+					chunk.texture_coords.push_back( Coord2f{ values[0], values[1] } );
 				}
-				else if ( strstr( tmp, "map_Pm" ) == tmp ) // metallicness map
+			}
+			break;
+
+		case 'g': // group
+		case 'u': // usemtl
+			{
+				if ( keyword_length == 1 || TokenEquals( keyword_begin, keyword_end, "usemtl" ) )
 				{
-					sscanf( tmp, "%*s %s", image_file_name );
-					std::string full_name = std::string( path ).append( image_file_name );
-					material->set_texture( Material::kMetallicnessMapSlot, TextureProxy( full_name, already_loaded_textures, -1, true ) );
+					const char * name_begin = p;
+					const char * name_end = p;
+					ScanToken( p, line_end, name_begin, name_end );
+					chunk.statements.push_back( OBJStatement{ ( keyword_begin[0] == 'g' ) ? OBJStatement::GROUP : OBJStatement::USEMTL,
+						chunk.face_vertices.size(), std::string( name_begin, name_end ) } );
 				}
-				else if ( strstr( tmp, "shader" ) == tmp ) // used shader
+			}
+			break;
+
+		case 's': // smoothing group
+			{
+				if ( keyword_length == 1 )
 				{
-					int shader = 0;
-					sscanf( tmp, "%*s %d", &shader );
-					material->set_shader( Shader( shader ) );
-				}
-				else if ( strstr( tmp, "Ni" ) == tmp || strstr( tmp, "ior" ) == tmp ) // index of refraction
-				{					
-					sscanf( tmp, "%*s %f", &material->ior );
+					int smoothing_group = 0; // "s off" as well as "s 0"
+					ScanInt( p, line_end, smoothing_group );
+					chunk.statements.push_back( OBJStatement{ OBJStatement::SMOOTHING, chunk.face_vertices.size(), std::string(),
+						static_cast<unsigned int>( std::max( smoothing_group, 0 ) ) } );
 				}
-				else if ( strstr( tmp, "Pr" ) == tmp ) // roughness
+			}
+			break;
+
+		case 'f': // face
+			{
+				// triangles and quadrilaterals are supported
+				OBJFaceVertex face_vertices[4];
+				int no_face_vertices = 0;
+
+				for ( ; no_face_vertices < 4; ++no_face_vertices )
 				{
-					sscanf( tmp, "%*s %f", &material->roughness_ );
+					int v, vt, vn;
+					const char * q = ScanIndexTriplet( p, line_end, v, vt, vn );
+					if ( q == p )
+					{
+						break;
+					}
+					p = q;
+					MakeFaceVertex( v, vt, vn, chunk, face_vertices[no_face_vertices] );
 				}
-				else if ( strstr( tmp, "Pm" ) == tmp ) // metallicness
+
+				if ( no_face_vertices >= 3 )
 				{
-					sscanf( tmp, "%*s %f", &material->metallicness );
+					chunk.face_vertices.push_back( face_vertices[0] );
+					chunk.face_vertices.push_back( face_vertices[1] );
+					chunk.face_vertices.push_back( face_vertices[2] );
+
+					if ( no_face_vertices == 4 )
+					{
+						chunk.face_vertices.push_back( face_vertices[0] );
+						chunk.face_vertices.push_back( face_vertices[2] );
+						chunk.face_vertices.push_back( face_vertices[3] );
+					}
 				}
 			}
+			break;
 		}
-
-		line = strtok( NULL, delim ); // naten dalho dku
 	}
+}
 
-	if ( material != NULL )
+/* appends src to dst starting at the given position, dst has to be large enough */
+template<typename T> static void CopyChunkData( const std::vector<T> & src, std::vector<T> & dst, const size_t offset )
+{
+	if ( src.size() > 0 )
 	{
-		material->material_index = material_index;
-		material->set_name( material_name );
-		materials.push_back( material );
-		printf( "\r%I64u material(s)\t\t", materials.size() );
-		material_index++;
+		memcpy( &dst[offset], src.data(), sizeof( T ) * src.size() );
 	}
-	material = NULL;
-
-	//memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
-	SAFE_DELETE_ARRAY( buffer_backup );
-	SAFE_DELETE_ARRAY( buffer );	
-
-	printf( "\n" );
-
-	return 0;
 }
 
 int LoadOBJ( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials,
-	const bool flip_yz , const Vector3 default_color )
+	const OBJLoaderOptions & options )
 {
-	// oteven soouboru
-	FILE * file = fopen( file_name, "rt" );
-	if ( file == NULL )
+	PROFILE_ZONE( "LoadOBJ" );
+
+	// the file is parsed straight from the page cache, there is no heap copy of it
+	MappedFile file( file_name );
+	if ( !file.is_open() )
 	{
 		printf( "File %s not found.\n", file_name );
 
 		return -1;
 	}
 
-	// cesta k zadanmu souboru
+	// path to the given file
 	char path[128] = { "" };
 	const char * tmp = strrchr( file_name, '/' );
 	if ( tmp != NULL )
@@ -255,304 +485,365 @@ int LoadOBJ( const char * file_name, std::vector<Surface *> & surfaces, std::vec
 		memcpy( path, file_name, sizeof( char ) * ( tmp - file_name + 1 ) );
 	}
 
-	// naten celho souboru do pamti
-	/*const long long*/size_t file_size = static_cast<size_t>( GetFileSize64( file_name ) );
-	char * buffer = new char[file_size + 1]; // +1 protoe budeme za posledn naten byte dvat NULL
-	char * buffer_backup = new char[file_size + 1];	
+	ThreadPool thread_pool;
 
-	printf( "Loading model from '%s' (%0.1f MB)...\n", file_name, file_size / sqr( 1024.0f ) );
-
-	size_t number_of_items_read = fread( buffer, sizeof( *buffer ), file_size, file );
-
-	// otestujeme korektnost naten dat
-	if ( !feof( file ) && ( number_of_items_read != file_size ) )
+	// the cache key covers the content of the OBJ file and all parameters affecting the result
+	unsigned long long cache_key = 0;
+	if ( options.use_cache )
 	{
-		printf( "Unexpected end of file encountered.\n" );
+		const float parameters[] = { options.flip_yz ? 1.0f : 0.0f,
+			options.default_color.x, options.default_color.y, options.default_color.z, options.optimize_meshes ? 1.0f : 0.0f,
+			options.generate_normals ? 1.0f : 0.0f, options.crease_angle, options.generate_tangents ? 1.0f : 0.0f,
+			static_cast<float>( options.no_lods ), options.build_meshlets ? 1.0f : 0.0f };
+		cache_key = QuickHash( reinterpret_cast<const BYTE *>( parameters ), sizeof( parameters ), HashFile( file, thread_pool ) );
+
+		const int no_surfaces = LoadMeshCache( file_name, cache_key, thread_pool, surfaces, materials );
+		if ( no_surfaces >= 0 )
+		{
+			// the cached scene is complete at once
+			if ( options.on_materials_loaded )
+			{
+				options.on_materials_loaded();
+			}
+			if ( options.on_surface_loaded )
+			{
+				for ( auto surface = surfaces.end() - no_surfaces; surface != surfaces.end(); ++surface )
+				{
+					options.on_surface_loaded( *surface );
+				}
+			}
 
-		fclose( file );
-		file = NULL;
+			return no_surfaces;
+		}
+	}
 
-		return -1;
-	}	
+	printf( "Loading model from '%s' (%0.1f MB)...\n", file_name, file.size() / sqr( 1024.0f ) );
 
-	buffer[number_of_items_read] = 0; // zajistme korektn ukonen etzce
+	// --- split the file into newline aligned chunks, a few per thread to balance the load ---
+	const size_t min_chunk_size = 1 << 20;
+	const size_t chunk_size = std::max( min_chunk_size, file.size() / ( 4 * thread_pool.no_threads() ) + 1 );
 
-	fclose( file ); // ukonme prci se souborem
-	file = NULL;
+	std::vector<OBJChunk> chunks;
+	for ( const char * begin = file.data(); begin < file.end(); )
+	{
+		const char * end = begin + std::min( chunk_size, static_cast<size_t>( file.end() - begin ) );
+		const char * line_end = static_cast<const char *>( memchr( end, '\n', file.end() - end ) );
+		end = ( line_end != NULL ) ? line_end + 1 : file.end();
+
+		chunks.push_back( OBJChunk() );
+		chunks.back().begin = begin;
+		chunks.back().end = end;
+		begin = end;
+	}
 
-	memcpy( buffer_backup, buffer, file_size + 1 ); // zloha bufferu
+	// --- parse all chunks in parallel ---
+	thread_pool.ParallelFor( static_cast<int>( chunks.size() ), [&chunks, &options]( const int i )
+	{
+		PROFILE_ZONE( "ParseOBJChunk" );
+		ParseOBJChunk( chunks[i], options.flip_yz );
+	} );
+
+	// --- material libraries, the textures are decoded while the geometry is being merged and built ---
+	ThreadPool texture_pool;
+	std::vector<std::string> material_libraries;
+	for ( const OBJChunk & chunk : chunks )
+	{
+		for ( const std::string & material_library : chunk.material_libraries )
+		{
+			printf( "Material library: %s\n", material_library.c_str() );
+			material_libraries.push_back( std::string( path ).append( material_library ) );
+		}
+	}
 
-	printf( "Done.\n\n");
+	MaterialRegistry material_registry( materials );
+	for ( const std::string & material_library : material_libraries )
+	{
+		LoadMTL( material_library.c_str(), path, material_registry, &texture_pool );
+	}
+	if ( options.on_materials_loaded )
+	{
+		options.on_materials_loaded();
+	}
 
-	printf( "Parsing material data...\n" );
+	// --- merge the chunks in order ---
+	size_t no_vertices = 0, no_per_vertex_normals = 0, no_texture_coords = 0, no_face_vertices = 0;
+	for ( OBJChunk & chunk : chunks )
+	{
+		chunk.first_vertex = no_vertices;
+		chunk.first_per_vertex_normal = no_per_vertex_normals;
+		chunk.first_texture_coord = no_texture_coords;
+		chunk.first_face_vertex = no_face_vertices;
+
+		no_vertices += chunk.vertices.size();
+		no_per_vertex_normals += chunk.per_vertex_normals.size();
+		no_texture_coords += chunk.texture_coords.size();
+		no_face_vertices += chunk.face_vertices.size();
+	}
 
-	char material_library[128] = { 0 };
+	std::vector<Vector3> vertices( no_vertices );
+	std::vector<Vector3> per_vertex_normals( no_per_vertex_normals );
+	std::vector<Coord2f> texture_coords( no_texture_coords );
+	std::vector<OBJFaceVertex> face_vertices( no_face_vertices );
+	std::atomic<bool> normals_missing{ false };
 
-	std::vector<std::string> material_libraries;	
+	thread_pool.ParallelFor( static_cast<int>( chunks.size() ), [&]( const int i )
+	{
+		OBJChunk & chunk = chunks[i];
 
-	const char delim[] = "\n";
-	char * line = strtok( buffer, delim );	
+		CopyChunkData( chunk.vertices, vertices, chunk.first_vertex );
+		CopyChunkData( chunk.per_vertex_normals, per_vertex_normals, chunk.first_per_vertex_normal );
+		CopyChunkData( chunk.texture_coords, texture_coords, chunk.first_texture_coord );
 
-	// --- natn vech materilovch knihoven, prvn prchod ---
-	while ( line != NULL )
-	{
-		switch ( line[0] )
-		{	
-		case 'm': // mtllib
+		for ( size_t j = 0; j < chunk.face_vertices.size(); ++j )
+		{
+			const OBJFaceVertex & face_vertex = chunk.face_vertices[j];
+			OBJFaceVertex & merged_face_vertex = face_vertices[chunk.first_face_vertex + j];
+			merged_face_vertex = OBJFaceVertex{
+				ResolveIndex( face_vertex.position, chunk.first_vertex, face_vertex.chunk_relative, kRelativePosition ),
+				ResolveIndex( face_vertex.texture_coord, chunk.first_texture_coord, face_vertex.chunk_relative, kRelativeTextureCoord ),
+				ResolveIndex( face_vertex.normal, chunk.first_per_vertex_normal, face_vertex.chunk_relative, kRelativeNormal ), 0 };
+
+			// normals referring outside of the file are treated as missing and generated
+			if ( merged_face_vertex.normal < 0 || merged_face_vertex.normal >= static_cast<int>( no_per_vertex_normals ) )
 			{
-				sscanf( line, "%*s %s", &material_library );
-				printf( "Material library: %s\n", material_library );				
-				material_libraries.push_back( std::string( path ).append( std::string( material_library ) ) );
+				merged_face_vertex.normal = -1;
+				normals_missing.store( true, std::memory_order_relaxed );
 			}
-			break;
-		}
 
-		line = strtok( NULL, delim ); // naten dalho dku
-	}
+			// so are texture coords, whereas a position outside of the file invalidates the whole face
+			if ( merged_face_vertex.texture_coord >= static_cast<int>( no_texture_coords ) )
+			{
+				merged_face_vertex.texture_coord = -1;
+			}
+			if ( merged_face_vertex.position < 0 || merged_face_vertex.position >= static_cast<int>( no_vertices ) )
+			{
+				merged_face_vertex.position = -1;
+			}
+		}
 
-	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+		// release the chunk copies as soon as possible to keep the peak memory low
+		std::vector<Vector3>().swap( chunk.vertices );
+		std::vector<Vector3>().swap( chunk.per_vertex_normals );
+		std::vector<Coord2f>().swap( chunk.texture_coords );
+		std::vector<OBJFaceVertex>().swap( chunk.face_vertices );
+	} );
 
-	for ( int i = 0; i < static_cast<int>( material_libraries.size() ); ++i )
-	{		
-		LoadMTL( material_libraries[i].c_str(), path, materials );
-	}
+	printf( "%I64u vertices, %I64u normals and %I64u texture coords.\n",
+		vertices.size(), per_vertex_normals.size(), texture_coords.size() );
 
-	std::vector<Vector3> vertices; // cel jeden soubor
-	std::vector<Vector3> per_vertex_normals;
-	std::vector<Coord2f> texture_coords;	
+	// --- replay group, usemtl and s statements across chunk boundaries ---
+	std::vector<OBJGroup> groups;
+	std::string group_name = "default";
+	std::string material_name;
+	size_t group_begin = 0;
+	std::vector<std::pair<size_t, unsigned int>> smoothing_changes{ { 0, 1 } }; // faces preceding any s statement are smoothed
 
-	line = strtok( buffer, delim );	
-	//line = Trim( line );
+	auto close_group = [&]( const size_t group_end )
+	{
+		if ( group_end > group_begin )
+		{
+			groups.push_back( OBJGroup{ group_name, material_name, group_begin, group_end - group_begin } );
+		}
+		group_begin = group_end;
+	};
 
-	// --- natn vech souadnic, druh prchod ---
-	while ( line != NULL )
+	for ( const OBJChunk & chunk : chunks )
 	{
-		switch ( line[0] )
+		for ( const OBJStatement & statement : chunk.statements )
 		{
-		case 'v': // seznam vrchol, norml nebo texturovacch souadnic aktuln skupiny			
+			if ( statement.type == OBJStatement::GROUP )
 			{
-				switch ( line[1] )
-				{
-				case ' ': // vertex
-					{
-						Vector3 vertex;
-						if ( flip_yz )
-						{
-							//float x, y, z;
-							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.z, &vertex.y );
-							vertex.y *= -1;
-						}
-						else
-						{
-							sscanf( line, "%*s %f %f %f", &vertex.x, &vertex.y, &vertex.z );
-						}
-
-						vertices.push_back( vertex );
-					}
-					break;
-
-				case 'n': // normla vertexu
-					{
-						Vector3 normal;
-						if ( flip_yz )
-						{			
-							//float x, y, z;
-							sscanf( line, "%*s %f %f %f", &normal.x, &normal.z, &normal.y );							
-							normal.y *= -1;
-						}
-						else
-						{
-							sscanf( line, "%*s %f %f %f", &normal.x, &normal.y, &normal.z );
-						}
-						normal.Normalize();
-						per_vertex_normals.push_back( normal );
-					}
-					break;
-
-				case 't': // texturovac souadnice
-					{
-						Coord2f texture_coord;
-						float z = 0;
-						sscanf( line, "%*s %f %f %f",
-							&texture_coord.u, &texture_coord.v, &z );					
-						texture_coords.push_back( texture_coord );
-					}
-					break;
-				}
+				close_group( chunk.first_face_vertex + statement.first_face_vertex );
+				group_name = statement.name;
+			}
+			else if ( statement.type == OBJStatement::USEMTL )
+			{
+				material_name = statement.name; // the last usemtl of a group applies to the whole group
+			}
+			else
+			{
+				smoothing_changes.push_back( std::make_pair( chunk.first_face_vertex + statement.first_face_vertex, statement.smoothing_group ) );
 			}
-			break;		
 		}
-
-		line = strtok( NULL, delim ); // naten dalho dku
-		//line = Trim( line );
 	}
+	close_group( face_vertices.size() );
+	chunks.clear();
 
-	memcpy( buffer, buffer_backup, file_size + 1 ); // obnoven bufferu po innosti strtok
+	// --- normals of the files without vn (or with some of them missing) ---
+	std::vector<Vector3> generated_normals;
+	if ( ( options.generate_normals || normals_missing ) && !face_vertices.empty() ) // a file without faces, e.g. a point cloud, has nothing to shade
+	{
+		const int no_triangles = static_cast<int>( face_vertices.size() / 3 );
+		std::vector<unsigned int> smoothing_groups( no_triangles );
+		for ( size_t i = 0; i < smoothing_changes.size(); ++i )
+		{
+			const size_t first_triangle = smoothing_changes[i].first / 3;
+			const size_t last_triangle = ( i + 1 < smoothing_changes.size() ) ? smoothing_changes[i + 1].first / 3 : no_triangles;
+			std::fill( smoothing_groups.begin() + first_triangle, smoothing_groups.begin() + last_triangle, smoothing_changes[i].second );
+		}
 
-	printf( "%I64u vertices, %I64u normals and %I64u texture coords.\n",
-		vertices.size(), per_vertex_normals.size(), texture_coords.size() );
+		generated_normals.resize( face_vertices.size() );
+		GenerateNormals( vertices.data(), static_cast<int>( vertices.size() ), &face_vertices[0].position, sizeof( OBJFaceVertex ),
+			no_triangles, smoothing_groups.data(), deg2rad( options.crease_angle ), thread_pool, generated_normals.data() );
 
-	/// buffery pro natn etzc	
-	char group_name[128];	
-	char material_name[128];
-	char vertices_indices[4][8 * 3 + 2];	// pomocn etzec pro natn index a 4 x "v/vt/vn"
-	char vertex_indices[3][8];				// pomocn etzec jednotlivch index "v", "vt" a "vn"	
+		printf( "Normals of %d triangles generated (crease angle %0.1f deg).\n", no_triangles, options.crease_angle );
+	}
 
-	std::vector<Vertex> face_vertices; // pole vech vertex prv natan face
+	// --- build surfaces of all groups in parallel ---
+	std::vector<Surface *> group_surfaces( groups.size(), nullptr );
+	std::vector<VertexCacheStatistics> statistics_before( groups.size() ), statistics_after( groups.size() );
+	std::atomic<size_t> no_dropped_faces{ 0 };
 
-	int no_surfaces = 0; // poet natench ploch
+	thread_pool.ParallelFor( static_cast<int>( groups.size() ), [&]( const int i )
+	{
+		PROFILE_ZONE( "BuildGroupSurface" );
+		const OBJGroup & group = groups[i];
 
-	line = strtok( buffer, delim ); // reset
-	//line = Trim( line );
+		std::vector<Vertex> group_vertices;
+		group_vertices.reserve( group.no_face_vertices );
 
-	// --- natn jednotlivch objekt (group), tet prchod ---
-	while ( line != NULL )
-	{
-		switch ( line[0] )
+		for ( size_t j = group.first_face_vertex; j < group.first_face_vertex + group.no_face_vertices; j += 3 )
 		{
-		case 'g': // group
+			if ( face_vertices[j].position < 0 || face_vertices[j + 1].position < 0 || face_vertices[j + 2].position < 0 )
 			{
-				if ( face_vertices.size() > 0 )
-				{
-					surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
-					printf( "\r%I64u group(s)\t\t", surfaces.size() );
-					++no_surfaces;
-					face_vertices.clear();
-
-					for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
-					{
-						if ( materials[i]->name().compare( material_name ) == 0 )
-						{
-							Surface * s = *--surfaces.end();
-							s->set_material( materials[i] );
-							break;
-						}
-					}
-				}
-
-				sscanf( line, "%*s %s", &group_name );
-				//printf( "Group name: %s\n", group_name );				
+				no_dropped_faces.fetch_add( 1, std::memory_order_relaxed );
+				continue;
 			}
-			break;
 
-		case 'u': // usemtl			
+			for ( size_t k = j; k < j + 3; ++k )
 			{
-				sscanf( line, "%*s %s", &material_name );
-				//printf( "Material name: %s\n", material_name );						
+				const OBJFaceVertex & face_vertex = face_vertices[k];
+
+				const bool use_generated_normal = !generated_normals.empty() && ( options.generate_normals || face_vertex.normal < 0 );
+
+				group_vertices.push_back( Vertex( vertices[face_vertex.position],
+					use_generated_normal ? generated_normals[k] : per_vertex_normals[face_vertex.normal],
+					options.default_color, ( face_vertex.texture_coord >= 0 ) ? &texture_coords[face_vertex.texture_coord] : NULL ) );
 			}
-			break;
+		}
 
-		case 'f': // face
-			{
-				// ! pedpokldme pouze trojhelnky !
-				// ! pedpokldme vyuit vech t poloek v/vt/vn !				
-				int no_slashes = 0;
-				for ( int i = 0; i < int( strlen( line ) ); ++i )
-				{
-					if ( line[i] == '/' )
-					{
-						++no_slashes;
-					}
-				}
-				switch ( no_slashes )
-				{
-				case 2*3: // triangles
-					sscanf( line, "%*s %s %s %s",
-						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2] );
-					break;
-
-				case 2*4: // quadrilaterals				
-					sscanf( line, "%*s %s %s %s %s",
-						&vertices_indices[0], &vertices_indices[1], &vertices_indices[2], &vertices_indices[3] );
-					break;
-				}
+		if ( group_vertices.empty() )
+		{
+			return; // all faces of the group were dropped
+		}
 
-				// TODO smoothing groups
+		group_surfaces[i] = BuildSurface( group.name, group_vertices );
 
-				for ( int i = 0; i < 3; ++i )				
-				{									
-					if (strstr(vertices_indices[i], "//"))
-					{
-						sscanf(vertices_indices[i], "%[0-9]//%[0-9]",
-							&vertex_indices[0], &vertex_indices[2]);
-						vertex_indices[1][0] = 0;
-					}
-					else
-					{
-						sscanf(vertices_indices[i], "%[0-9]/%[0-9]/%[0-9]",
-							&vertex_indices[0], &vertex_indices[1], &vertex_indices[2]);
-					}
+		if ( options.generate_tangents )
+		{
+			// tangents are averaged over the welded vertices, the corners are welded again as vertices with different tangents split
+			GenerateTangents( group_surfaces[i], group_vertices, thread_pool );
+			delete group_surfaces[i];
+			group_surfaces[i] = BuildSurface( group.name, group_vertices );
+		}
 
-					const int vertex_index = atoi( vertex_indices[0] ) - 1;					
-					const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
-					const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
+		if ( options.optimize_meshes )
+		{
+			statistics_before[i] = AnalyzeVertexCache( group_surfaces[i] );
+			OptimizeSurface( group_surfaces[i] );
+			statistics_after[i] = AnalyzeVertexCache( group_surfaces[i] );
+		}
 
-					if (texture_coord_index >= 0)
-					{
-						face_vertices.push_back(Vertex(vertices[vertex_index],
-							per_vertex_normals[per_vertex_normal_index],
-							default_color, &texture_coords[texture_coord_index]));
-					}
-					else
-					{
-						face_vertices.push_back(Vertex(vertices[vertex_index],
-							per_vertex_normals[per_vertex_normal_index],
-							default_color));
-					}
-					
-				}
+		if ( options.build_meshlets )
+		{
+			// meshlets are grown along the optimized order, so most of the vertex cache locality is kept
+			BuildMeshlets( group_surfaces[i] );
+		}
 
-				if ( no_slashes == 2*4 )
-				{
-					const int i[] = { 0, 2, 3 };
-					for ( int j = 0; j < 3; ++j )
-					{				
-						sscanf( vertices_indices[i[j]], "%[0-9]/%[0-9]/%[0-9]",					
-							&vertex_indices[0], &vertex_indices[1], &vertex_indices[2] );
-
-						const int vertex_index = atoi( vertex_indices[0] ) - 1;
-						const int texture_coord_index = atoi( vertex_indices[1] ) - 1;
-						const int per_vertex_normal_index = atoi( vertex_indices[2] ) - 1;
-
-						face_vertices.push_back( Vertex( vertices[vertex_index],
-							per_vertex_normals[per_vertex_normal_index],
-							default_color, &texture_coords[texture_coord_index] ) );
-					}
-				}
+		// the levels index the final vertex pool, so they are generated after its reordering
+		GenerateLods( group_surfaces[i], std::min( options.no_lods, MAX_LODS - 1 ) );
+
+		// the surface is handed over as soon as it is finished, the textures of its material may still be decoding
+		Material * material = material_registry.Get( group.material_name );
+		if ( material )
+		{
+			group_surfaces[i]->set_material( material );
+		}
+		if ( options.on_surface_loaded )
+		{
+			options.on_surface_loaded( group_surfaces[i] );
+		}
+	} );
+
+	if ( no_dropped_faces > 0 )
+	{
+		printf( "Warning: %I64u face(s) referring to vertices outside of the file dropped.\n", no_dropped_faces.load() );
+
+		// groups without any valid face have no surface
+		size_t no_groups = 0;
+		for ( size_t i = 0; i < groups.size(); ++i )
+		{
+			if ( group_surfaces[i] )
+			{
+				groups[no_groups] = groups[i];
+				group_surfaces[no_groups++] = group_surfaces[i];
 			}
-			break;
 		}
+		groups.resize( no_groups );
+		group_surfaces.resize( no_groups );
+	}
 
-		line = strtok( NULL, delim ); // naten dalho dku
-		//line = Trim( line );
+	if ( options.optimize_meshes )
+	{
+		VertexCacheStatistics before, after;
+		for ( size_t i = 0; i < statistics_before.size(); ++i )
+		{
+			before += statistics_before[i];
+			after += statistics_after[i];
+		}
+
+		printf( "Vertex cache: ACMR %0.3f -> %0.3f, ATVR %0.3f -> %0.3f\n", before.acmr(), after.acmr(), before.atvr(), after.atvr() );
 	}
 
-	if ( face_vertices.size() > 0 )
+	if ( options.build_meshlets )
 	{
-		surfaces.push_back( BuildSurface( std::string( group_name ), face_vertices ) );
-		printf( "\r%I64u group(s)\t\t", surfaces.size() );
-		++no_surfaces;
-		face_vertices.clear();
+		size_t no_meshlets = 0, no_meshlet_vertices = 0, no_triangles = 0;
+		for ( Surface * surface : group_surfaces )
+		{
+			no_meshlets += surface->get_meshlets().meshlets.size();
+			no_meshlet_vertices += surface->get_meshlets().vertices.size();
+			no_triangles += surface->no_triangles();
+		}
+
+		printf( "Meshlets: %I64u, %0.1f vertices and %0.1f triangles per meshlet, %0.1f MB of local indices instead of %0.1f MB\n",
+			no_meshlets, no_meshlet_vertices / static_cast<float>( std::max<size_t>( no_meshlets, 1 ) ),
+			no_triangles / static_cast<float>( std::max<size_t>( no_meshlets, 1 ) ),
+			( no_meshlet_vertices * sizeof( unsigned int ) + no_triangles * 3 ) / sqr( 1024.0f ), no_triangles * sizeof( Triangle3ui ) / sqr( 1024.0f ) );
+	}
 
-		for ( int i = 0; i < static_cast<int>( materials.size() ); ++i )
+	if ( options.no_lods > 0 )
+	{
+		size_t lod_triangles[MAX_LODS] = { 0 };
+		for ( Surface * surface : group_surfaces )
 		{
-			if ( materials[i]->name().compare( material_name ) == 0 )
+			for ( int j = 0; j < MAX_LODS; ++j )
 			{
-				Surface * s = *--surfaces.end();
-				s->set_material( materials[i] );
-				break;
+				// surfaces with fewer levels are drawn by their coarsest one
+				const int level = std::min( j, surface->no_lods() );
+				lod_triangles[j] += ( level == 0 ) ? surface->no_triangles() : surface->get_lod( level - 1 ).indices.size();
 			}
 		}
+
+		printf( "Levels of detail:" );
+		for ( int j = 0; j < MAX_LODS; ++j )
+		{
+			printf( " %I64u", lod_triangles[j] );
+		}
+		printf( " triangles\n" );
 	}
 
-	texture_coords.clear();
-	per_vertex_normals.clear();
-	vertices.clear();	
+	texture_pool.Wait(); // the materials are complete once their textures are decoded
 
-	SAFE_DELETE_ARRAY( buffer_backup );
-	SAFE_DELETE_ARRAY( buffer );	
+	surfaces.insert( surfaces.end(), group_surfaces.begin(), group_surfaces.end() );
 
-	printf( "\nDone.\n\n");
+	printf( "%I64u group(s)\n", groups.size() );
+
+	printf( "Done.\n\n" );
+
+	if ( options.use_cache )
+	{
+		SaveMeshCache( file_name, cache_key, thread_pool, material_libraries, surfaces, materials );
+	}
 
-	return no_surfaces;
+	return static_cast<int>( groups.size() );
 }
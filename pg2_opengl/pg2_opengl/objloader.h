@@ -4,16 +4,57 @@
 #include "vector3.h"
 #include "surface.h"
 
-int MaterialIndex( std::vector<Material *> & materials, const char * material_name );
+class ThreadPool;
+class MaterialRegistry;
 
-/*! \fn int LoadOBJ( const char * file_name, Vector3 & default_color, std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+/*! \fn void ReleaseScene( std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+\brief Deletes all surfaces and materials, textures shared among materials are deleted exactly once.
+*/
+void ReleaseScene( std::vector<Surface *> & surfaces, std::vector<Material *> & materials );
+
+/*! \fn Texture * TextureProxy( const std::string & full_name, std::map<std::string, Texture*> & already_loaded_textures, const int flip, const bool single_channel, ThreadPool * decoding_pool )
+\brief Returns the texture loaded from \a full_name, each file is loaded only once.
+\param decoding_pool if not null, the image is decoded asynchronously on this pool and the texture must not be used before the pool is waited for.
+*/
+Texture * TextureProxy( const std::string & full_name, std::map<std::string, Texture*> & already_loaded_textures,
+	const int flip = -1, const bool single_channel = false, ThreadPool * decoding_pool = nullptr );
+
+/*! \struct OBJLoaderOptions
+\brief Parameters of LoadOBJ.
+*/
+struct OBJLoaderOptions
+{
+	bool flip_yz{ false }; /*!< Swap y and z axes, (x, y, z) -> (x, -z, y). */
+	Vector3 default_color{ 0.5f, 0.5f, 0.5f }; /*!< Default vertex color. */
+	bool optimize_meshes{ true }; /*!< Reorder triangles and vertices of surfaces for the vertex cache, overdraw and vertex fetch (see meshopt.h). */
+	bool use_cache{ true }; /*!< Load the scene from the binary cache next to the OBJ file (see meshcache.h) and write it there when missing or stale. */
+	bool generate_normals{ false }; /*!< Replace normals from the file by generated ones, otherwise only missing normals are generated (see normals.h). */
+	float crease_angle{ 60.0f }; /*!< Maximal angle (in degrees) between faces of the same smoothing group sharing a generated normal. */
+	bool generate_tangents{ true }; /*!< Fill Vertex::tangent and tangent_sign for normal mapping (see tangents.h), the result is cached. */
+	int no_lods{ 4 }; /*!< Number of simplified levels of detail generated for every surface (see simplify.h), at most MAX_LODS - 1. */
+	bool build_meshlets{ true }; /*!< Split surfaces into meshlets for culling and reorder their triangles accordingly (see meshlets.h). */
+	std::function<void()> on_materials_loaded; /*!< Called once all materials are registered, before any surface is finished (their textures may still be decoding). */
+	std::function<void( Surface * )> on_surface_loaded; /*!< Called for each surface once it is complete, concurrently from the worker threads, the surface stays owned by the scene. */
+};
+
+/*! \fn int LoadOBJ( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials, const OBJLoaderOptions & options )
 \brief Nate geometrii z OBJ souboru \a file_name.
 \param file_name pln cesta k OBJ souboru vetn ppony.
 \param surfaces pole ploch, do kterho se budou ukldat naten plochy.
 \param materials pole materil, do kterho se budou ukldat naten materily.
-\param default_color vchoz barva vertexu.
+\param options parameters of the loader.
 */
 int LoadOBJ( const char * file_name, std::vector<Surface *> & surfaces, std::vector<Material *> & materials,
-	const bool flip_yz = false, const Vector3 default_color = Vector3( 0.5f, 0.5f, 0.5f ) );
+	const OBJLoaderOptions & options = OBJLoaderOptions() );
+
+/*! \fn int LoadMTL( const char * file_name, const char * path, MaterialRegistry & materials, ThreadPool * decoding_pool )
+\brief Nate materily z MTL souboru \a file_name.
+Soubor \a file_name se mus nachzet v cest \a path. Naten materily budou vrceny pes pole \a materials.
+\param file_name nzev MTL souboru vetn ppony.
+\param path cesta k zadanmu souboru.
+\param materials registry of the loaded materials, materials with already registered names are skipped.
+\param decoding_pool optional pool decoding the textures asynchronously, see TextureProxy.
+*/
+int LoadMTL( const char * file_name, const char * path, MaterialRegistry & materials, ThreadPool * decoding_pool = nullptr );
 
 #endif
@@ -0,0 +1,414 @@
+#include "pch.h"
+#include "occlusion.h"
+#include "profiler.h"
+
+#include <float.h>
+#include <emmintrin.h>
+
+/* clip space coordinates of the point */
+static void TransformToClip( const Matrix4x4 & m, const Vector3 & p, float clip[4] )
+{
+	for ( int i = 0; i < 4; ++i )
+	{
+		clip[i] = m.get( i, 0 ) * p.x + m.get( i, 1 ) * p.y + m.get( i, 2 ) * p.z + m.get( i, 3 );
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer( const int width, const int height )
+{
+	width_ = ( ( std::max( width, 1 ) + kTileSize - 1 ) / kTileSize ) * kTileSize;
+	height_ = ( ( std::max( height, 1 ) + kTileSize - 1 ) / kTileSize ) * kTileSize;
+	no_tiles_x_ = width_ / kTileSize;
+
+	depth_.resize( size_t( width_ ) * height_, 0.0f );
+	tile_depth_.resize( size_t( no_tiles_x_ ) * no_tile_rows(), 0.0f );
+}
+
+void OcclusionBuffer::ProjectTriangles( const Matrix4x4 & clip_from_object, const Vector3 * positions, const Triangle3ui * triangles,
+	const int no_triangles, std::vector<ScreenTriangle> & screen_triangles ) const
+{
+	for ( int t = 0; t < no_triangles; ++t )
+	{
+		ScreenTriangle triangle;
+		bool in_front = true;
+
+		for ( int k = 0; k < 3 && in_front; ++k )
+		{
+			float clip[4];
+			TransformToClip( clip_from_object, positions[( &triangles[t].v0 )[k]], clip );
+			in_front = clip[2] >= -clip[3] && clip[3] > 0.0f;
+
+			const float rw = 1.0f / clip[3];
+			triangle.x[k] = ( clip[0] * rw * 0.5f + 0.5f ) * width_;
+			triangle.y[k] = ( clip[1] * rw * 0.5f + 0.5f ) * height_;
+			triangle.z[k] = rw;
+		}
+
+		if ( in_front )
+		{
+			screen_triangles.push_back( triangle );
+		}
+	}
+}
+
+void OcclusionBuffer::RasterizeTileRow( const int row, const std::vector<std::vector<ScreenTriangle>> & screen_triangles )
+{
+	const int row_y0 = row * kTileSize;
+	const int row_y1 = row_y0 + kTileSize - 1;
+	std::fill( depth_.begin() + size_t( row_y0 ) * width_, depth_.begin() + size_t( row_y1 + 1 ) * width_, 0.0f );
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pixel_offsets = _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f ); // pixel centers of four adjacent pixels
+
+	for ( const std::vector<ScreenTriangle> & triangles : screen_triangles )
+	{
+		for ( const ScreenTriangle & triangle : triangles )
+		{
+			// rows and columns of the pixel centers within the bounds of the triangle
+			const float min_y = std::min( triangle.y[0], std::min( triangle.y[1], triangle.y[2] ) );
+			const float max_y = std::max( triangle.y[0], std::max( triangle.y[1], triangle.y[2] ) );
+			const int y0 = static_cast<int>( ceilf( std::max( min_y - 0.5f, static_cast<float>( row_y0 ) ) ) );
+			const int y1 = static_cast<int>( floorf( std::min( max_y - 0.5f, static_cast<float>( row_y1 ) ) ) );
+			if ( y0 > y1 )
+			{
+				continue;
+			}
+
+			const float min_x = std::min( triangle.x[0], std::min( triangle.x[1], triangle.x[2] ) );
+			const float max_x = std::max( triangle.x[0], std::max( triangle.x[1], triangle.x[2] ) );
+			const int x0 = static_cast<int>( ceilf( std::max( min_x - 0.5f, 0.0f ) ) ) & ~3;
+			const int x1 = static_cast<int>( floorf( std::min( max_x - 0.5f, static_cast<float>( width_ - 1 ) ) ) );
+			if ( x0 > x1 )
+			{
+				continue;
+			}
+
+			// both orientations occlude, the vertices are swapped so that the inside has all edge functions positive
+			const float area = ( triangle.x[1] - triangle.x[0] ) * ( triangle.y[2] - triangle.y[0] ) -
+				( triangle.y[1] - triangle.y[0] ) * ( triangle.x[2] - triangle.x[0] );
+			if ( fabsf( area ) < 1e-6f )
+			{
+				continue;
+			}
+			const int order[3] = { 0, ( area > 0.0f ) ? 1 : 2, ( area > 0.0f ) ? 2 : 1 };
+
+			// edge functions e = a x + b y + c of the edges v0 v1, v1 v2 and v2 v0
+			__m128 a[3], b[3], c[3];
+			for ( int i = 0; i < 3; ++i )
+			{
+				const int va = order[i];
+				const int vb = order[( i + 1 ) % 3];
+				const float ea = -( triangle.y[vb] - triangle.y[va] );
+				const float eb = triangle.x[vb] - triangle.x[va];
+				a[i] = _mm_set1_ps( ea );
+				b[i] = _mm_set1_ps( eb );
+				c[i] = _mm_set1_ps( -( ea * triangle.x[va] + eb * triangle.y[va] ) );
+			}
+
+			// plane of 1/w
+			const float dzdx = ( ( triangle.z[1] - triangle.z[0] ) * ( triangle.y[2] - triangle.y[0] ) -
+				( triangle.y[1] - triangle.y[0] ) * ( triangle.z[2] - triangle.z[0] ) ) / area;
+			const float dzdy = ( ( triangle.x[1] - triangle.x[0] ) * ( triangle.z[2] - triangle.z[0] ) -
+				( triangle.z[1] - triangle.z[0] ) * ( triangle.x[2] - triangle.x[0] ) ) / area;
+			const __m128 z_dx = _mm_set1_ps( dzdx );
+
+			for ( int y = y0; y <= y1; ++y )
+			{
+				const __m128 py = _mm_set1_ps( y + 0.5f );
+				const __m128 row_e0 = _mm_add_ps( _mm_mul_ps( b[0], py ), c[0] );
+				const __m128 row_e1 = _mm_add_ps( _mm_mul_ps( b[1], py ), c[1] );
+				const __m128 row_e2 = _mm_add_ps( _mm_mul_ps( b[2], py ), c[2] );
+				const __m128 row_z = _mm_set1_ps( triangle.z[0] + dzdy * ( y + 0.5f - triangle.y[0] ) - dzdx * triangle.x[0] );
+				float * depth = &depth_[size_t( y ) * width_];
+
+				for ( int x = x0; x <= x1; x += 4 )
+				{
+					const __m128 px = _mm_add_ps( _mm_set1_ps( static_cast<float>( x ) ), pixel_offsets );
+					const __m128 inside = _mm_and_ps( _mm_and_ps(
+						_mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( a[0], px ), row_e0 ), zero ),
+						_mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( a[1], px ), row_e1 ), zero ) ),
+						_mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( a[2], px ), row_e2 ), zero ) );
+
+					if ( _mm_movemask_ps( inside ) == 0 )
+					{
+						continue;
+					}
+
+					const __m128 z = _mm_add_ps( _mm_mul_ps( z_dx, px ), row_z );
+					const __m128 old_depth = _mm_loadu_ps( depth + x );
+					const __m128 new_depth = _mm_max_ps( old_depth, z );
+					_mm_storeu_ps( depth + x, _mm_or_ps( _mm_and_ps( inside, new_depth ), _mm_andnot_ps( inside, old_depth ) ) );
+				}
+			}
+		}
+	}
+
+	// farthest occluder of each tile of the row
+	for ( int tile_x = 0; tile_x < no_tiles_x_; ++tile_x )
+	{
+		__m128 farthest = _mm_set1_ps( FLT_MAX );
+		for ( int y = row_y0; y <= row_y1; ++y )
+		{
+			const float * depth = &depth_[size_t( y ) * width_ + tile_x * kTileSize];
+			farthest = _mm_min_ps( farthest, _mm_min_ps( _mm_loadu_ps( depth ), _mm_loadu_ps( depth + 4 ) ) );
+		}
+
+		float values[4];
+		_mm_storeu_ps( values, farthest );
+		tile_depth_[size_t( row ) * no_tiles_x_ + tile_x] = std::min( std::min( values[0], values[1] ), std::min( values[2], values[3] ) );
+	}
+}
+
+bool OcclusionBuffer::IsBoxVisible( const Matrix4x4 & clip_from_object, const Vector3 & lower, const Vector3 & upper ) const
+{
+	// screen bounds of the corners and the depth of the nearest one, w is linear so no point of the box is nearer
+	float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+	float nearest = 0.0f;
+
+	for ( int i = 0; i < 8; ++i )
+	{
+		const Vector3 corner( ( i & 1 ) ? upper.x : lower.x, ( i & 2 ) ? upper.y : lower.y, ( i & 4 ) ? upper.z : lower.z );
+		float clip[4];
+		TransformToClip( clip_from_object, corner, clip );
+
+		if ( clip[2] < -clip[3] || clip[3] <= 0.0f )
+		{
+			return true; // the box crosses the near plane
+		}
+
+		const float rw = 1.0f / clip[3];
+		const float x = ( clip[0] * rw * 0.5f + 0.5f ) * width_;
+		const float y = ( clip[1] * rw * 0.5f + 0.5f ) * height_;
+		min_x = std::min( min_x, x );
+		max_x = std::max( max_x, x );
+		min_y = std::min( min_y, y );
+		max_y = std::max( max_y, y );
+		nearest = std::max( nearest, rw );
+	}
+
+	// all pixels touched by the projected bounds (clamped before the conversion, the corners may project far away)
+	const int x0 = static_cast<int>( floorf( std::max( min_x, 0.0f ) ) );
+	const int x1 = static_cast<int>( floorf( std::min( max_x, static_cast<float>( width_ - 1 ) ) ) );
+	const int y0 = static_cast<int>( floorf( std::max( min_y, 0.0f ) ) );
+	const int y1 = static_cast<int>( floorf( std::min( max_y, static_cast<float>( height_ - 1 ) ) ) );
+	if ( x0 > x1 || y0 > y1 )
+	{
+		return true; // off screen, left to the frustum culling
+	}
+
+	for ( int tile_y = y0 / kTileSize; tile_y <= y1 / kTileSize; ++tile_y )
+	{
+		for ( int tile_x = x0 / kTileSize; tile_x <= x1 / kTileSize; ++tile_x )
+		{
+			if ( tile_depth_[size_t( tile_y ) * no_tiles_x_ + tile_x] > nearest )
+			{
+				continue; // the farthest occluder of the tile is in front of the box
+			}
+
+			for ( int y = std::max( y0, tile_y * kTileSize ); y <= std::min( y1, tile_y * kTileSize + kTileSize - 1 ); ++y )
+			{
+				const float * depth = &depth_[size_t( y ) * width_];
+				for ( int x = std::max( x0, tile_x * kTileSize ); x <= std::min( x1, tile_x * kTileSize + kTileSize - 1 ); ++x )
+				{
+					if ( depth[x] <= nearest )
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+int OcclusionBuffer::width() const
+{
+	return width_;
+}
+
+int OcclusionBuffer::height() const
+{
+	return height_;
+}
+
+int OcclusionBuffer::no_tile_rows() const
+{
+	return height_ / kTileSize;
+}
+
+OcclusionCuller::OcclusionCuller( const int width, const int height ) : buffer_( width, height ),
+	thread_pool_( std::max( 1, int( std::thread::hardware_concurrency() ) - 1 ) ) // the render thread keeps submitting meanwhile
+{
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	Finish();
+}
+
+void OcclusionCuller::SetScene( std::vector<Surface *> & surfaces, const float max_relative_error )
+{
+	Finish();
+	proxies_.clear();
+	proxies_.resize( surfaces.size() );
+
+	for ( size_t i = 0; i < surfaces.size(); ++i )
+	{
+		Surface * surface = surfaces[i];
+		Vector3 center;
+		float radius = 0.0f;
+		BoundingSphere( surface, center, radius );
+
+		// the levels share the vertices of the surface and lie within its bounding box
+		const Triangle3ui * triangles = surface->get_indices();
+		int no_triangles = surface->no_triangles();
+		for ( int level = 0; level < surface->no_lods(); ++level )
+		{
+			const SurfaceLod & lod = surface->get_lod( level );
+			if ( lod.error <= max_relative_error * radius )
+			{
+				triangles = lod.indices.data();
+				no_triangles = static_cast<int>( lod.indices.size() );
+			}
+		}
+
+		if ( no_triangles > triangle_budget )
+		{
+			continue;
+		}
+
+		// only the referenced positions are kept
+		Proxy & proxy = proxies_[i];
+		std::vector<int> remap( surface->no_vertices(), -1 );
+		for ( int t = 0; t < no_triangles; ++t )
+		{
+			Triangle3ui triangle = triangles[t];
+			for ( int k = 0; k < 3; ++k )
+			{
+				unsigned int & v = ( &triangle.v0 )[k];
+				if ( remap[v] < 0 )
+				{
+					remap[v] = static_cast<int>( proxy.positions.size() );
+					proxy.positions.push_back( surface->get_vertices()[v].position );
+				}
+				v = remap[v];
+			}
+			proxy.triangles.push_back( triangle );
+		}
+	}
+}
+
+bool OcclusionCuller::ready() const
+{
+	return !proxies_.empty();
+}
+
+void OcclusionCuller::Start( const Matrix4x4 & clip_from_object, const std::vector<SurfaceDraw> & draws, const std::vector<int> & visible,
+	const std::vector<float> & sizes )
+{
+	assert( !running_ && visible.size() == sizes.size() );
+
+	// the largest surfaces occlude first
+	std::vector<int> order( visible.size() );
+	for ( size_t k = 0; k < order.size(); ++k )
+	{
+		order[k] = static_cast<int>( k );
+	}
+	std::sort( order.begin(), order.end(), [&sizes]( const int a, const int b ) { return sizes[a] > sizes[b]; } );
+
+	occluders_.clear();
+	occludees_.clear();
+	int no_proxy_triangles = 0;
+
+	for ( const int k : order )
+	{
+		const int surface = visible[k];
+		const int no_triangles = ( surface < static_cast<int>( proxies_.size() ) ) ? static_cast<int>( proxies_[surface].triangles.size() ) : 0;
+
+		if ( no_triangles > 0 && sizes[k] >= min_occluder_size && no_proxy_triangles + no_triangles <= triangle_budget )
+		{
+			occluders_.push_back( surface );
+			no_proxy_triangles += no_triangles;
+		}
+		else
+		{
+			occludees_.push_back( surface );
+		}
+	}
+
+	visible_.assign( occludees_.size(), 1 );
+	time_ms_ = 0.0;
+
+	if ( occluders_.empty() || occludees_.empty() )
+	{
+		return;
+	}
+
+	clip_from_object_ = clip_from_object;
+	draws_ = &draws;
+	running_ = true;
+	thread_pool_.Enqueue( [this]() { Cull(); } );
+}
+
+const std::vector<int> & OcclusionCuller::occluders() const
+{
+	return occluders_;
+}
+
+const std::vector<int> & OcclusionCuller::occludees() const
+{
+	return occludees_;
+}
+
+const std::vector<unsigned char> & OcclusionCuller::Finish()
+{
+	if ( running_ )
+	{
+		PROFILE_ZONE( "OcclusionCuller::Wait" );
+		thread_pool_.Wait();
+		running_ = false;
+	}
+
+	return visible_;
+}
+
+double OcclusionCuller::time_ms() const
+{
+	return time_ms_;
+}
+
+void OcclusionCuller::Cull()
+{
+	PROFILE_ZONE( "OcclusionCuller::Cull" );
+
+	const auto t0 = std::chrono::high_resolution_clock::now();
+
+	screen_triangles_.resize( occluders_.size() );
+	thread_pool_.ParallelFor( static_cast<int>( occluders_.size() ), [this]( const int i )
+	{
+		const Proxy & proxy = proxies_[occluders_[i]];
+		screen_triangles_[i].clear();
+		buffer_.ProjectTriangles( clip_from_object_, proxy.positions.data(), proxy.triangles.data(),
+			static_cast<int>( proxy.triangles.size() ), screen_triangles_[i] );
+	} );
+
+	thread_pool_.ParallelFor( buffer_.no_tile_rows(), [this]( const int row )
+	{
+		buffer_.RasterizeTileRow( row, screen_triangles_ );
+	} );
+
+	// boxes are tested in chunks, a single test is too short to be worth a task
+	const int chunk_size = 32;
+	thread_pool_.ParallelFor( static_cast<int>( ( occludees_.size() + chunk_size - 1 ) / chunk_size ), [this, chunk_size]( const int chunk )
+	{
+		const size_t end = std::min( occludees_.size(), size_t( chunk + 1 ) * chunk_size );
+		for ( size_t k = size_t( chunk ) * chunk_size; k < end; ++k )
+		{
+			const SurfaceDraw & draw = ( *draws_ )[occludees_[k]];
+			visible_[k] = buffer_.IsBoxVisible( clip_from_object_, draw.lower, draw.upper ) ? 1 : 0;
+		}
+	} );
+
+	time_ms_ = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - t0 ).count();
+}
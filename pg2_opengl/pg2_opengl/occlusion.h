@@ -0,0 +1,125 @@
+#ifndef OCCLUSION_H_
+#define OCCLUSION_H_
+
+#include "surface.h"
+#include "matrix4x4.h"
+#include "sceneloader.h"
+#include "threadpool.h"
+
+/*! \class OcclusionBuffer
+\brief Low resolution depth buffer filled by a software rasterizer and tested by bounding boxes.
+
+The buffer stores 1/w of the nearest occluder of each pixel (0 where nothing was drawn), 1/w is linear in screen space,
+so it is interpolated directly by the edge function rasterizer which evaluates four pixels at once with SSE2.
+Pixels are grouped into tiles of 8x8 pixels keeping the depth of their farthest pixel, a box behind the tile depth is
+hidden in the whole tile without looking at its pixels. Rows of tiles are independent, so they are filled in parallel.
+*/
+class OcclusionBuffer
+{
+public:
+	static const int kTileSize = 8;
+
+	/*! \struct ScreenTriangle
+	\brief Triangle projected onto the buffer, x and y in pixels and z = 1/w.
+	*/
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+	};
+
+	/* width and height are rounded up to multiples of the tile size */
+	OcclusionBuffer( const int width = 256, const int height = 128 );
+
+	/* projects the triangles by the clip space transformation, triangles crossing the near plane are dropped (the result stays conservative) */
+	void ProjectTriangles( const Matrix4x4 & clip_from_object, const Vector3 * positions, const Triangle3ui * triangles, const int no_triangles,
+		std::vector<ScreenTriangle> & screen_triangles ) const;
+
+	/* clears the row of tiles and draws the parts of the triangles overlapping it, rows may be drawn concurrently */
+	void RasterizeTileRow( const int row, const std::vector<std::vector<ScreenTriangle>> & screen_triangles );
+
+	/* false if the box is behind the occluders in all pixels it covers, safe to call concurrently once the rows are drawn */
+	bool IsBoxVisible( const Matrix4x4 & clip_from_object, const Vector3 & lower, const Vector3 & upper ) const;
+
+	int width() const;
+	int height() const;
+	int no_tile_rows() const;
+
+private:
+	int width_{ 0 };
+	int height_{ 0 };
+	int no_tiles_x_{ 0 };
+	std::vector<float> depth_; // 1/w of the nearest occluder, row by row
+	std::vector<float> tile_depth_; // minimum of depth_ over the pixels of each tile, i.e. the farthest occluder
+};
+
+/*! \class OcclusionCuller
+\brief Masked software occlusion culling of the surfaces of the scene running on its own worker threads.
+
+The largest visible surfaces (by the projected size of their bounding spheres) are chosen as occluders within a triangle
+budget, Start returns right after the choice so that the renderer submits the occluders while their low-poly proxies
+are drawn into the OcclusionBuffer and the boxes of the remaining surfaces are tested on the workers. Finish then
+tells which of the remaining surfaces have to be drawn.
+*/
+class OcclusionCuller
+{
+public:
+	OcclusionCuller( const int width = 256, const int height = 128 );
+	~OcclusionCuller();
+
+	/* builds the proxy of each surface from its coarsest level of detail deviating at most by max_relative_error of its size,
+	surfaces whose proxies exceed the triangle budget never occlude */
+	void SetScene( std::vector<Surface *> & surfaces, const float max_relative_error = 0.01f );
+
+	/* proxies exist */
+	bool ready() const;
+
+	/* splits the visible surfaces into occluders and occludees and starts the culling on the workers,
+	sizes are ratios of the radii of the bounding spheres to their distances from the camera, draws must not change until Finish */
+	void Start( const Matrix4x4 & clip_from_object, const std::vector<SurfaceDraw> & draws, const std::vector<int> & visible,
+		const std::vector<float> & sizes );
+
+	/* surfaces chosen by Start as occluders, they are always drawn */
+	const std::vector<int> & occluders() const;
+
+	/* surfaces tested by the culling */
+	const std::vector<int> & occludees() const;
+
+	/* waits for the workers, the k-th item is nonzero if occludees()[k] may be visible */
+	const std::vector<unsigned char> & Finish();
+
+	/* time spent by the workers on the last culling */
+	double time_ms() const;
+
+	int triangle_budget{ 1 << 14 }; /*!< Maximal number of proxy triangles drawn per frame. */
+	float min_occluder_size{ 0.05f }; /*!< Surfaces whose bounding spheres appear smaller (radius / distance) do not occlude. */
+
+private:
+	/* body of the culling, runs on a worker */
+	void Cull();
+
+	struct Proxy
+	{
+		std::vector<Vector3> positions;
+		std::vector<Triangle3ui> triangles;
+	};
+
+	OcclusionBuffer buffer_;
+	std::vector<Proxy> proxies_; // one per surface, empty for surfaces which never occlude
+	ThreadPool thread_pool_; // used only by the culling, so that Finish waits just for it
+
+	Matrix4x4 clip_from_object_;
+	const std::vector<SurfaceDraw> * draws_{ nullptr };
+	std::vector<int> occluders_;
+	std::vector<int> occludees_;
+	std::vector<unsigned char> visible_;
+	std::vector<std::vector<OcclusionBuffer::ScreenTriangle>> screen_triangles_; // of each occluder
+	bool running_{ false };
+	double time_ms_{ 0.0 };
+
+	OcclusionCuller( const OcclusionCuller & ) = delete;
+	OcclusionCuller & operator=( const OcclusionCuller & ) = delete;
+};
+
+#endif
@@ -15,6 +15,8 @@
 #include <math.h>
 #include <assert.h>
 #include <functional>
+#include <algorithm>
+#include <chrono>
 
 #include <optix.h>
 #include <optix_world.h>
@@ -1,9 +1,66 @@
 #include "pch.h"
 #include "tutorials.h"
+#include "benchmarks.h"
 
-int main()
+int main( int argc, char * argv[] )
 {
 	printf( "PG2 OpenGL, (c)2019 Tomas Fabian\n\n" );
 
+	if ( ( argc > 2 ) && ( strcmp( argv[1], "--bench-loader" ) == 0 ) )
+	{
+		return BenchmarkOBJLoading( argv[2] );
+	}
+
+	if ( ( argc > 1 ) && ( strcmp( argv[1], "--bench-scanner" ) == 0 ) )
+	{
+		return ( argc > 2 ) ? BenchmarkScanner( atoi( argv[2] ) ) : BenchmarkScanner();
+	}
+
+	if ( ( argc > 1 ) && ( strcmp( argv[1], "--bench-materials" ) == 0 ) )
+	{
+		return ( argc > 3 ) ? BenchmarkMaterialLookup( atoi( argv[2] ), atoi( argv[3] ) ) : BenchmarkMaterialLookup();
+	}
+
+	if ( ( argc > 1 ) && ( strcmp( argv[1], "--bench-normals" ) == 0 ) )
+	{
+		return ( argc > 2 ) ? BenchmarkNormalGeneration( atoi( argv[2] ) ) : BenchmarkNormalGeneration();
+	}
+
+	if ( ( argc > 2 ) && ( strcmp( argv[1], "--bench-lods" ) == 0 ) )
+	{
+		return BenchmarkLodSelection( argv[2] );
+	}
+
+	if ( ( argc > 2 ) && ( strcmp( argv[1], "--bench-cones" ) == 0 ) )
+	{
+		return ( argc > 3 ) ? BenchmarkConeCulling( argv[2], atoi( argv[3] ) ) : BenchmarkConeCulling( argv[2] );
+	}
+
+	if ( ( argc > 1 ) && ( strcmp( argv[1], "--bench-occlusion" ) == 0 ) )
+	{
+		return ( argc > 2 ) ? BenchmarkOcclusionCulling( atoi( argv[2] ) ) : BenchmarkOcclusionCulling();
+	}
+
+	if ( ( argc > 2 ) && ( strcmp( argv[1], "--headless" ) == 0 ) )
+	{
+		return ( argc > 3 ) ? BenchmarkHeadlessRendering( argv[2], atoi( argv[3] ) ) : BenchmarkHeadlessRendering( argv[2] );
+	}
+
+	// --bench-path <obj> [frames] [path file or -] [json file or -] [--headless]
+	if ( ( argc > 2 ) && ( strcmp( argv[1], "--bench-path" ) == 0 ) )
+	{
+		std::vector<const char *> args;
+		bool headless = false;
+		for ( int i = 2; i < argc; ++i )
+		{
+			if ( strcmp( argv[i], "--headless" ) == 0 ) headless = true;
+			else args.push_back( argv[i] );
+		}
+		args.resize( 4, "-" );
+		auto optional = []( const char * arg ) { return ( strcmp( arg, "-" ) == 0 ) ? nullptr : arg; };
+
+		return BenchmarkCameraPath( args[0], optional( args[1] ) ? atoi( args[1] ) : 1000, optional( args[2] ), optional( args[3] ), headless );
+	}
+
 	return tutorial_1();
 }
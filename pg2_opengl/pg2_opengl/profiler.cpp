@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "profiler.h"
+
+#include <mutex>
+#include <memory>
+
+namespace Profiler
+{
+	struct Event
+	{
+		const char * name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	/* written only by its thread, the events below head are complete */
+	struct ThreadBuffer
+	{
+		int id{ 0 };
+		std::string name;
+		std::atomic<uint64_t> head{ 0 }; // number of events recorded so far
+		std::vector<Event> events; // ring of kEventsPerThread events
+	};
+
+	static const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+	static std::atomic<bool> is_enabled{ true };
+
+	static std::mutex buffers_mutex; // guards the list of the buffers and the names of the threads
+	static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+	/* buffer of the calling thread, registered on the first use */
+	static ThreadBuffer & thread_buffer()
+	{
+		thread_local ThreadBuffer * buffer = nullptr;
+
+		if ( !buffer )
+		{
+			std::unique_ptr<ThreadBuffer> new_buffer( new ThreadBuffer() );
+			new_buffer->events.resize( kEventsPerThread );
+
+			std::unique_lock<std::mutex> lock( buffers_mutex );
+			new_buffer->id = static_cast<int>( buffers.size() ) + 1;
+			new_buffer->name = "thread " + std::to_string( new_buffer->id );
+			buffer = new_buffer.get();
+			buffers.push_back( std::move( new_buffer ) );
+		}
+
+		return *buffer;
+	}
+
+	uint64_t Now()
+	{
+		// never 0, which marks zones started while the profiler was disabled
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - start_time ).count() + 1;
+	}
+
+	void Record( const char * name, const uint64_t start, const uint64_t end )
+	{
+		ThreadBuffer & buffer = thread_buffer();
+		const uint64_t head = buffer.head.load( std::memory_order_relaxed );
+
+		buffer.events[head % kEventsPerThread] = Event{ name, start, end };
+		buffer.head.store( head + 1, std::memory_order_release );
+	}
+
+	void SetThreadName( const char * name )
+	{
+		ThreadBuffer & buffer = thread_buffer();
+
+		std::unique_lock<std::mutex> lock( buffers_mutex );
+		buffer.name = name;
+	}
+
+	void SetEnabled( const bool enabled )
+	{
+		is_enabled.store( enabled, std::memory_order_relaxed );
+	}
+
+	bool enabled()
+	{
+		return is_enabled.load( std::memory_order_relaxed );
+	}
+
+	/* escapes the characters which cannot appear in JSON strings as they are */
+	static void WriteJsonString( FILE * file, const char * text )
+	{
+		fputc( '"', file );
+		for ( const char * c = text; *c; ++c )
+		{
+			if ( *c == '"' || *c == '\\' ) fputc( '\\', file );
+			if ( static_cast<unsigned char>( *c ) >= ' ' ) fputc( *c, file );
+		}
+		fputc( '"', file );
+	}
+
+	bool DumpChromeTrace( const char * file_name )
+	{
+		FILE * file = fopen( file_name, "wt" );
+
+		if ( !file )
+		{
+			printf( "IO error: File '%s' cannot be written.\n", file_name );
+
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock( buffers_mutex );
+		size_t no_events = 0;
+
+		fprintf( file, "{\"traceEvents\":[\n" );
+		for ( size_t i = 0; i < buffers.size(); ++i )
+		{
+			const ThreadBuffer & buffer = *buffers[i];
+
+			fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", ( i == 0 ) ? "" : ",\n", buffer.id );
+			WriteJsonString( file, buffer.name.c_str() );
+			fprintf( file, "}}" );
+
+			// the events are copied first, the ones the thread may have overwritten meanwhile are dropped afterwards
+			// including the slot written next, Record fills it before publishing the new head
+			const uint64_t head = buffer.head.load( std::memory_order_acquire );
+			const uint64_t first = head - std::min( head, uint64_t( kEventsPerThread ) );
+			std::vector<Event> events;
+			events.reserve( static_cast<size_t>( head - first ) );
+			for ( uint64_t e = first; e < head; ++e )
+			{
+				events.push_back( buffer.events[e % kEventsPerThread] );
+			}
+			std::atomic_thread_fence( std::memory_order_acquire );
+			const uint64_t new_head = buffer.head.load( std::memory_order_relaxed );
+			const uint64_t first_valid = new_head + 1 - std::min( new_head + 1, uint64_t( kEventsPerThread ) );
+
+			for ( uint64_t e = std::max( first, first_valid ); e < head; ++e )
+			{
+				const Event & event = events[static_cast<size_t>( e - first )];
+
+				fprintf( file, ",\n{\"name\":" );
+				WriteJsonString( file, event.name );
+				fprintf( file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%0.3f,\"dur\":%0.3f}", buffer.id, event.start * 1e-3,
+					( event.end - event.start ) * 1e-3 );
+				++no_events;
+			}
+		}
+		fprintf( file, "\n]}\n" );
+		fclose( file );
+
+		printf( "Profiler: %I64u zones of %I64u threads written to '%s'\n", no_events, buffers.size(), file_name );
+
+		return true;
+	}
+}
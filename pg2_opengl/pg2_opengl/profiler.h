@@ -0,0 +1,68 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+
+/*
+Scoped CPU profiling zones exported in the Trace Event Format of chrome://tracing (and Perfetto).
+
+PROFILE_ZONE( "name" ) measures the rest of the enclosing scope. Every thread records its zones into its own ring buffer
+of kEventsPerThread events, so recording takes no lock and the oldest events are overwritten. The buffers are registered
+once per thread and outlive their threads, so DumpChromeTrace can collect the zones of finished threads too. The name of
+a zone is stored as a pointer and must be a string literal (or otherwise outlive the dump).
+Defining DISABLE_PROFILING removes the zones at compile time.
+*/
+
+namespace Profiler
+{
+	static const int kEventsPerThread = 1 << 15;
+
+	/* nanoseconds since the start of the profiler */
+	uint64_t Now();
+
+	/* records the zone into the buffer of the calling thread */
+	void Record( const char * name, const uint64_t start, const uint64_t end );
+
+	/* name of the calling thread shown in the trace, the string is copied */
+	void SetThreadName( const char * name );
+
+	/* zones are not recorded while disabled, recording is enabled by default */
+	void SetEnabled( const bool enabled );
+	bool enabled();
+
+	/* writes the zones of all threads as a JSON trace, zones being recorded during the dump may be missing */
+	bool DumpChromeTrace( const char * file_name );
+}
+
+/*! \class ProfileZone
+\brief Records the time between its construction and destruction as a zone of the calling thread.
+*/
+class ProfileZone
+{
+public:
+	explicit ProfileZone( const char * name ) : name_( name ), start_( Profiler::enabled() ? Profiler::Now() : 0 ) { }
+
+	~ProfileZone()
+	{
+		if ( start_ != 0 ) Profiler::Record( name_, start_, Profiler::Now() );
+	}
+
+private:
+	const char * name_;
+	uint64_t start_; // 0 if the profiler was disabled
+
+	ProfileZone( const ProfileZone & ) = delete;
+	ProfileZone & operator=( const ProfileZone & ) = delete;
+};
+
+#define PROFILE_CONCAT_( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_( a, b )
+
+#ifdef DISABLE_PROFILING
+#define PROFILE_ZONE( name )
+#else
+#define PROFILE_ZONE( name ) ProfileZone PROFILE_CONCAT( profile_zone_, __LINE__ )( name )
+#endif
+
+#endif
@@ -1,7 +1,13 @@
 #include "pch.h"
 #include "rasterizer.h"
-
-void CreateBindlessTexture(GLuint & texture, GLuint64 & handle, const int width, const int height, unsigned char * data)
+#include "mappedfile.h"
+#include "profiler.h"
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+
+void CreateBindlessTexture(GLuint & texture, GLuint64 & handle, const int width, const int height, unsigned char * data,
+	const GLenum internal_format = GL_RGB, const GLenum format = GL_BGR, const GLenum type = GL_UNSIGNED_BYTE)
 {
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture); // bind empty texture object to the target
@@ -11,13 +17,26 @@ void CreateBindlessTexture(GLuint & texture, GLuint64 & handle, const int width,
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	// copy data from the host buffer
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, data);
 	glGenerateMipmap(GL_TEXTURE_2D);
 	//glBindTexture(GL_TEXTURE_2D, 0); // unbind the newly created texture from the target
+	if (!GLAD_GL_ARB_bindless_texture)
+	{
+		handle = 0; // the texture is bound to a unit for each draw instead
+		return;
+	}
 	handle = glGetTextureHandleARB(texture); // produces a handle representing the texture in a shader function
 	glMakeTextureHandleResidentARB(handle);
 }
 
+/* transforms the point by the affine matrix */
+static Vector3 TransformPoint(const Matrix4x4 & m, const Vector3 & p)
+{
+	return Vector3(m.get(0, 0) * p.x + m.get(0, 1) * p.y + m.get(0, 2) * p.z + m.get(0, 3),
+		m.get(1, 0) * p.x + m.get(1, 1) * p.y + m.get(1, 2) * p.z + m.get(1, 3),
+		m.get(2, 0) * p.x + m.get(2, 1) * p.y + m.get(2, 2) * p.z + m.get(2, 3));
+}
+
 Rasterizer::Rasterizer(const int width, const int height, const float fov_y, const Vector3 view_from, const Vector3 view_at,float near_plane,float far_plane)
 {
 	camera = Camera(width, height, fov_y, view_from, view_at,near_plane,far_plane);
@@ -44,6 +63,202 @@ bool Rasterizer::check_gl(const GLenum error)
 	return true;
 }
 
+const CullingStatistics & Rasterizer::culling_statistics() const
+{
+	return culling_statistics_;
+}
+
+void Rasterizer::SetCameraPath(const CameraPath & path, const int no_frames)
+{
+	camera_path_ = path;
+	no_timed_frames_ = no_frames;
+	vsync_ = false;
+}
+
+const std::vector<FrameTime> & Rasterizer::frame_times() const
+{
+	return frame_times_;
+}
+
+const GpuTimer & Rasterizer::gpu_timer() const
+{
+	return gpu_timer_;
+}
+
+void Rasterizer::UpdateOverlay()
+{
+	// the title is rewritten twice a second so that the numbers stay readable
+	const auto now = std::chrono::high_resolution_clock::now();
+	if (std::chrono::duration<double>(now - overlay_time_).count() < 0.5)
+	{
+		return;
+	}
+	overlay_time_ = now;
+
+	char text[64];
+	snprintf(text, sizeof(text), "PG2 OpenGL | GPU %0.2f ms (", gpu_timer_.frame().average_ms);
+	std::string title = text;
+	for (const GpuTimer::Pass & pass : gpu_timer_.passes())
+	{
+		snprintf(text, sizeof(text), "%s%s %0.2f", (&pass == &gpu_timer_.passes().front()) ? "" : ", ", pass.name.c_str(), pass.average_ms);
+		title += text;
+	}
+	glfwSetWindowTitle(window, (title + ")").c_str());
+}
+
+void Rasterizer::ToggleUi()
+{
+	show_ui_ = !show_ui_;
+}
+
+int Rasterizer::Ui()
+{
+	// the graphs keep running while the overlay is hidden
+	if (cpu_frame_history_.empty())
+	{
+		cpu_frame_history_.resize(kNoUiFrames, 0.0f);
+		gpu_frame_history_.resize(kNoUiFrames, 0.0f);
+	}
+	cpu_frame_history_[ui_frame_] = cpu_frame_ms_;
+	gpu_frame_history_[ui_frame_] = static_cast<float>(gpu_timer_.frame().last_ms);
+	ui_frame_ = (ui_frame_ + 1) % kNoUiFrames;
+
+	if (!show_ui_)
+	{
+		return S_OK;
+	}
+
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+
+	ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.8f);
+	ImGui::Begin("Performance (F1)", &show_ui_, ImGuiWindowFlags_AlwaysAutoResize);
+
+	char overlay[64];
+	snprintf(overlay, sizeof(overlay), "CPU %0.2f ms", cpu_frame_ms_);
+	ImGui::PlotLines("##cpu", cpu_frame_history_.data(), kNoUiFrames, ui_frame_, overlay, 0.0f, FLT_MAX, ImVec2(320, 48));
+	snprintf(overlay, sizeof(overlay), "GPU %0.2f ms", gpu_timer_.frame().average_ms);
+	ImGui::PlotLines("##gpu", gpu_frame_history_.data(), kNoUiFrames, ui_frame_, overlay, 0.0f, FLT_MAX, ImVec2(320, 48));
+	ImGui::Text("%0.1f FPS", ImGui::GetIO().Framerate);
+
+	if (ImGui::CollapsingHeader("GPU passes", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		for (const GpuTimer::Pass & pass : gpu_timer_.passes())
+		{
+			ImGui::Text("%-10s %7.3f ms", pass.name.c_str(), pass.average_ms);
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Draws", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		const CullingStatistics & s = culling_statistics_;
+		ImGui::Text("draw calls      %d", s.draw_calls);
+		ImGui::Text("triangles       %I64u of %d", s.visible_triangles, no_triangles);
+		ImGui::Text("surfaces        %d drawn, %d outside, %d occluded", s.visible_surfaces, s.culled_surfaces, s.occluded_surfaces);
+		ImGui::Text("meshlets        %d drawn, %d back-facing (%I64u triangles)", s.visible_meshlets, s.culled_meshlets, s.culled_triangles);
+		ImGui::Text("occlusion       %d occluders, %0.3f ms on the workers", s.occluders, s.occlusion_ms);
+	}
+
+	if (ImGui::CollapsingHeader("GPU memory"))
+	{
+		const GpuMemory & m = gpu_memory_;
+		const float MB = 1.0f / sqr(1024.0f);
+		ImGui::Text("vertex buffer   %8.1f MB", m.vertex_buffer * MB);
+		ImGui::Text("index buffer    %8.1f MB", m.index_buffer * MB);
+		ImGui::Text("textures        %8.1f MB", m.textures * MB);
+		ImGui::Text("materials       %8.1f MB", m.materials * MB);
+		ImGui::Text("staging buffer  %8.1f MB", m.staging * MB);
+		ImGui::Text("framebuffer     %8.1f MB", m.framebuffer * MB);
+		ImGui::Text("total           %8.1f MB", (m.vertex_buffer + m.index_buffer + m.textures + m.materials + m.staging + m.framebuffer) * MB);
+	}
+
+	if (ImGui::CollapsingHeader("Loading"))
+	{
+		ImGui::Text("LoadOBJ         %s", scene_loader_.scene_loaded() ? TimeToString(scene_loader_.load_time()).c_str() : "...");
+		ImGui::Text("batches         %s", scene_complete_ ? TimeToString(scene_loader_.batch_time()).c_str() : "...");
+		ImGui::Text("first frame     %s", TimeToString(time_to_first_frame_).c_str());
+		ImGui::Text("full scene      %s", scene_complete_ ? TimeToString(time_to_full_scene_).c_str() : "...");
+	}
+
+	if (ImGui::CollapsingHeader("Settings", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Checkbox("frustum culling", &frustum_culling_);
+		ImGui::Checkbox("cone culling", &cone_culling_);
+		ImGui::Checkbox("occlusion culling", &occlusion_culling_);
+		ImGui::SliderInt("occluder triangles", &occlusion_culler_.triangle_budget, 0, 1 << 16);
+		ImGui::SliderFloat("min occluder size", &occlusion_culler_.min_occluder_size, 0.0f, 0.5f);
+		ImGui::SliderFloat("LOD error (px)", &lod_pixel_error_, 0.0f, 16.0f, "%.2f", 2.0f);
+		float upload_budget_ms = static_cast<float>(upload_budget_ms_);
+		if (ImGui::SliderFloat("upload budget (ms)", &upload_budget_ms, 0.1f, 16.0f))
+		{
+			upload_budget_ms_ = upload_budget_ms;
+		}
+		if (ImGui::Checkbox("vsync", &vsync_))
+		{
+			glfwSwapInterval(vsync_ ? 1 : 0);
+		}
+		ImGui::Checkbox("GPU times in the title", &gpu_overlay_);
+		bool profiling = Profiler::enabled();
+		if (ImGui::Checkbox("CPU profiling zones", &profiling))
+		{
+			Profiler::SetEnabled(profiling);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Save trace (F2)"))
+		{
+			Profiler::DumpChromeTrace("trace.json");
+		}
+	}
+
+	ImGui::End();
+	ImGui::Render();
+
+	// ImGui colors are already in sRGB
+	glDisable(GL_FRAMEBUFFER_SRGB);
+	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	glEnable(GL_FRAMEBUFFER_SRGB);
+
+	return S_OK;
+}
+
+/* creates immutable storage for the whole mip chain, the levels are filled by the upload queue */
+GLuint CreateStreamedTexture(Texture * texture, const GLenum internal_format)
+{
+	GLuint id = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &id);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureStorage2D(id, UploadQueue::no_levels(texture->width(), texture->height()), internal_format, texture->width(), texture->height());
+
+	return id;
+}
+
+/* bytes of all levels of the texture stored with the given texel size */
+static size_t MipChainSize(const Texture * texture, const int texel_size)
+{
+	size_t size = 0;
+	for (int level = 0, width = texture->width(), height = texture->height(); level < UploadQueue::no_levels(texture->width(), texture->height()); ++level)
+	{
+		size += size_t(width) * height * texel_size;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return size;
+}
+
+GLuint64 MakeTextureResident(const GLuint texture)
+{
+	const GLuint64 handle = glGetTextureHandleARB(texture);
+	glMakeTextureHandleResidentARB(handle);
+
+	return handle;
+}
+
 /* glfw callback */
 void glfw_callback(const int error, const char * description)
 {
@@ -78,49 +293,42 @@ void Rasterizer::Resize(int width, int height)
 	InitFrameBuffers();
 }
 
-/* load shader code from text file */
-char * LoadShader(const char * file_name)
+/* pass shader code from text file to the shader object, the code is read straight from the mapped file */
+bool LoadShader(const GLuint shader, const char * file_name, const std::string & preamble = "")
 {
-	FILE * file = fopen(file_name, "rt");
+	MappedFile file(file_name);
 
-	if (file == NULL)
+	if (!file.is_open())
 	{
 		printf("IO error: File '%s' not found.\n", file_name);
 
-		return NULL;
+		return false;
 	}
 
-	size_t file_size = static_cast<size_t>(GetFileSize64(file_name));
-	char * shader = NULL;
-
-	if (file_size < 1)
+	if (file.size() < 1)
 	{
 		printf("Shader error: File '%s' is empty.\n", file_name);
+
+		return false;
+	}
+
+	// the source is not null terminated so its length has to be given explicitly, glShaderSource makes its own copy
+	const GLchar * source = file.data();
+	const GLint length = static_cast<GLint>(file.size());
+	if (preamble.empty())
+	{
+		glShaderSource(shader, 1, &source, &length);
 	}
 	else
 	{
-		/* v glShaderSource nezadvme v poslednm parametru dlku,
-		take etzec mus bt null terminated, proto +1 a reset na 0*/
-		shader = new char[file_size + 1];
-		memset(shader, 0, sizeof(*shader) * (file_size + 1));
-
-		size_t bytes = 0; // poet ji natench byt
-
-		do
-		{
-			bytes += fread(shader, sizeof(char), file_size, file);
-		} while (!feof(file) && (bytes < file_size));
-
-		if (!feof(file) && (bytes != file_size))
-		{
-			printf("IO error: Unexpected end of file '%s' encountered.\n", file_name);
-		}
+		// the preamble replaces the first line with the #version directive
+		const GLchar * body = std::find(file.data(), file.end(), '\n');
+		const GLchar * sources[] = { preamble.c_str(), body };
+		const GLint lengths[] = { static_cast<GLint>(preamble.size()), static_cast<GLint>(file.end() - body) };
+		glShaderSource(shader, 2, sources, lengths);
 	}
 
-	fclose(file);
-	file = NULL;
-
-	return shader;
+	return true;
 }
 
 /* check shader for completeness */
@@ -149,11 +357,21 @@ GLint CheckShader(const GLenum shader)
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	// replaces the callback installed by ImGui, so the keys are passed on
+	if (ImGui::GetCurrentContext())
+		ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
+
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+		((Rasterizer *)glfwGetWindowUserPointer(window))->ToggleUi();
+
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+		Profiler::DumpChromeTrace("trace.json");
 }
 
-int Rasterizer::InitDeviceAndScene(const char* filename)
+int Rasterizer::InitWindow()
 {
 	glfwSetErrorCallback(glfw_callback);
 
@@ -169,6 +387,11 @@ int Rasterizer::InitDeviceAndScene(const char* filename)
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 	glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
 	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+	if (headless_)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_SAMPLES, 0); // the default framebuffer is never shown
+	}
 
 	window = glfwCreateWindow(camera.width_, camera.height_, "PG2 OpenGL", nullptr, nullptr);
 	if (!window)
@@ -186,15 +409,63 @@ int Rasterizer::InitDeviceAndScene(const char* filename)
 
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
-		if (!gladLoadGL())
+		if (headless_ || !gladLoadGL())
+		{
+			glfwTerminate();
+			window = nullptr;
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int Rasterizer::InitDeviceAndScene(const char* filename, const int no_headless_frames)
+{
+	Profiler::SetThreadName("render");
+	PROFILE_ZONE("InitDeviceAndScene");
+
+	init_time_ = std::chrono::high_resolution_clock::now();
+	headless_ = no_headless_frames > 0;
+	if (headless_)
+	{
+		no_timed_frames_ = no_headless_frames;
+	}
+
+	// the headless mode needs no display, a hidden window is only the fallback for drivers without EGL and OSMesa
+	if (headless_ && headless_context_.Create(4, 6, camera.width_, camera.height_))
+	{
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
 		{
+			headless_context_.Release();
 			return EXIT_FAILURE;
 		}
+		printf("Headless context created by %s.\n", headless_context_.api());
+	}
+	else if (InitWindow() != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	bindless_ = GLAD_GL_ARB_bindless_texture != 0;
+	if (!bindless_)
+	{
+		printf("GL_ARB_bindless_texture is not supported, the textures are bound for each surface.\n");
 	}
 
 	glEnable(GL_DEBUG_OUTPUT);
 	glDebugMessageCallback(gl_callback, nullptr);
 
+	if (!headless_)
+	{
+		ImGui::CreateContext();
+		ImGui::StyleColorsDark();
+		ImGui_ImplGlfw_InitForOpenGL(window, true);
+		ImGui_ImplOpenGL3_Init("#version 460 core");
+		glfwSetKeyCallback(window, key_callback);
+		ui_initialized_ = true;
+	}
+
 	printf("OpenGL %s, ", glGetString(GL_VERSION));
 	printf("%s", glGetString(GL_RENDERER));
 	printf(" (%s)\n", glGetString(GL_VENDOR));
@@ -209,59 +480,22 @@ int Rasterizer::InitDeviceAndScene(const char* filename)
 	// GL_LOWER_LEFT (OpenGL) or GL_UPPER_LEFT (DirectX, Windows) and GL_NEGATIVE_ONE_TO_ONE or GL_ZERO_TO_ONE
 	//glClipControl( GL_UPPER_LEFT, GL_NEGATIVE_ONE_TO_ONE );
 
-	const int no_surfaces = LoadOBJ(filename, surfaces_, materials_);
-	this->no_triangles = 0;
-
-	for (auto surface : surfaces_)
-	{
-		this->no_triangles += surface->no_triangles();
-	}
-
 	/*raytracer->InitDeviceAndScene();
 	raytracer->LoadScene(no_surfaces, surfaces_, materials_);
 	raytracer->initGraph();*/
 
-
-	//GLfloat* vertices = new GLfloat[no_triangles *3*11];
-	std::vector<MyVertex> vertices;
-	std::vector<int> indices;
-	// surfaces loop
-	int k = 0, l = 0;
-	for (auto surface : surfaces_)
-	{
-
-		// triangles loop
-		for (int i = 0; i < surface->no_triangles(); ++i, ++l)
-		{
-			Triangle & triangle = surface->get_triangle(i);
-
-			//// vertices loop
-			for (int j = 0; j < 3; ++j, ++k)
-			{
-				const Vertex & vertex = triangle.vertex(j);
-				Material *m = surface->get_material();
-				int m_index = m->material_index;
-
-				vertices.push_back(MyVertex(vertex, m_index,m->ambient_,m->specular_));
-
-			}
-
-		} // end of triangles loop
-
-	} // end of surfaces loop
+	// the shaders need nothing newer than GLSL 4.50, which is the version of Mesa's llvmpipe
+	const std::string preamble = std::string(GLAD_GL_VERSION_4_6 ? "#version 460 core" : "#version 450 core") +
+		(bindless_ ? "\n#define BINDLESS 1" : "\n#define BINDLESS 0");
 
 	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	const char * vertex_shader_source = LoadShader("basic_shader.vert");
-	glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
+	LoadShader(vertex_shader, "basic_shader.vert", preamble);
 	glCompileShader(vertex_shader);
-	SAFE_DELETE_ARRAY(vertex_shader_source);
 	CheckShader(vertex_shader);
 
 	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	const char * fragment_shader_source = LoadShader("basic_shader.frag");
-	glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
+	LoadShader(fragment_shader, "basic_shader.frag", preamble);
 	glCompileShader(fragment_shader);
-	SAFE_DELETE_ARRAY(fragment_shader_source);
 	CheckShader(fragment_shader);
 
 	shader_program = glCreateProgram();
@@ -270,99 +504,226 @@ int Rasterizer::InitDeviceAndScene(const char* filename)
 	glLinkProgram(shader_program);
 	// TODO check linking
 
-	const int no_vertices = no_triangles * 3; //count of points
-	const int size = (vertices.size() * sizeof(MyVertex)); // count of elements in vector * size of one element = size of whole array
-	const int vertex_stride = sizeof(MyVertex); // size of one MyVertex
-	// optional index array
+	const int vertex_stride = sizeof(GLVertex); // size of one GLVertex
 	vao = 0;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
+	// the buffers stay empty until the loading thread hands over the scene, see UpdateScene
 	vbo = 0;
 	glGenBuffers(1, &vbo); // generate vertex buffer object (one of OpenGL objects) and get the unique ID corresponding to that buffer
 	glBindBuffer(GL_ARRAY_BUFFER, vbo); // bind the newly created buffer to the GL_ARRAY_BUFFER target
-	glBufferData(GL_ARRAY_BUFFER, (vertices.size() * sizeof(MyVertex)), vertices.data(), GL_STATIC_DRAW); // copies the previously defined vertex data into the buffer's memory
 
-	// vertex position
-	//GLuint posAttrib = glGetAttribLocation(shader_program, "in_position");
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)0);
-	glEnableVertexAttribArray(0);
+	// position, octahedral normal, color, half float texture coordinates and material index
+	SetVertexFormat(gl_vertex_format, NO_GL_VERTEX_ATTRIBUTES, vertex_stride);
 
-	// normal
-	//GLuint normalAttrib = glGetAttribLocation(shader_program, "in_normal");
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)(sizeof(float) * 3));
-	glEnableVertexAttribArray(1);
+	// buffer of indices, the binding is stored in the vao
+	ebo = 0;
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
-	// color
-	//GLuint colorAttrib = glGetAttribLocation(shader_program, "in_color");
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)(sizeof(float) * 6));
-	glEnableVertexAttribArray(2);
+	ssbo_materials = 0;
+	glGenBuffers(1, &ssbo_materials);
 
-	// vertex texture coordinates
-	//GLuint texCoordAttrib = glGetAttribLocation(shader_program, "in_texcoord");
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, vertex_stride, (void*)(sizeof(float) * 9));
-	glEnableVertexAttribArray(3);
+	upload_queue_.Init();
+	gpu_memory_.staging = upload_queue_.staging_size();
+	gpu_timer_.Init();
+	scene_loader_.Start(filename);
 
-	// ambient
-	//GLuint colorAttrib = glGetAttribLocation(shader_program, "in_color");
-	glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)(sizeof(float) * 11));
-	glEnableVertexAttribArray(2);
+	glPointSize(2.0f);
+	glLineWidth(1.0f);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-	// specular
-	//GLuint colorAttrib = glGetAttribLocation(shader_program, "in_color");
-	glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)(sizeof(float) * 14));
-	glEnableVertexAttribArray(2);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	InitFrameBuffers();
+	//main loop
+	//release device
 
-	//material index
-	glVertexAttribIPointer(5, 1, GL_INT, vertex_stride, (void*)(sizeof(int) * 17));
-	glEnableVertexAttribArray(5);
+	return EXIT_SUCCESS;
+}
 
 
-	GLMaterial * gl_materials = new GLMaterial[materials_.size()];
-	int m = 0;
-	for (const auto & material : materials_) {
-		Texture * tex_diffuse = material->texture(Material::kDiffuseMapSlot);
-		if (tex_diffuse) {
-			GLuint id = 0;
-			CreateBindlessTexture(id, gl_materials[m].tex_diffuse_handle, tex_diffuse->width(), tex_diffuse->height(), tex_diffuse->data());
-			gl_materials[m].diffuse = Color3f{ 1.0f, 1.0f, 1.0f }; // white diffuse color
-		}
-		else {
-			GLuint id = 0;
-			GLubyte data[] = { 255, 255, 255, 255 }; // opaque white
-			CreateBindlessTexture(id, gl_materials[m].tex_diffuse_handle, 1, 1, data); // white texture
-			gl_materials[m].diffuse = material->diffuse();
-			gl_materials[m].ambient = material->ambient_;
-			gl_materials[m].specular = material->specular_;
-		}
-		m++;
+void Rasterizer::UploadMaterials(std::vector<Material *> & materials)
+{
+	// 1x1 placeholders are used until the textures are streamed
+	GLuint id = 0;
+	GLuint64 white_handle = 0;
+	GLubyte white[] = { 255, 255, 255, 255 }; // opaque white
+	CreateBindlessTexture(id, white_handle, 1, 1, white);
+	textures_.push_back(id);
+	GLuint64 opaque_handle = 0;
+	GLubyte opaque[] = { 255, 0, 0, 0 }; // fully opaque
+	CreateBindlessTexture(id, opaque_handle, 1, 1, opaque, GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+	textures_.push_back(id);
+	GLuint64 flat_handle = 0;
+	GLubyte flat[] = { 255, 128, 128, 0 }; // unperturbed tangent space normal (0, 0, 1) in BGR
+	CreateBindlessTexture(id, flat_handle, 1, 1, flat);
+	textures_.push_back(id);
+
+	// without bindless textures the textures of the materials are bound by DrawSurface
+	const MaterialTextures placeholders = { textures_[textures_.size() - 3], textures_[textures_.size() - 2], textures_[textures_.size() - 1] };
+	material_textures_.assign(std::max<size_t>(materials.size(), 1), placeholders); // surfaces without materials refer to the first one
+
+	gl_materials_.resize(materials.size());
+	for (size_t m = 0; m < materials.size(); ++m) {
+		const Material * material = materials[m];
+		gl_materials_[m].diffuse = material->diffuse();
+		gl_materials_[m].ambient = material->ambient_;
+		gl_materials_[m].specular = material->specular_;
+		gl_materials_[m].tex_diffuse_handle = white_handle;
+		gl_materials_[m].tex_opacity_handle = opaque_handle;
+		gl_materials_[m].tex_normal_handle = flat_handle;
 	}
-	GLuint ssbo_materials = 0;
-	glGenBuffers(1, &ssbo_materials);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_materials);
-	const GLsizeiptr gl_materials_size = sizeof(GLMaterial) * materials_.size();
-	glBufferData(GL_SHADER_STORAGE_BUFFER, gl_materials_size, gl_materials, GL_STATIC_DRAW);
+	const GLsizeiptr gl_materials_size = sizeof(GLMaterial) * gl_materials_.size();
+	glBufferData(GL_SHADER_STORAGE_BUFFER, gl_materials_size, gl_materials_.data(), GL_STATIC_DRAW);
+	gpu_memory_.materials = gl_materials_size;
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo_materials);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
+void Rasterizer::StreamMaterialTextures(std::vector<Material *> & materials)
+{
+	for (size_t m = 0; m < materials.size(); ++m) {
+		const Material * material = materials[m];
 
-	//GLuint ebo = 0; // optional buffer of indices
-	//glGenBuffers( 1, &ebo );
-	//glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
-	//glBufferData( GL_ELEMENT_ARRAY_BUFFER, (indices.size() * sizeof(int)), indices.data(), GL_STATIC_DRAW );
+		// the entry of the material buffer is rewritten when all levels of the texture were issued
+		auto update_material = [this, m]() {
+			glNamedBufferSubData(ssbo_materials, m * sizeof(GLMaterial), sizeof(GLMaterial), &gl_materials_[m]);
+		};
 
-	glPointSize(2.0f);
-	glLineWidth(1.0f);
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		Texture * tex_diffuse = material->texture(Material::kDiffuseMapSlot);
+		if (tex_diffuse && tex_diffuse->data()) {
+			const bool has_alpha = tex_diffuse->pixel_size() == 4;
+			const GLuint texture = CreateStreamedTexture(tex_diffuse, has_alpha ? GL_RGBA8 : GL_RGB8);
+			textures_.push_back(texture);
+			gpu_memory_.textures += MipChainSize(tex_diffuse, 4);
+			upload_queue_.EnqueueTexture(texture, tex_diffuse, has_alpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, [this, m, texture, update_material]() {
+				gl_materials_[m].tex_diffuse_handle = bindless_ ? MakeTextureResident(texture) : 0;
+				material_textures_[m].diffuse = texture;
+				gl_materials_[m].diffuse = Color3f{ 1.0f, 1.0f, 1.0f }; // white diffuse color
+				update_material();
+			});
+		}
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	InitFrameBuffers();
-	//main loop
-	//release device
+		// normal maps are linear data, the tangents come with the vertices
+		Texture * tex_normal = material->texture(Material::kNormalMapSlot);
+		if (tex_normal && tex_normal->data() && !tex_normal->single_channel()) {
+			const bool has_alpha = tex_normal->pixel_size() == 4;
+			const GLuint texture = CreateStreamedTexture(tex_normal, has_alpha ? GL_RGBA8 : GL_RGB8);
+			textures_.push_back(texture);
+			gpu_memory_.textures += MipChainSize(tex_normal, 4);
+			upload_queue_.EnqueueTexture(texture, tex_normal, has_alpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, [this, m, texture, update_material]() {
+				gl_materials_[m].tex_normal_handle = bindless_ ? MakeTextureResident(texture) : 0;
+				material_textures_[m].normal = texture;
+				update_material();
+			});
+		}
 
-	return EXIT_SUCCESS;
+		// single channel textures are uploaded with one 8-bit or 16-bit red channel
+		Texture * tex_opacity = material->texture(Material::kOpacityMapSlot);
+		if (tex_opacity && tex_opacity->data() && tex_opacity->single_channel()) {
+			const bool is_16bit = tex_opacity->pixel_size() == 2;
+			const GLuint texture = CreateStreamedTexture(tex_opacity, is_16bit ? GL_R16 : GL_R8);
+			textures_.push_back(texture);
+			gpu_memory_.textures += MipChainSize(tex_opacity, is_16bit ? 2 : 1);
+			upload_queue_.EnqueueTexture(texture, tex_opacity, GL_RED, is_16bit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, [this, m, texture, update_material]() {
+				gl_materials_[m].tex_opacity_handle = bindless_ ? MakeTextureResident(texture) : 0;
+				material_textures_[m].opacity = texture;
+				update_material();
+			});
+		}
+	}
 }
 
+void Rasterizer::ResizeSceneBuffer(GLuint & buffer, size_t & buffer_size, const size_t size)
+{
+	GLuint new_buffer = 0;
+	glCreateBuffers(1, &new_buffer);
+	glNamedBufferData(new_buffer, size, nullptr, GL_STATIC_DRAW);
+	if (buffer_size > 0) {
+		// the copy follows the uploads already issued to the old buffer
+		glCopyNamedBufferSubData(buffer, new_buffer, 0, 0, std::min(buffer_size, size));
+	}
+	upload_queue_.RetargetBuffer(buffer, new_buffer);
+	const GLuint old_buffer = buffer;
+	buffer = new_buffer;
+	buffer_size = size;
+
+	// the vao keeps the buffer objects, not their names
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	SetVertexFormat(gl_vertex_format, NO_GL_VERTEX_ATTRIBUTES, sizeof(GLVertex));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glDeleteBuffers(1, &old_buffer);
+}
+
+void Rasterizer::UpdateScene()
+{
+	if (scene_complete_ || !scene_loader_.materials_loaded())
+	{
+		return;
+	}
+
+	// the surfaces refer to the material buffer, so it precedes them, the textures follow once they are decoded
+	if (!materials_uploaded_)
+	{
+		UploadMaterials(scene_loader_.materials());
+		materials_uploaded_ = true;
+	}
+	if (!textures_streamed_ && scene_loader_.scene_loaded())
+	{
+		StreamMaterialTextures(scene_loader_.materials());
+		textures_streamed_ = true;
+	}
+
+	// batches are only queued here, the copies are spread over the following frames,
+	// the scene buffers grow by doubling as the sizes of the surfaces still being built are not known
+	SceneBatch batch;
+	while (scene_loader_.PopBatch(batch))
+	{
+		const size_t vertices_end = (batch.first_vertex + batch.vertices.size()) * sizeof(GLVertex);
+		if (vertices_end > gpu_memory_.vertex_buffer) {
+			ResizeSceneBuffer(vbo, gpu_memory_.vertex_buffer, std::max(vertices_end, 2 * gpu_memory_.vertex_buffer));
+		}
+		const size_t indices_end = batch.indices_offset + batch.indices.size();
+		if (indices_end > gpu_memory_.index_buffer) {
+			ResizeSceneBuffer(ebo, gpu_memory_.index_buffer, std::max(indices_end, 2 * gpu_memory_.index_buffer));
+		}
+
+		auto shared_batch = std::make_shared<SceneBatch>(std::move(batch));
+		upload_queue_.EnqueueBuffer(vbo, shared_batch->first_vertex * sizeof(GLVertex), shared_batch->vertices.data(),
+			shared_batch->vertices.size() * sizeof(GLVertex), shared_batch);
+		upload_queue_.EnqueueBuffer(ebo, shared_batch->indices_offset, shared_batch->indices.data(), shared_batch->indices.size(),
+			shared_batch, [this, shared_batch]() {
+			// the surfaces can be drawn once the copies of their vertices and indices were issued
+			surface_draws.insert(surface_draws.end(), shared_batch->surface_draws.begin(), shared_batch->surface_draws.end());
+			meshlets.insert(meshlets.end(), shared_batch->meshlets.begin(), shared_batch->meshlets.end());
+			no_triangles += shared_batch->no_triangles;
+		});
+	}
+
+	upload_queue_.Process(upload_budget_ms_);
+
+	if (textures_streamed_ && upload_queue_.empty() && scene_loader_.finished())
+	{
+		// the spare room left by the doubling is released
+		if (gpu_memory_.vertex_buffer > scene_loader_.no_vertices() * sizeof(GLVertex)) {
+			ResizeSceneBuffer(vbo, gpu_memory_.vertex_buffer, scene_loader_.no_vertices() * sizeof(GLVertex));
+		}
+		if (gpu_memory_.index_buffer > scene_loader_.index_buffer_size()) {
+			ResizeSceneBuffer(ebo, gpu_memory_.index_buffer, scene_loader_.index_buffer_size());
+		}
+
+		scene_loader_.TakeScene(surfaces_, materials_);
+		scene_complete_ = true;
+		occlusion_culler_.SetScene(surfaces_); // the surfaces are in the order of surface_draws
+
+		const double t = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - init_time_).count();
+		time_to_full_scene_ = t;
+		printf("Time to full scene: %s (%I64u surfaces, %d triangles)\n", TimeToString(t).c_str(), surfaces_.size(), no_triangles);
+	}
+}
 
 int Rasterizer::InitShaderProgram()
 {
@@ -442,17 +803,13 @@ int Rasterizer::InitShaderProgram()
 
 
 	shadow_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	const char * shadow_vertex_shader_source = LoadShader("shadow_shader.vert");
-	glShaderSource(shadow_vertex_shader, 1, &shadow_vertex_shader_source, nullptr);
+	LoadShader(shadow_vertex_shader, "shadow_shader.vert");
 	glCompileShader(shadow_vertex_shader);
-	SAFE_DELETE_ARRAY(shadow_vertex_shader_source);
 	CheckShader(shadow_vertex_shader);
 
 	shadow_fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	const char * shadow_fragment_shader_source = LoadShader("shadow_shader.frag");
-	glShaderSource(shadow_fragment_shader, 1, &shadow_fragment_shader_source, nullptr);
+	LoadShader(shadow_fragment_shader, "shadow_shader.frag");
 	glCompileShader(shadow_fragment_shader);
-	SAFE_DELETE_ARRAY(shadow_fragment_shader_source);
 	CheckShader(shadow_fragment_shader);
 
 	shadow_program = glCreateProgram();
@@ -485,29 +842,151 @@ void Rasterizer::InitFrameBuffers()
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, camera.width_, camera.height_);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo_color);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo_depth);
+	gpu_memory_.framebuffer = size_t(camera.width_) * camera.height_ * (4 + 4); // sRGB8 alpha8 and depth24 padded to 4 bytes
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return;
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 }
 
+void Rasterizer::DrawSurface(const int i, const Vector3 & eye)
+{
+	const SurfaceDraw & draw = surface_draws[i];
+	const int level = surface_levels_[i];
+	++culling_statistics_.visible_surfaces;
+
+	if (!bindless_ && draw.material != bound_material_ && draw.material < static_cast<int>(material_textures_.size()))
+	{
+		const MaterialTextures & textures = material_textures_[draw.material];
+		glBindTextureUnit(0, textures.diffuse);
+		glBindTextureUnit(1, textures.opacity);
+		glBindTextureUnit(2, textures.normal);
+		bound_material_ = draw.material;
+	}
+
+	// meshlets exist for the full detail level only, both sides of the triangles are drawn, so the meshlets facing away
+	// are hidden only on closed surfaces seen from outside (the camera in the box may as well be inside of the surface)
+	const bool inside = eye.x >= draw.lower.x && eye.y >= draw.lower.y && eye.z >= draw.lower.z &&
+		eye.x <= draw.upper.x && eye.y <= draw.upper.y && eye.z <= draw.upper.z;
+	if (level == 0 && cone_culling_ && draw.closed && !inside && draw.no_meshlets > 0)
+	{
+		DrawMeshlets(draw, eye);
+	}
+	else
+	{
+		const DrawRange & range = draw.lods[level];
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.count, range.type, (void*)range.offset, range.base_vertex);
+		culling_statistics_.visible_triangles += range.count / 3;
+		++culling_statistics_.draw_calls;
+	}
+}
+
+void Rasterizer::DrawMeshlets(const SurfaceDraw & draw, const Vector3 & eye)
+{
+	meshlet_counts_.clear();
+	meshlet_offsets_.clear();
+	meshlet_base_vertices_.clear();
+
+	const size_t index_size = (draw.lods[0].type == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+	size_t end = 0; // end of the last range, consecutive meshlets are contiguous in the index buffer and merged
+
+	for (int i = draw.first_meshlet; i < draw.first_meshlet + draw.no_meshlets; ++i)
+	{
+		const Meshlet & meshlet = meshlets[i];
+
+		if (IsMeshletBackFacing(meshlet, eye))
+		{
+			++culling_statistics_.culled_meshlets;
+			culling_statistics_.culled_triangles += meshlet.no_triangles;
+			continue;
+		}
+
+		const DrawRange range = MeshletRange(draw, meshlet);
+		if (!meshlet_counts_.empty() && range.offset == end)
+		{
+			meshlet_counts_.back() += range.count;
+		}
+		else
+		{
+			meshlet_counts_.push_back(range.count);
+			meshlet_offsets_.push_back((void*)range.offset);
+			meshlet_base_vertices_.push_back(range.base_vertex);
+		}
+		end = range.offset + range.count * index_size;
+
+		++culling_statistics_.visible_meshlets;
+		culling_statistics_.visible_triangles += meshlet.no_triangles;
+	}
+
+	if (!meshlet_counts_.empty())
+	{
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, meshlet_counts_.data(), draw.lods[0].type, meshlet_offsets_.data(),
+			static_cast<GLsizei>(meshlet_counts_.size()), meshlet_base_vertices_.data());
+		++culling_statistics_.draw_calls;
+	}
+}
+
 int Rasterizer::MainLoop()
 {
 	glUseProgram(shader_program);
+	if (window)
+	{
+		glfwSwapInterval(vsync_ ? 1 : 0);
+	}
+
+	// GPU times of the timed frames arrive GpuTimer::kLatency frames later
+	frame_times_.clear();
+	size_t first_timed_frame = SIZE_MAX; // number of the first timed frame in the GPU timer
+	gpu_timer_.on_frame_resolved = [&](const size_t gpu_frame, const double ms) {
+		if (gpu_frame >= first_timed_frame && gpu_frame - first_timed_frame < frame_times_.size())
+		{
+			frame_times_[gpu_frame - first_timed_frame].gpu_ms = ms;
+		}
+	};
 
 	float a = deg2rad(45);
-	while (!glfwWindowShouldClose(window))
+	while (!window || !glfwWindowShouldClose(window))
 	{
+		PROFILE_ZONE("frame");
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		const size_t frame = frame_times_.size();
+		const bool timed = no_timed_frames_ > 0 && scene_complete_;
+		const size_t gpu_frame = gpu_timer_.BeginFrame();
+		if (timed && frame == 0)
+		{
+			first_timed_frame = gpu_frame;
+		}
+
+		{
+			PROFILE_ZONE("clear");
+			gpu_timer_.BeginPass("clear");
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f); // state setting function
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // state using function
+			gpu_timer_.EndPass();
+		}
+
+		{
+			PROFILE_ZONE("upload");
+			gpu_timer_.BeginPass("upload");
+			UpdateScene();
+			gpu_timer_.EndPass();
+		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-		glDrawBuffer(GL_COLOR_ATTACHMENT0);
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f); // state setting function
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // state using function
+		// the path is replayed frame by frame, its first pose is held while the scene loads
+		float angle = a;
+		if (!camera_path_.empty())
+		{
+			const CameraKey key = camera_path_.at(static_cast<int>(frame), no_timed_frames_);
+			camera.set_view(key.view_from, key.view_at);
+			angle = key.model_angle;
+		}
 
 		glBindVertexArray(vao);
 		Matrix4x4 model;
-		model.set(0, 0, cosf(a));
-		model.set(0, 1, -sinf(a));
-		model.set(1, 0, sinf(a));
-		model.set(1, 1, cosf(a));
+		model.set(0, 0, cosf(angle));
+		model.set(0, 1, -sinf(angle));
+		model.set(1, 0, sinf(angle));
+		model.set(1, 1, cosf(angle));
 		a += 1e-2f;
 		Matrix4x4 mvp = camera.projection()*camera.view()*model;
 		SetMatrix4x4(shader_program, mvp.data(), "MVP");
@@ -515,26 +994,145 @@ int Rasterizer::MainLoop()
 		SetMatrix4x4(shader_program, mv.data(), "MV");
 
 
-		glDrawArrays(GL_TRIANGLES, 0, no_triangles*3);
+		{
+			PROFILE_ZONE("geometry");
+			gpu_timer_.BeginPass("geometry");
+
+			// surfaces outside of the view frustum are skipped (the planes are in object space, so the bounds are tested as they are),
+			// each visible surface is drawn by the coarsest level of detail whose error is not visible at its distance
+			const Frustum frustum(mvp);
+			const Vector3 eye = TransformPoint(Matrix4x4::EuclideanInverse(model), camera.view_from()); // for the normal cones of the meshlets
+			culling_statistics_ = CullingStatistics();
+			bound_material_ = -1; // the units may have been rebound by the uploads or the UI
+			surface_levels_.resize(surface_draws.size());
+			visible_surfaces_.clear();
+			visible_sizes_.clear();
+			for (size_t i = 0; i < surface_draws.size(); ++i)
+			{
+				const SurfaceDraw & draw = surface_draws[i];
+				if (frustum_culling_ && !(frustum.IsSphereVisible(draw.center, draw.radius) && frustum.IsBoxVisible(draw.lower, draw.upper)))
+				{
+					++culling_statistics_.culled_surfaces;
+					continue;
+				}
+
+				const float distance = std::max(camera.near_plane, TransformPoint(mv, draw.center).L2Norm() - draw.radius);
+				surface_levels_[i] = SelectLod(draw, distance, camera.focal_length(), lod_pixel_error_);
+				visible_surfaces_.push_back(static_cast<int>(i));
+				visible_sizes_.push_back(draw.radius / distance);
+			}
+
+			if (occlusion_culling_ && occlusion_culler_.ready())
+			{
+				// the largest surfaces are submitted as occluders while the workers test the boxes of the others against them
+				occlusion_culler_.Start(mvp, surface_draws, visible_surfaces_, visible_sizes_);
+				for (const int i : occlusion_culler_.occluders())
+				{
+					DrawSurface(i, eye);
+				}
+
+				const std::vector<unsigned char> & visible = occlusion_culler_.Finish();
+				const std::vector<int> & occludees = occlusion_culler_.occludees();
+				for (size_t k = 0; k < occludees.size(); ++k)
+				{
+					if (visible[k])
+					{
+						DrawSurface(occludees[k], eye);
+					}
+					else
+					{
+						++culling_statistics_.occluded_surfaces;
+					}
+				}
+
+				culling_statistics_.occluders = static_cast<int>(occlusion_culler_.occluders().size());
+				culling_statistics_.occlusion_ms = occlusion_culler_.time_ms();
+			}
+			else
+			{
+				for (const int i : visible_surfaces_)
+				{
+					DrawSurface(i, eye);
+				}
+			}
 		
-		//glDrawArrays( GL_POINTS, 0, 3 );
-		//glDrawArrays( GL_LINE_LOOP, 0, 3 );
-		//glDrawElements( GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0 ); // optional - render from an index buffer
+			//glDrawArrays( GL_POINTS, 0, 3 );
+			//glDrawArrays( GL_LINE_LOOP, 0, 3 );
+
+			gpu_timer_.EndPass();
+		}
 
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo); // bind custom FBO for reading
-		glReadBuffer(GL_COLOR_ATTACHMENT0); // select its first color buffer for reading
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // bind default FBO (0) for writing
-		glDrawBuffer(GL_BACK_LEFT); // select its left back buffer for writing
-		glBlitFramebuffer(0, 0, camera.width_, camera.height_, 0, 0, camera.width_, camera.height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);// copy
+		FrameTime frame_time;
+		frame_time.cpu_ms = 1e3 * std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+		cpu_frame_ms_ = static_cast<float>(frame_time.cpu_ms);
 
-		//new program
-		//InitShaderProgram();
+		if (headless_)
+		{
+			// the image stays in the FBO, the frame is waited for so that its time covers the GPU work
+			PROFILE_ZONE("finish");
+			glFinish();
+		}
+		else
+		{
+			{
+				PROFILE_ZONE("resolve");
+				gpu_timer_.BeginPass("resolve");
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo); // bind custom FBO for reading
+				glReadBuffer(GL_COLOR_ATTACHMENT0); // select its first color buffer for reading
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // bind default FBO (0) for writing
+				glDrawBuffer(GL_BACK_LEFT); // select its left back buffer for writing
+				glBlitFramebuffer(0, 0, camera.width_, camera.height_, 0, 0, camera.width_, camera.height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);// copy
+				gpu_timer_.EndPass();
+			}
 
-		glfwSwapBuffers(window);
-		glfwSwapInterval(1);
-		glfwPollEvents();
+			if (ui_initialized_)
+			{
+				{
+					PROFILE_ZONE("ui");
+					gpu_timer_.BeginPass("ui");
+					Ui();
+					gpu_timer_.EndPass();
+				}
+			}
 
+			//new program
+			//InitShaderProgram();
+
+			{
+				PROFILE_ZONE("swap");
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+			}
+
+			if (gpu_overlay_)
+			{
+				UpdateOverlay();
+			}
+		}
+
+		if (first_frame_)
+		{
+			first_frame_ = false;
+			const double t = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - init_time_).count();
+			time_to_first_frame_ = t;
+			printf("Time to first frame: %s\n", TimeToString(t).c_str());
+		}
+
+		// only the frames drawing the whole scene are timed
+		if (timed)
+		{
+			frame_time.frame_ms = 1e3 * std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+			frame_times_.push_back(frame_time);
+			if (static_cast<int>(frame_times_.size()) >= no_timed_frames_)
+			{
+				break;
+			}
+		}
 	}
+
+	gpu_timer_.Flush();
+	gpu_timer_.on_frame_resolved = nullptr;
+
 	return S_OK;
 }
 
@@ -561,14 +1159,43 @@ int Rasterizer::MainLoop()
 
 int Rasterizer::ReleaseDeviceAndScene()
 {
+	// nothing to release without a context (the initialization failed or the device was released already)
+	if (!window && !headless_context_.is_created())
+	{
+		return S_OK;
+	}
+
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 	glDeleteProgram(shader_program);
 
 	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	glDeleteBuffers(1, &ssbo_materials);
 	glDeleteVertexArrays(1, &vao);
+	glDeleteTextures(static_cast<GLsizei>(textures_.size()), textures_.data());
+	textures_.clear();
+	upload_queue_.Release();
+	gpu_timer_.Release();
+
+	if (ui_initialized_)
+	{
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+		ui_initialized_ = false;
+	}
 
-	glfwTerminate();
+	// the loading thread may still run if the window was closed early
+	scene_loader_.TakeScene(surfaces_, materials_);
+	ReleaseScene(surfaces_, materials_);
+
+	if (window)
+	{
+		glfwTerminate();
+		window = nullptr;
+	}
+	headless_context_.Release();
 	return S_OK;
 }
 
@@ -9,6 +9,23 @@
 #include "glutils.h"
 #include "mymath.h"
 #include "raytracer.h"
+#include "sceneloader.h"
+#include "uploadqueue.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "camerapath.h"
+#include "gputimer.h"
+#include "headlesscontext.h"
+
+/*! \struct FrameTime
+\brief Times of one frame measured by the timed MainLoop.
+*/
+struct FrameTime
+{
+	double cpu_ms{ 0.0 }; /*!< Recording of the frame (scene updates, culling and draw calls) on the CPU. */
+	double gpu_ms{ 0.0 }; /*!< Execution of the same commands on the GPU (timer query). */
+	double frame_ms{ 0.0 }; /*!< Wall time of the whole frame including the swap or glFinish. */
+};
 
 /*! \class Raytracer
 \brief General ray tracer class.
@@ -23,7 +40,11 @@ public:
 	Rasterizer(const int width, const int height, const float fov_y, const Vector3 view_from, const Vector3 view_at,float near_plane,float far_plane);
 	~Rasterizer();
 
-	int InitDeviceAndScene(const char* filename);
+	/* opens the window, or with no_headless_frames > 0 creates an offscreen context (see HeadlessContext, a hidden window
+	is the fallback) for MainLoop which then renders the given number of frames of the fully loaded scene into the FBO and returns */
+	int InitDeviceAndScene(const char* filename, const int no_headless_frames = 0);
+	/* initializes GLFW and creates the window with its context, hidden in the headless mode */
+	int InitWindow();
 	int InitShaderProgram();
 	void InitFrameBuffers();
 	int initGraph();
@@ -35,16 +56,57 @@ public:
 
 	bool check_gl(const GLenum error = glGetError());
 
+	/* numbers of drawn and culled surfaces of the last frame */
+	const CullingStatistics & culling_statistics() const;
+
+	/* MainLoop replays the path in no_frames frames (after the scene is loaded) with vsync off and returns */
+	void SetCameraPath(const CameraPath & path, const int no_frames);
+
+	/* times of the frames rendered by the headless MainLoop or along the camera path */
+	const std::vector<FrameTime> & frame_times() const;
+
+	/* rolling averages of the GPU times of the passes of MainLoop (clear, upload, geometry and resolve) */
+	const GpuTimer & gpu_timer() const;
+
+	/* shows the GPU times of the passes in the title of the window */
+	void UpdateOverlay();
+
+	/* toggles the ImGui overlay */
+	void ToggleUi();
+
 	//void GLAPIENTRY gl_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar * message, const void * user_param);
 	//void framebuffer_resize_callback(GLFWwindow * window, int width, int height);
 	//char * LoadShader(const char * file_name);
 	//GLint CheckShader(const GLenum shader);
 
 	void LoadScene(const std::string file_name);
+
+	/* performance overlay drawn by Dear ImGui into the default framebuffer (frame time graphs, GPU passes, culling counts,
+	GPU memory and loader timings) with runtime switches of the culling, LOD and streaming settings, F1 hides it */
 	int Ui();
 
+	/* queues materials and batches of surfaces handed over by the loading thread and streams them to the GPU, called once per frame */
+	void UpdateScene();
+
+	/* uploads the colors of the materials with placeholder textures, the textures follow by StreamMaterialTextures once decoded */
+	void UploadMaterials(std::vector<Material *> & materials);
+	void StreamMaterialTextures(std::vector<Material *> & materials);
+
+	/* reallocates the scene buffer (vbo or ebo) to size bytes, its content and the pending uploads move to the new buffer */
+	void ResizeSceneBuffer(GLuint & buffer, size_t & buffer_size, const size_t size);
+
+	/* draws the i-th surface by the level selected in this frame */
+	void DrawSurface(const int i, const Vector3 & eye);
+
+	/* draws the full detail level of the surface by its meshlets which do not face away from the eye (in object space) */
+	void DrawMeshlets(const SurfaceDraw & draw, const Vector3 & eye);
+
 	GLuint vao = 0;
 	GLuint vbo = 0;
+	GLuint ebo = 0;
+	GLuint ssbo_materials = 0;
+	std::vector<SurfaceDraw> surface_draws;
+	std::vector<Meshlet> meshlets; // meshlets of all surfaces, see SurfaceDraw::first_meshlet and MeshletRange
 	GLuint shadow_vao = 0;
 	GLuint shadow_vbo = 0;
 	GLuint fbo = 0;
@@ -60,7 +122,7 @@ public:
 	GLuint shadow_fragment_shader;
 	GLuint shadow_program;
 
-	GLFWwindow * window;
+	GLFWwindow * window = nullptr;
 
 
 	Raytracer * raytracer;
@@ -80,4 +142,75 @@ private:
 
 	bool unify_normals_{ true };
 
+	SceneLoader scene_loader_; // loads the scene in the background while the window is already rendering
+	bool materials_uploaded_{ false };
+	bool textures_streamed_{ false };
+	bool scene_complete_{ false };
+	bool first_frame_{ true };
+	std::chrono::high_resolution_clock::time_point init_time_; // start of InitDeviceAndScene, for the startup metrics
+
+	bool headless_{ false }; // no window is shown, the frames are left in the FBO, each frame is finished by glFinish
+	HeadlessContext headless_context_; // context of the headless mode, window stays null and GLFW is not initialized then
+	int no_timed_frames_{ 0 }; // MainLoop returns after this many frames drawn once the scene was complete, 0 runs until the window closes
+	CameraPath camera_path_; // poses of the timed frames, the model spins by itself if empty
+	bool vsync_{ true };
+	std::vector<FrameTime> frame_times_;
+
+	GpuTimer gpu_timer_;
+	bool gpu_overlay_{ true }; // GPU times of the passes in the window title
+	std::chrono::high_resolution_clock::time_point overlay_time_; // last update of the overlay
+
+	/* bytes of the GPU resources allocated by the rasterizer */
+	struct GpuMemory
+	{
+		size_t vertex_buffer{ 0 };
+		size_t index_buffer{ 0 };
+		size_t materials{ 0 };
+		size_t textures{ 0 }; // full mip chains, RGB8 counted as 4 bytes per texel as the drivers store it
+		size_t staging{ 0 };
+		size_t framebuffer{ 0 };
+	};
+
+	static const int kNoUiFrames = 256; // length of the frame time graphs
+	bool ui_initialized_{ false }; // ImGui exists (not in the headless mode)
+	bool show_ui_{ true };
+	GpuMemory gpu_memory_;
+	float cpu_frame_ms_{ 0.0f }; // recording of the last frame
+	std::vector<float> cpu_frame_history_; // rings of the frame times shown by Ui
+	std::vector<float> gpu_frame_history_;
+	int ui_frame_{ 0 };
+	double time_to_first_frame_{ 0.0 }; // s
+	double time_to_full_scene_{ 0.0 };
+
+	UploadQueue upload_queue_; // streams the scene buffers and textures through a persistently mapped staging buffer
+	double upload_budget_ms_{ 2.0 }; // time per frame spent by copying to the staging buffer
+	std::vector<GLMaterial> gl_materials_; // copy of the material buffer, entries are updated once their textures arrive
+	std::vector<GLuint> textures_;
+
+	/* textures of a material bound to the units 0-2 when the handles in the material buffer are not available */
+	struct MaterialTextures
+	{
+		GLuint diffuse;
+		GLuint opacity;
+		GLuint normal;
+	};
+
+	bool bindless_{ true }; // GL_ARB_bindless_texture, it is missing e.g. in Mesa's llvmpipe
+	std::vector<MaterialTextures> material_textures_;
+	int bound_material_{ -1 }; // material whose textures are bound in the current frame, -1 if none
+
+	float lod_pixel_error_{ 1.0f }; // the coarsest level of detail whose error projects to at most this many pixels is drawn
+
+	bool frustum_culling_{ true }; // skip surfaces whose bounds lie outside of the view frustum
+	bool cone_culling_{ true }; // skip meshlets of closed surfaces facing away from the camera
+	bool occlusion_culling_{ true }; // skip surfaces hidden behind the largest ones, available once the whole scene is loaded
+	OcclusionCuller occlusion_culler_;
+	CullingStatistics culling_statistics_;
+	std::vector<int> surface_levels_; // level of detail of each surface selected in the current frame
+	std::vector<int> visible_surfaces_; // surfaces within the view frustum
+	std::vector<float> visible_sizes_; // radii of their bounding spheres divided by the distances
+	std::vector<GLsizei> meshlet_counts_; // arguments of glMultiDrawElementsBaseVertex reused by DrawMeshlets
+	std::vector<const void *> meshlet_offsets_;
+	std::vector<GLint> meshlet_base_vertices_;
+
 };
\ No newline at end of file
@@ -136,7 +136,7 @@ void Raytracer::LoadScene(int no_surfaces,std::vector<Surface *> & surfaces, std
 		// triangles loop
 		for (int i = 0; i < surface->no_triangles(); ++i, ++l)
 		{
-			Triangle & triangle = surface->get_triangle(i);
+			Triangle triangle = surface->get_triangle(i);
 
 			materialData[l].x = (unsigned char)surface->get_material()->material_index;
 
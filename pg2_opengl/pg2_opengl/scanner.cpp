@@ -0,0 +1,240 @@
+#include "pch.h"
+#include "scanner.h"
+
+static inline bool IsSpace( const char c )
+{
+	return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' );
+}
+
+static inline bool IsDigit( const char c )
+{
+	return static_cast<unsigned char>( c - '0' ) < 10;
+}
+
+const char * SkipSpaces( const char * p, const char * end )
+{
+	while ( ( p < end ) && IsSpace( *p ) )
+	{
+		++p;
+	}
+
+	return p;
+}
+
+const char * ScanToken( const char * p, const char * end, const char *& token_begin, const char *& token_end )
+{
+	const char * q = SkipSpaces( p, end );
+	const char * begin = q;
+
+	while ( ( q < end ) && !IsSpace( *q ) && ( *q != '\n' ) )
+	{
+		++q;
+	}
+
+	if ( q == begin )
+	{
+		return p;
+	}
+
+	token_begin = begin;
+	token_end = q;
+
+	return q;
+}
+
+bool TokenEquals( const char * token_begin, const char * token_end, const char * keyword )
+{
+	const size_t length = strlen( keyword );
+
+	return ( static_cast<size_t>( token_end - token_begin ) == length ) && ( memcmp( token_begin, keyword, length ) == 0 );
+}
+
+const char * ScanInt( const char * p, const char * end, int & value )
+{
+	const char * q = SkipSpaces( p, end );
+
+	bool negative = false;
+	if ( ( q < end ) && ( *q == '-' || *q == '+' ) )
+	{
+		negative = ( *q == '-' );
+		++q;
+	}
+
+	if ( ( q >= end ) || !IsDigit( *q ) )
+	{
+		return p;
+	}
+
+	int result = 0;
+	while ( ( q < end ) && IsDigit( *q ) )
+	{
+		result = result * 10 + ( *q - '0' );
+		++q;
+	}
+
+	value = negative ? -result : result;
+
+	return q;
+}
+
+/* slow path for the numbers ScanFloat does not handle itself */
+static const char * ScanFloatStrtod( const char * p, const char * end, float & value )
+{
+	char buffer[64];
+	const size_t length = std::min( static_cast<size_t>( end - p ), sizeof( buffer ) - 1 );
+	memcpy( buffer, p, length );
+	buffer[length] = 0;
+
+	char * number_end = nullptr;
+	const double result = strtod( buffer, &number_end );
+	if ( number_end == buffer )
+	{
+		return p;
+	}
+
+	value = static_cast<float>( result );
+
+	return p + ( number_end - buffer );
+}
+
+const char * ScanFloat( const char * p, const char * end, float & value )
+{
+	// exact powers of ten, the mantissa scaled by one of them is rounded only once
+	static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const int max_exponent = 22;
+	const int max_digits = 18; // fits into unsigned long long without overflow
+
+	const char * number_begin = SkipSpaces( p, end );
+	const char * q = number_begin;
+
+	bool negative = false;
+	if ( ( q < end ) && ( *q == '-' || *q == '+' ) )
+	{
+		negative = ( *q == '-' );
+		++q;
+	}
+
+	unsigned long long mantissa = 0;
+	int no_digits = 0; // significant digits in mantissa
+	int exponent = 0;
+	bool has_digits = false;
+
+	// integer part, leading zeros are not significant
+	for ( ; ( q < end ) && IsDigit( *q ); ++q )
+	{
+		has_digits = true;
+		if ( mantissa != 0 || *q != '0' )
+		{
+			if ( no_digits == max_digits )
+			{
+				return ScanFloatStrtod( number_begin, end, value );
+			}
+			mantissa = mantissa * 10 + ( *q - '0' );
+			++no_digits;
+		}
+	}
+
+	// fractional part
+	if ( ( q < end ) && ( *q == '.' ) )
+	{
+		for ( ++q; ( q < end ) && IsDigit( *q ); ++q )
+		{
+			has_digits = true;
+			if ( mantissa != 0 || *q != '0' )
+			{
+				if ( no_digits == max_digits )
+				{
+					// the remaining digits do not change the float result
+					continue;
+				}
+				mantissa = mantissa * 10 + ( *q - '0' );
+				++no_digits;
+			}
+			--exponent;
+		}
+	}
+
+	if ( !has_digits )
+	{
+		// inf, nan or not a number at all
+		return ScanFloatStrtod( number_begin, end, value );
+	}
+
+	// exponent part
+	if ( ( q < end ) && ( *q == 'e' || *q == 'E' ) )
+	{
+		int exponent_part = 0;
+		const char * exponent_end = ScanInt( q + 1, end, exponent_part );
+		if ( ( exponent_end != q + 1 ) && !IsSpace( q[1] ) ) // ScanInt succeeded so q[1] exists
+		{
+			exponent += exponent_part;
+			q = exponent_end;
+		}
+	}
+
+	double result = static_cast<double>( mantissa );
+	if ( mantissa != 0 )
+	{
+		if ( exponent < -max_exponent || exponent > max_exponent )
+		{
+			return ScanFloatStrtod( number_begin, end, value );
+		}
+
+		result = ( exponent < 0 ) ? result / powers_of_ten[-exponent] : result * powers_of_ten[exponent];
+	}
+
+	value = static_cast<float>( negative ? -result : result );
+
+	return q;
+}
+
+const char * ScanFloats( const char * p, const char * end, float * values, const int n, int & no_values )
+{
+	no_values = 0;
+
+	while ( no_values < n )
+	{
+		const char * q = ScanFloat( p, end, values[no_values] );
+		if ( q == p )
+		{
+			break;
+		}
+		p = q;
+		++no_values;
+	}
+
+	return p;
+}
+
+const char * ScanIndexTriplet( const char * p, const char * end, int & v, int & vt, int & vn )
+{
+	int indices[3] = { 0, 0, 0 };
+
+	const char * q = ScanInt( p, end, indices[0] );
+	if ( q == p )
+	{
+		return p;
+	}
+
+	// "/vt" or "//vn" or "/vt/vn"
+	for ( int i = 1; ( i < 3 ) && ( q < end ) && ( *q == '/' ); ++i )
+	{
+		++q;
+		if ( ( q < end ) && ( *q != '/' ) )
+		{
+			const char * r = ScanInt( q, end, indices[i] );
+			if ( r == q )
+			{
+				break;
+			}
+			q = r;
+		}
+	}
+
+	v = indices[0];
+	vt = indices[1];
+	vn = indices[2];
+
+	return q;
+}
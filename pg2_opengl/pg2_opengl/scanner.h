@@ -0,0 +1,50 @@
+#ifndef SCANNER_H_
+#define SCANNER_H_
+
+/*
+Hand-written scanners of text formats (OBJ, MTL), they replace sscanf in the loaders.
+
+All functions work on the range <p, end), the data need not be NULL terminated.
+On success they return the position right behind the scanned item (leading spaces
+and tabs are skipped), on failure they return p and leave the output untouched.
+*/
+
+/*! \fn const char * SkipSpaces( const char * p, const char * end )
+\brief Skips spaces, tabs and carriage returns.
+*/
+const char * SkipSpaces( const char * p, const char * end );
+
+/*! \fn const char * ScanToken( const char * p, const char * end, const char *& token_begin, const char *& token_end )
+\brief Scans a sequence of non-white characters, e.g. a keyword or a file name.
+*/
+const char * ScanToken( const char * p, const char * end, const char *& token_begin, const char *& token_end );
+
+/*! \fn bool TokenEquals( const char * token_begin, const char * token_end, const char * keyword )
+\brief Returns true if the token is exactly the given NULL terminated keyword.
+*/
+bool TokenEquals( const char * token_begin, const char * token_end, const char * keyword );
+
+/*! \fn const char * ScanInt( const char * p, const char * end, int & value )
+\brief Scans a decimal integer with an optional sign.
+*/
+const char * ScanInt( const char * p, const char * end, int & value );
+
+/*! \fn const char * ScanFloat( const char * p, const char * end, float & value )
+\brief Scans a real number in fixed or scientific notation (e.g. -1.5, .25, 3e-2).
+Numbers with more than 18 significant digits, inf and nan fall back to strtod.
+*/
+const char * ScanFloat( const char * p, const char * end, float & value );
+
+/*! \fn const char * ScanFloats( const char * p, const char * end, float * values, const int n, int & no_values )
+\brief Scans up to \a n real numbers separated by spaces.
+\return Position behind the last scanned number, \a no_values is set to their count.
+*/
+const char * ScanFloats( const char * p, const char * end, float * values, const int n, int & no_values );
+
+/*! \fn const char * ScanIndexTriplet( const char * p, const char * end, int & v, int & vt, int & vn )
+\brief Scans OBJ face vertex "v", "v/vt", "v//vn" or "v/vt/vn".
+Indices are returned as written in the file, i.e. 1-based or negative (relative), missing ones are set to zero.
+*/
+const char * ScanIndexTriplet( const char * p, const char * end, int & v, int & vt, int & vn );
+
+#endif
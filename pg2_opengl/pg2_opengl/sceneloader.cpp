@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "sceneloader.h"
+#include "objloader.h"
+#include "mymath.h"
+#include "profiler.h"
+
+int SelectLod( const SurfaceDraw & draw, const float distance, const float focal_length, const float max_pixel_error )
+{
+	int level = 0;
+	while ( level + 1 < draw.no_lods && draw.lod_errors[level + 1] * focal_length <= max_pixel_error * distance )
+	{
+		++level;
+	}
+
+	return level;
+}
+
+DrawRange MeshletRange( const SurfaceDraw & draw, const Meshlet & meshlet )
+{
+	DrawRange range = draw.lods[0];
+	range.count = meshlet.no_triangles * 3;
+	range.offset += meshlet.triangle_offset * 3 * ( ( range.type == GL_UNSIGNED_SHORT ) ? sizeof( GLushort ) : sizeof( GLuint ) );
+
+	return range;
+}
+
+SceneLoader::~SceneLoader()
+{
+	Join();
+}
+
+void SceneLoader::Start( const std::string & file_name, const int batch_triangles )
+{
+	assert( !thread_.joinable() );
+
+	batch_triangles_ = batch_triangles;
+	thread_ = std::thread( &SceneLoader::Load, this, file_name );
+}
+
+void SceneLoader::Join()
+{
+	if ( thread_.joinable() )
+	{
+		thread_.join();
+	}
+}
+
+bool SceneLoader::materials_loaded() const
+{
+	return materials_loaded_.load( std::memory_order_acquire );
+}
+
+bool SceneLoader::scene_loaded() const
+{
+	return scene_loaded_.load( std::memory_order_acquire );
+}
+
+size_t SceneLoader::no_vertices() const
+{
+	return no_vertices_;
+}
+
+size_t SceneLoader::index_buffer_size() const
+{
+	return index_buffer_size_;
+}
+
+std::vector<Material *> & SceneLoader::materials()
+{
+	return materials_;
+}
+
+double SceneLoader::load_time() const
+{
+	return load_time_;
+}
+
+double SceneLoader::batch_time() const
+{
+	return batch_time_;
+}
+
+bool SceneLoader::PopBatch( SceneBatch & batch )
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+
+	if ( batches_.empty() )
+	{
+		return false;
+	}
+
+	batch = std::move( batches_.front() );
+	batches_.pop();
+
+	return true;
+}
+
+bool SceneLoader::finished()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+
+	return all_batches_prepared_ && batches_.empty();
+}
+
+void SceneLoader::TakeScene( std::vector<Surface *> & surfaces, std::vector<Material *> & materials )
+{
+	Join();
+
+	surfaces.insert( surfaces.end(), surfaces_.begin(), surfaces_.end() );
+	materials.insert( materials.end(), materials_.begin(), materials_.end() );
+	surfaces_.clear();
+	materials_.clear();
+}
+
+void SceneLoader::Load( const std::string file_name )
+{
+	Profiler::SetThreadName( "scene loader" );
+	PROFILE_ZONE( "SceneLoader::Load" );
+
+	OBJLoaderOptions options;
+	options.on_materials_loaded = [this]()
+	{
+		materials_loaded_.store( true, std::memory_order_release );
+	};
+	options.on_surface_loaded = [this]( Surface * surface )
+	{
+		AddSurface( surface );
+	};
+
+	// the surfaces arrive in the batches while LoadOBJ is still building the others
+	const auto t0 = std::chrono::high_resolution_clock::now();
+	std::vector<Surface *> surfaces;
+	LoadOBJ( file_name.c_str(), surfaces, materials_, options );
+	load_time_ = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - t0 ).count();
+
+	materials_loaded_.store( true, std::memory_order_release ); // even if the file could not be loaded
+	scene_loaded_.store( true, std::memory_order_release );
+
+	// surfaces left over by the last batch
+	std::vector<Surface *> last_surfaces;
+	{
+		std::unique_lock<std::mutex> lock( mutex_ );
+		last_surfaces.swap( pending_surfaces_ );
+	}
+	if ( !last_surfaces.empty() )
+	{
+		PrepareBatch( last_surfaces );
+	}
+
+	std::unique_lock<std::mutex> lock( mutex_ );
+	assert( surfaces_.size() == surfaces.size() );
+	printf( "%I64u vertices (%I64u before welding), %0.1f MB of vertex and index data\n", no_vertices_, no_face_vertices_,
+		( no_vertices_ * sizeof( GLVertex ) + index_buffer_size_ ) / sqr( 1024.0f ) );
+	all_batches_prepared_ = true;
+}
+
+void SceneLoader::AddSurface( Surface * surface )
+{
+	std::vector<Surface *> batch_surfaces;
+	{
+		std::unique_lock<std::mutex> lock( mutex_ );
+		pending_surfaces_.push_back( surface );
+		pending_triangles_ += surface->no_triangles();
+		if ( pending_triangles_ < batch_triangles_ )
+		{
+			return;
+		}
+		batch_surfaces.swap( pending_surfaces_ );
+		pending_triangles_ = 0;
+	}
+
+	PrepareBatch( batch_surfaces );
+}
+
+void SceneLoader::PrepareBatch( const std::vector<Surface *> & surfaces )
+{
+	PROFILE_ZONE( "SceneLoader::Batch" );
+	const auto t0 = std::chrono::high_resolution_clock::now();
+
+	SceneBatch batch;
+	std::vector<SurfaceDraw> & draws = batch.surface_draws;
+	draws.resize( surfaces.size() );
+
+	// layout of the batch behind the previous ones, indices are relative to the first vertex of the surface
+	// and 16 bits are enough for most surfaces, 32-bit indices must be 4-byte aligned,
+	// indices of the levels of detail follow the full detail ones and share its vertices
+	{
+		std::unique_lock<std::mutex> lock( mutex_ );
+		batch.first_vertex = no_vertices_;
+		batch.indices_offset = index_buffer_size_;
+
+		for ( size_t i = 0; i < surfaces.size(); ++i )
+		{
+			Surface * surface = surfaces[i];
+			SurfaceDraw & draw = draws[i];
+
+			BoundingBox( surface, draw.lower, draw.upper );
+			draw.center = ( draw.lower + draw.upper ) * 0.5f;
+			draw.radius = ( draw.upper - draw.lower ).L2Norm() * 0.5f;
+			draw.no_lods = 1 + surface->no_lods();
+			draw.material = surface->get_material() ? surface->get_material()->material_index : 0;
+			draw.no_meshlets = static_cast<int>( surface->get_meshlets().meshlets.size() );
+			draw.closed = surface->get_meshlets().closed && !( surface->get_material() && surface->get_material()->texture( Material::kOpacityMapSlot ) );
+
+			for ( int level = 0; level < draw.no_lods; ++level )
+			{
+				DrawRange & range = draw.lods[level];
+
+				range.count = static_cast<GLsizei>( ( level == 0 ) ? surface->no_triangles() * 3 : surface->get_lod( level - 1 ).indices.size() * 3 );
+				range.base_vertex = static_cast<GLint>( no_vertices_ );
+				draw.lod_errors[level] = ( level == 0 ) ? 0.0f : surface->get_lod( level - 1 ).error;
+
+				if ( surface->no_vertices() <= 65536 )
+				{
+					range.type = GL_UNSIGNED_SHORT;
+					range.offset = index_buffer_size_;
+					index_buffer_size_ += range.count * sizeof( GLushort );
+				}
+				else
+				{
+					range.type = GL_UNSIGNED_INT;
+					range.offset = ( index_buffer_size_ + 3 ) & ~size_t( 3 );
+					index_buffer_size_ = range.offset + range.count * sizeof( GLuint );
+				}
+			}
+
+			no_vertices_ += surface->no_vertices();
+			no_face_vertices_ += draw.lods[0].count;
+		}
+	}
+
+	// --- conversion of the surfaces to the GPU format ---
+	for ( size_t i = 0; i < surfaces.size(); ++i )
+	{
+		Surface * surface = surfaces[i];
+		const SurfaceDraw & draw = draws[i];
+
+		for ( int j = 0; j < surface->no_vertices(); ++j )
+		{
+			batch.vertices.push_back( GLVertex( surface->get_vertices()[j], draw.material ) );
+		}
+
+		for ( int level = 0; level < draw.no_lods; ++level )
+		{
+			const DrawRange & range = draw.lods[level];
+			const unsigned int * surface_indices = ( level == 0 ) ? &surface->get_indices()[0].v0 : &surface->get_lod( level - 1 ).indices[0].v0;
+			const size_t offset = range.offset - batch.indices_offset;
+			if ( range.type == GL_UNSIGNED_SHORT )
+			{
+				batch.indices.resize( offset + range.count * sizeof( GLushort ) );
+				GLushort * dst = reinterpret_cast<GLushort *>( &batch.indices[offset] );
+				for ( int j = 0; j < range.count; ++j )
+				{
+					dst[j] = static_cast<GLushort>( surface_indices[j] );
+				}
+			}
+			else
+			{
+				batch.indices.resize( offset + range.count * sizeof( GLuint ) );
+				memcpy( &batch.indices[offset], surface_indices, range.count * sizeof( GLuint ) );
+			}
+		}
+
+		batch.meshlets.insert( batch.meshlets.end(), surface->get_meshlets().meshlets.begin(), surface->get_meshlets().meshlets.end() );
+		batch.no_triangles += surface->no_triangles();
+	}
+
+	// the render thread appends the meshlets and the surfaces in the order of the queue
+	std::unique_lock<std::mutex> lock( mutex_ );
+	for ( SurfaceDraw & draw : draws )
+	{
+		draw.first_meshlet = no_meshlets_;
+		no_meshlets_ += draw.no_meshlets;
+	}
+	surfaces_.insert( surfaces_.end(), surfaces.begin(), surfaces.end() );
+	batch_time_ += std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - t0 ).count();
+	batches_.push( std::move( batch ) );
+}
@@ -0,0 +1,149 @@
+#ifndef SCENE_LOADER_H_
+#define SCENE_LOADER_H_
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <queue>
+
+#include "surface.h"
+#include "vertex.h"
+
+/*! \struct DrawRange
+\brief Part of the shared vertex and index buffers drawn by a single glDrawElementsBaseVertex call.
+*/
+struct DrawRange
+{
+	GLsizei count{ 0 }; /*!< Number of indices. */
+	GLenum type{ GL_UNSIGNED_INT }; /*!< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT. */
+	size_t offset{ 0 }; /*!< Byte offset of the first index in the index buffer. */
+	GLint base_vertex{ 0 }; /*!< Index of the first vertex of the surface in the vertex buffer. */
+};
+
+/*! \struct SurfaceDraw
+\brief Draw ranges of all levels of detail of a surface and its bounds used to cull it and to select among the levels.
+*/
+struct SurfaceDraw
+{
+	DrawRange lods[MAX_LODS]; /*!< Draw ranges from the full detail surface to the coarsest level, all share the base vertex. */
+	float lod_errors[MAX_LODS] = { 0.0f }; /*!< Deviations of the levels from the full detail surface in object space units. */
+	int no_lods{ 1 }; /*!< Number of valid levels including the full detail one. */
+	Vector3 center; /*!< Center of the bounding sphere in object space. */
+	float radius{ 0.0f }; /*!< Radius of the bounding sphere. */
+	Vector3 lower; /*!< Minimal corner of the axis aligned bounding box in object space. */
+	Vector3 upper; /*!< Maximal corner of the axis aligned bounding box in object space. */
+	int first_meshlet{ 0 }; /*!< Position of the first meshlet of the surface in the meshlets of the scene. */
+	int no_meshlets{ 0 }; /*!< Number of meshlets of the full detail level, zero if the surface was not decomposed. */
+	bool closed{ false }; /*!< Closed surface (SurfaceMeshlets::closed) without an opacity map, its back faces are hidden from outside of its box. */
+	int material{ 0 }; /*!< Index of the material of the surface in the material buffer. */
+};
+
+/*! \fn int SelectLod( const SurfaceDraw & draw, const float distance, const float focal_length, const float max_pixel_error )
+\brief Returns the coarsest level of detail of the surface whose error projected onto the screen does not exceed \a max_pixel_error.
+\param distance distance of the nearest point of the bounding sphere from the camera.
+\param focal_length focal length of the camera in pixels (see Camera::focal_length).
+*/
+int SelectLod( const SurfaceDraw & draw, const float distance, const float focal_length, const float max_pixel_error = 1.0f );
+
+/*! \fn DrawRange MeshletRange( const SurfaceDraw & draw, const Meshlet & meshlet )
+\brief Part of the full detail draw range of the surface covering the triangles of one of its meshlets.
+*/
+DrawRange MeshletRange( const SurfaceDraw & draw, const Meshlet & meshlet );
+
+/*! \struct SceneBatch
+\brief Several surfaces converted to the GPU format, ready to be copied into the scene buffers by the render thread.
+*/
+struct SceneBatch
+{
+	std::vector<GLVertex> vertices; /*!< Vertices of all surfaces of the batch. */
+	size_t first_vertex{ 0 }; /*!< Position of the first vertex in the scene vertex buffer. */
+
+	std::vector<GLubyte> indices; /*!< 16-bit and 32-bit indices of all surfaces of the batch. */
+	size_t indices_offset{ 0 }; /*!< Byte offset of the indices in the scene index buffer. */
+
+	std::vector<SurfaceDraw> surface_draws; /*!< Draw calls of the surfaces, offsets are relative to the scene buffers. */
+	std::vector<Meshlet> meshlets; /*!< Meshlets of the surfaces of the batch, they follow the meshlets of the previous batches. */
+	int no_triangles{ 0 }; /*!< Number of full detail triangles of the batch. */
+};
+
+/*! \class SceneLoader
+\brief Loads the scene on a background thread and hands it over to the render thread in batches.
+
+LoadOBJ passes every surface over as soon as it is finished, the surfaces are laid out in the scene buffers in the order
+of their arrival and converted to batches of about batch_triangles triangles while the others are still being built.
+The render thread polls materials_loaded(), then takes batches by PopBatch() until finished(), the scene buffers grow
+with the batches. The textures of the materials are decoded once scene_loaded() returns true.
+*/
+class SceneLoader
+{
+public:
+	SceneLoader() { }
+	~SceneLoader();
+
+	/* starts loading of the OBJ file on the background thread */
+	void Start( const std::string & file_name, const int batch_triangles = 1 << 18 );
+
+	/* blocks until the background thread finishes */
+	void Join();
+
+	/* all materials are registered and available by materials(), their textures may still be decoding */
+	bool materials_loaded() const;
+
+	/* LoadOBJ has returned, the textures of the materials are decoded */
+	bool scene_loaded() const;
+
+	/* sizes of the scene buffers, valid once finished() */
+	size_t no_vertices() const;
+	size_t index_buffer_size() const;
+
+	std::vector<Material *> & materials();
+
+	/* time spent by LoadOBJ (s), valid once scene_loaded() */
+	double load_time() const;
+
+	/* time spent by the layout of the scene buffers and the preparation of the batches summed over all threads (s), valid once finished() */
+	double batch_time() const;
+
+	/* takes the oldest prepared batch, returns false if no batch is ready */
+	bool PopBatch( SceneBatch & batch );
+
+	/* all batches were prepared and taken */
+	bool finished();
+
+	/* moves the loaded surfaces and materials to the caller, valid once finished() */
+	void TakeScene( std::vector<Surface *> & surfaces, std::vector<Material *> & materials );
+
+private:
+	void Load( const std::string file_name );
+
+	/* called by the workers of LoadOBJ for each finished surface, the batch is prepared once enough triangles are pending */
+	void AddSurface( Surface * surface );
+
+	/* lays the surfaces out behind the previous ones, converts them and queues the batch */
+	void PrepareBatch( const std::vector<Surface *> & surfaces );
+
+	std::thread thread_;
+	int batch_triangles_{ 1 << 18 };
+
+	std::vector<Material *> materials_; // published by materials_loaded_
+	std::atomic<bool> materials_loaded_{ false };
+	std::atomic<bool> scene_loaded_{ false };
+	double load_time_{ 0.0 }; // published by scene_loaded_
+
+	std::mutex mutex_; // guards the members below
+	std::vector<Surface *> surfaces_; // in the order of the batches
+	std::vector<Surface *> pending_surfaces_; // finished surfaces waiting for a batch
+	int pending_triangles_{ 0 };
+	size_t no_vertices_{ 0 };
+	size_t index_buffer_size_{ 0 };
+	size_t no_face_vertices_{ 0 };
+	int no_meshlets_{ 0 };
+	double batch_time_{ 0.0 };
+	std::queue<SceneBatch> batches_;
+	bool all_batches_prepared_{ false };
+
+	SceneLoader( const SceneLoader & ) = delete;
+	SceneLoader & operator=( const SceneLoader & ) = delete;
+};
+
+#endif
@@ -0,0 +1,538 @@
+#include "pch.h"
+#include "simplify.h"
+#include "meshopt.h"
+
+static const double kBoundaryWeight = 10.0; // weight of the planes holding borders and seams relative to the area of the faces
+static const float kPassCostScale = 1.5f; // a pass applies collapses up to this multiple of the cost of the goal-th cheapest one
+static const int kMinLodTriangles = 64; // smaller levels are not simplified further
+static const float kMinLodReduction = 0.8f; // a level keeping more triangles of the previous one is not worth its draw range
+
+static const unsigned int kUnused = ~0u; // results of find_partner
+static const unsigned int kMissing = ~0u - 1;
+
+/* weighted sum of the squared distances from a set of planes, Q( p ) = p^T A p + 2 b^T p + c */
+struct Quadric
+{
+	double a00{ 0 }, a11{ 0 }, a22{ 0 }, a01{ 0 }, a02{ 0 }, a12{ 0 };
+	double b0{ 0 }, b1{ 0 }, b2{ 0 };
+	double c{ 0 };
+	double w{ 0 }; // sum of the weights of the planes
+
+	/* adds the plane n.p + d = 0 with the unit normal n */
+	void AddPlane( const Vector3 & n, const float d, const double weight )
+	{
+		a00 += weight * n.x * n.x; a11 += weight * n.y * n.y; a22 += weight * n.z * n.z;
+		a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a12 += weight * n.y * n.z;
+		b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	/* weighted mean of the squared distances of p from the planes */
+	double Error( const Vector3 & p ) const
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		const double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * ( a01 * x * y + a02 * x * z + a12 * y * z ) +
+			2.0 * ( b0 * x + b1 * y + b2 * z ) + c;
+
+		return ( w > 0.0 ) ? std::max( 0.0, e ) / w : 0.0;
+	}
+
+	void operator+=( const Quadric & q )
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+	}
+};
+
+/* collapse of the position from onto the position to */
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	float cost; // squared distance
+	int no_removed; // number of triangles sharing the edge
+};
+
+/* edge between two positions, a < b */
+struct Edge
+{
+	unsigned int a;
+	unsigned int b;
+	int no_triangles; // number of triangles sharing the edge
+};
+
+enum VertexKind : char
+{
+	kInterior, // may collapse along any edge
+	kBorder, // may collapse only along the border
+	kLocked // non-manifold or a corner of several borders
+};
+
+static unsigned long long EdgeKey( const unsigned int a, const unsigned int b )
+{
+	return ( static_cast<unsigned long long>( a ) << 32 ) | b;
+}
+
+/* triangles adjacent to the positions, adjacency[offsets[v]] to adjacency[offsets[v + 1] - 1] are the triangles touching the position v */
+static void BuildAdjacency( const std::vector<Triangle3ui> & triangles, const std::vector<unsigned int> & position,
+	std::vector<int> & offsets, std::vector<int> & adjacency )
+{
+	std::fill( offsets.begin(), offsets.end(), 0 );
+	for ( const Triangle3ui & t : triangles )
+	{
+		++offsets[position[t.v0] + 1]; ++offsets[position[t.v1] + 1]; ++offsets[position[t.v2] + 1];
+	}
+	for ( size_t v = 1; v < offsets.size(); ++v )
+	{
+		offsets[v] += offsets[v - 1];
+	}
+
+	adjacency.resize( triangles.size() * 3 );
+	std::vector<int> cursors( offsets.begin(), offsets.end() - 1 );
+	for ( size_t i = 0; i < triangles.size(); ++i )
+	{
+		const unsigned int * v = &triangles[i].v0;
+		for ( int k = 0; k < 3; ++k ) adjacency[cursors[position[v[k]]]++] = static_cast<int>( i );
+	}
+}
+
+/* distance of the point p from the triangle abc (Ericson, "Real-Time Collision Detection", 5.1.5) */
+static float PointTriangleDistance( const Vector3 & p, const Vector3 & a, const Vector3 & b, const Vector3 & c )
+{
+	const Vector3 ab = b - a;
+	const Vector3 ac = c - a;
+	const Vector3 ap = p - a;
+	const float d1 = ab.DotProduct( ap );
+	const float d2 = ac.DotProduct( ap );
+	if ( d1 <= 0.0f && d2 <= 0.0f ) return ap.L2Norm();
+
+	const Vector3 bp = p - b;
+	const float d3 = ab.DotProduct( bp );
+	const float d4 = ac.DotProduct( bp );
+	if ( d3 >= 0.0f && d4 <= d3 ) return bp.L2Norm();
+
+	const float vc = d1 * d4 - d3 * d2;
+	if ( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f ) return ( p - ( a + ab * ( d1 / ( d1 - d3 ) ) ) ).L2Norm();
+
+	const Vector3 cp = p - c;
+	const float d5 = ab.DotProduct( cp );
+	const float d6 = ac.DotProduct( cp );
+	if ( d6 >= 0.0f && d5 <= d6 ) return cp.L2Norm();
+
+	const float vb = d5 * d2 - d1 * d6;
+	if ( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f ) return ( p - ( a + ac * ( d2 / ( d2 - d6 ) ) ) ).L2Norm();
+
+	const float va = d3 * d6 - d5 * d4;
+	if ( va <= 0.0f && ( d4 - d3 ) >= 0.0f && ( d5 - d6 ) >= 0.0f )
+	{
+		return ( p - ( b + ( c - b ) * ( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) ) ) ).L2Norm();
+	}
+
+	const float denominator = va + vb + vc;
+	if ( denominator <= 0.0f ) return ap.L2Norm(); // degenerate triangle
+
+	return ( p - ( a + ab * ( vb / denominator ) + ac * ( vc / denominator ) ) ).L2Norm();
+}
+
+/* vertices with the same position form circular lists, the first one in the sorted order represents the position */
+static void WeldPositions( const Vertex * vertices, const int no_vertices, std::vector<unsigned int> & position,
+	std::vector<unsigned int> & next_wedge )
+{
+	std::vector<unsigned int> order( no_vertices );
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		order[v] = v;
+	}
+
+	auto less = [vertices]( const unsigned int a, const unsigned int b )
+	{
+		const Vector3 & p = vertices[a].position;
+		const Vector3 & q = vertices[b].position;
+		if ( p.x != q.x ) return p.x < q.x;
+		if ( p.y != q.y ) return p.y < q.y;
+		return p.z < q.z;
+	};
+	std::sort( order.begin(), order.end(), less );
+
+	position.resize( no_vertices );
+	next_wedge.resize( no_vertices );
+
+	for ( int i = 0; i < no_vertices; )
+	{
+		int j = i + 1;
+		while ( j < no_vertices && !less( order[i], order[j] ) ) ++j;
+
+		for ( int k = i; k < j; ++k )
+		{
+			position[order[k]] = order[i];
+			next_wedge[order[k]] = order[( k + 1 < j ) ? k + 1 : i];
+		}
+
+		i = j;
+	}
+}
+
+std::vector<Triangle3ui> SimplifyMesh( const Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices,
+	const int target_no_triangles, const float max_error, float * result_error )
+{
+	std::vector<unsigned int> position, next_wedge;
+	WeldPositions( vertices, no_vertices, position, next_wedge );
+
+	auto p = [vertices]( const unsigned int v ) -> const Vector3 & { return vertices[v].position; };
+
+	// triangles with two corners at the same position are invisible and break the adjacency
+	auto degenerate = [&position]( const Triangle3ui & t )
+	{
+		return position[t.v0] == position[t.v1] || position[t.v1] == position[t.v2] || position[t.v2] == position[t.v0];
+	};
+
+	std::vector<Triangle3ui> triangles;
+	triangles.reserve( no_triangles );
+	std::copy_if( indices, indices + no_triangles, std::back_inserter( triangles ), [&]( const Triangle3ui & t ) { return !degenerate( t ); } );
+
+	// --- quadrics of the face planes and of the planes perpendicular to borders and seams ---
+	std::vector<Quadric> quadrics( no_vertices ); // only the entries of the representatives of the positions are used
+	{
+		// an edge without its opposite in the index space lies on a border or on a seam between different attributes
+		std::vector<unsigned long long> directed_edges;
+		directed_edges.reserve( triangles.size() * 3 );
+		for ( const Triangle3ui & t : triangles )
+		{
+			const unsigned int * v = &t.v0;
+			for ( int k = 0; k < 3; ++k ) directed_edges.push_back( EdgeKey( v[k], v[( k + 1 ) % 3] ) );
+		}
+		std::sort( directed_edges.begin(), directed_edges.end() );
+
+		for ( const Triangle3ui & t : triangles )
+		{
+			const unsigned int * v = &t.v0;
+			Vector3 n = ( p( v[1] ) - p( v[0] ) ).CrossProduct( p( v[2] ) - p( v[0] ) );
+			const float double_area = n.Normalize();
+			if ( double_area == 0.0f ) continue;
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				quadrics[position[v[k]]].AddPlane( n, -n.DotProduct( p( v[0] ) ), 0.5 * double_area );
+			}
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				const unsigned int a = v[k];
+				const unsigned int b = v[( k + 1 ) % 3];
+				if ( std::binary_search( directed_edges.begin(), directed_edges.end(), EdgeKey( b, a ) ) ) continue;
+
+				const Vector3 e = p( b ) - p( a );
+				Vector3 m = e.CrossProduct( n );
+				m.Normalize();
+				const double weight = kBoundaryWeight * e.SqrL2Norm();
+				quadrics[position[a]].AddPlane( m, -m.DotProduct( p( a ) ), weight );
+				quadrics[position[b]].AddPlane( m, -m.DotProduct( p( a ) ), weight );
+			}
+		}
+	}
+
+	const float max_cost = ( max_error < FLT_MAX ) ? max_error * max_error : FLT_MAX;
+
+	std::vector<unsigned int> collapsed_to( no_vertices ); // position the position was collapsed onto
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		collapsed_to[v] = v;
+	}
+
+	std::vector<unsigned int> remap( no_vertices );
+	std::vector<int> offsets( no_vertices + 1 );
+	std::vector<int> adjacency;
+	std::vector<int> open_edges( no_vertices );
+	std::vector<VertexKind> kind( no_vertices );
+	std::vector<char> locked( no_vertices );
+	std::vector<Edge> edges;
+	std::vector<size_t> edge_of( no_vertices ); // last edge from the currently processed position to the position
+	std::vector<Collapse> collapses;
+
+	while ( static_cast<int>( triangles.size() ) > target_no_triangles )
+	{
+		const int no_current = static_cast<int>( triangles.size() );
+
+		BuildAdjacency( triangles, position, offsets, adjacency );
+
+		// --- edges between the positions gathered from the smaller end point, borders and non-manifold vertices ---
+		edges.clear();
+		for ( int a = 0; a < no_vertices; ++a )
+		{
+			const size_t first_edge = edges.size();
+			for ( int i = offsets[a]; i < offsets[a + 1]; ++i )
+			{
+				const unsigned int * v = &triangles[adjacency[i]].v0;
+				for ( int k = 0; k < 3; ++k )
+				{
+					const unsigned int b = position[v[k]];
+					if ( b <= static_cast<unsigned int>( a ) ) continue;
+
+					if ( edge_of[b] < first_edge || edge_of[b] >= edges.size() || edges[edge_of[b]].b != b )
+					{
+						edge_of[b] = edges.size();
+						edges.push_back( Edge{ static_cast<unsigned int>( a ), b, 0 } );
+					}
+					++edges[edge_of[b]].no_triangles;
+				}
+			}
+		}
+
+		std::fill( open_edges.begin(), open_edges.end(), 0 );
+		std::fill( kind.begin(), kind.end(), kInterior );
+		for ( const Edge & edge : edges )
+		{
+			if ( edge.no_triangles == 1 )
+			{
+				++open_edges[edge.a];
+				++open_edges[edge.b];
+			}
+			else if ( edge.no_triangles > 2 )
+			{
+				kind[edge.a] = kind[edge.b] = kLocked;
+			}
+		}
+		for ( int v = 0; v < no_vertices; ++v )
+		{
+			if ( kind[v] == kInterior && open_edges[v] > 0 ) kind[v] = ( open_edges[v] == 2 ) ? kBorder : kLocked;
+		}
+
+		// vertex of the position to sharing an edge with the vertex a, all such edges must lead to the same vertex
+		auto find_partner = [&]( const unsigned int a, const unsigned int to )
+		{
+			unsigned int partner = kUnused;
+			for ( int i = offsets[position[a]]; i < offsets[position[a] + 1]; ++i )
+			{
+				const unsigned int * v = &triangles[adjacency[i]].v0;
+				for ( int k = 0; k < 3; ++k )
+				{
+					if ( v[k] != a ) continue;
+
+					if ( partner == kUnused ) partner = kMissing;
+					for ( int o = 1; o < 3; ++o )
+					{
+						const unsigned int b = v[( k + o ) % 3];
+						if ( position[b] != to ) continue;
+						if ( partner != kMissing && partner != b ) return kMissing;
+						partner = b;
+					}
+				}
+			}
+
+			return partner;
+		};
+
+		auto allowed = [&]( const unsigned int from, const bool open )
+		{
+			return kind[from] == kInterior || ( kind[from] == kBorder && open );
+		};
+
+		// every vertex at the position from must follow an edge to the position to, so that seams are collapsed along themselves,
+		// positions of a single vertex always can
+		auto seam_aligned = [&]( const unsigned int from, const unsigned int to )
+		{
+			if ( next_wedge[from] == from && next_wedge[to] == to ) return true;
+
+			unsigned int a = from;
+			do
+			{
+				if ( find_partner( a, to ) == kMissing ) return false;
+				a = next_wedge[a];
+			} while ( a != from );
+
+			return true;
+		};
+
+		// --- the cheaper allowed direction of every edge ---
+		collapses.clear();
+		for ( const Edge & edge : edges )
+		{
+			const bool open = ( edge.no_triangles == 1 );
+			const float cost_ab = allowed( edge.a, open ) ? static_cast<float>( quadrics[edge.a].Error( p( edge.b ) ) ) : FLT_MAX;
+			const float cost_ba = allowed( edge.b, open ) ? static_cast<float>( quadrics[edge.b].Error( p( edge.a ) ) ) : FLT_MAX;
+
+			if ( cost_ab == FLT_MAX && cost_ba == FLT_MAX ) continue;
+
+			Collapse collapse{ edge.a, edge.b, cost_ab, edge.no_triangles };
+			if ( cost_ba < cost_ab ) collapse = Collapse{ edge.b, edge.a, cost_ba, edge.no_triangles };
+
+			// the seams are checked only for the chosen direction, it is the expensive part
+			if ( !seam_aligned( collapse.from, collapse.to ) )
+			{
+				const float other_cost = ( collapse.from == edge.a ) ? cost_ba : cost_ab;
+				if ( other_cost == FLT_MAX ) continue;
+				collapse = Collapse{ collapse.to, collapse.from, other_cost, edge.no_triangles };
+				if ( !seam_aligned( collapse.from, collapse.to ) ) continue;
+			}
+			if ( collapse.cost <= max_cost ) collapses.push_back( collapse );
+		}
+
+		if ( collapses.empty() ) break;
+
+		// --- independent collapses in the order of their cost ---
+		const int no_needed = no_current - target_no_triangles;
+		const size_t goal = std::min( collapses.size(), static_cast<size_t>( std::max( 1, no_needed / 2 ) ) ); // interior collapses remove two triangles
+
+		// only the collapses cheap enough for this pass are sorted, the rest is needed only if none of them applies
+		auto cheaper = []( const Collapse & a, const Collapse & b ) { return a.cost < b.cost; };
+		std::nth_element( collapses.begin(), collapses.begin() + ( goal - 1 ), collapses.end(), cheaper );
+		const float pass_cost = collapses[goal - 1].cost * kPassCostScale;
+		const size_t no_cheap = std::partition( collapses.begin() + goal, collapses.end(),
+			[pass_cost]( const Collapse & c ) { return c.cost <= pass_cost; } ) - collapses.begin();
+		std::sort( collapses.begin(), collapses.begin() + no_cheap, cheaper );
+
+		for ( int v = 0; v < no_vertices; ++v )
+		{
+			remap[v] = v;
+		}
+		std::fill( locked.begin(), locked.end(), 0 );
+		int no_removed = 0;
+
+		for ( size_t c = 0; c < collapses.size() && no_removed < no_needed; ++c )
+		{
+			if ( c == no_cheap )
+			{
+				if ( no_removed > 0 ) break;
+				std::sort( collapses.begin() + c, collapses.end(), cheaper );
+			}
+
+			const Collapse & collapse = collapses[c];
+
+			const unsigned int from = collapse.from;
+			const unsigned int to = collapse.to;
+			if ( locked[from] || locked[to] ) continue;
+
+			// the remaining triangles around from must not turn over
+			bool flips = false;
+			for ( int i = offsets[from]; i < offsets[from + 1] && !flips; ++i )
+			{
+				const unsigned int * v = &triangles[adjacency[i]].v0;
+				const unsigned int q[3] = { position[v[0]], position[v[1]], position[v[2]] };
+				if ( q[0] == to || q[1] == to || q[2] == to ) continue;
+
+				const Vector3 n0 = ( p( q[1] ) - p( q[0] ) ).CrossProduct( p( q[2] ) - p( q[0] ) );
+				const Vector3 & r0 = p( ( q[0] == from ) ? to : q[0] );
+				const Vector3 & r1 = p( ( q[1] == from ) ? to : q[1] );
+				const Vector3 & r2 = p( ( q[2] == from ) ? to : q[2] );
+				const Vector3 n1 = ( r1 - r0 ).CrossProduct( r2 - r0 );
+				flips = n0.DotProduct( n1 ) <= 0.0f;
+			}
+			if ( flips ) continue;
+
+			unsigned int a = from;
+			do
+			{
+				const unsigned int partner = find_partner( a, to );
+				if ( partner != kUnused ) remap[a] = partner;
+				a = next_wedge[a];
+			} while ( a != from );
+
+			quadrics[to] += quadrics[from];
+			collapsed_to[from] = to;
+
+			locked[from] = locked[to] = 1;
+			for ( int i = offsets[from]; i < offsets[from + 1]; ++i )
+			{
+				const Triangle3ui & t = triangles[adjacency[i]];
+				locked[position[t.v0]] = locked[position[t.v1]] = locked[position[t.v2]] = 1;
+			}
+
+			no_removed += collapse.no_removed;
+		}
+
+		if ( no_removed == 0 ) break;
+
+		size_t no_kept = 0;
+		for ( const Triangle3ui & t : triangles )
+		{
+			const Triangle3ui r = { remap[t.v0], remap[t.v1], remap[t.v2] };
+			if ( !degenerate( r ) ) triangles[no_kept++] = r;
+		}
+		triangles.resize( no_kept );
+	}
+
+	// the quadrics measure mean distances, the error is the largest distance of a removed position
+	// from the triangles within two edges of the position it ended in, which bounds the deviation much tighter
+	if ( result_error )
+	{
+		BuildAdjacency( triangles, position, offsets, adjacency );
+
+		float error = 0.0f;
+		std::vector<unsigned int> visited( no_vertices, kUnused ); // removed position which visited the neighbour last
+		for ( int v = 0; v < no_vertices; ++v )
+		{
+			if ( collapsed_to[v] == static_cast<unsigned int>( v ) ) continue;
+
+			unsigned int r = collapsed_to[v];
+			while ( collapsed_to[r] != r ) r = collapsed_to[r];
+
+			// only positions which may raise the error need the closest triangle
+			auto deviation = [&]()
+			{
+				float distance = FLT_MAX;
+				for ( int i = offsets[r]; i < offsets[r + 1]; ++i )
+				{
+					const unsigned int * q = &triangles[adjacency[i]].v0;
+					for ( int k = 0; k < 3; ++k )
+					{
+						const unsigned int neighbour = position[q[k]];
+						if ( visited[neighbour] == static_cast<unsigned int>( v ) ) continue;
+						visited[neighbour] = v;
+
+						for ( int j = offsets[neighbour]; j < offsets[neighbour + 1]; ++j )
+						{
+							const Triangle3ui & t = triangles[adjacency[j]];
+							distance = std::min( distance, PointTriangleDistance( p( v ), p( t.v0 ), p( t.v1 ), p( t.v2 ) ) );
+							if ( distance <= error ) return distance;
+						}
+					}
+				}
+
+				return distance;
+			};
+
+			float distance = deviation();
+			if ( distance == FLT_MAX )
+			{
+				distance = ( p( v ) - p( r ) ).L2Norm(); // all triangles around shrank to nothing
+			}
+			error = std::max( error, distance );
+		}
+
+		*result_error = error;
+	}
+
+	return triangles;
+}
+
+void GenerateLods( Surface * surface, const int no_lods, const float reduction )
+{
+	const Triangle3ui * indices = surface->get_indices();
+	int no_triangles = surface->no_triangles();
+	float error = 0.0f;
+
+	for ( int i = 0; i < no_lods && no_triangles >= kMinLodTriangles; ++i )
+	{
+		float lod_error = 0.0f;
+		SurfaceLod lod;
+		lod.indices = SimplifyMesh( indices, no_triangles, surface->get_vertices(), surface->no_vertices(),
+			static_cast<int>( no_triangles * reduction ), FLT_MAX, &lod_error );
+
+		if ( lod.indices.empty() || lod.indices.size() > no_triangles * kMinLodReduction )
+		{
+			break;
+		}
+
+		// the errors of the successive simplifications add up
+		error += lod_error;
+		lod.error = error;
+		OptimizeVertexCache( lod.indices.data(), static_cast<int>( lod.indices.size() ), surface->no_vertices() );
+		surface->add_lod( std::move( lod ) );
+
+		indices = surface->get_lod( i ).indices.data();
+		no_triangles = static_cast<int>( surface->get_lod( i ).indices.size() );
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef SIMPLIFY_H_
+#define SIMPLIFY_H_
+
+#include <float.h>
+
+#include "surface.h"
+
+/*
+Quadric error mesh simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+
+Edges are collapsed onto one of their end points, so the simplified triangles index the vertex pool of the original
+surface and all levels of detail share a single vertex buffer. Vertices with the same position and different
+attributes (texture seams, creases) are collapsed together along the seam only, borders and seams are kept in place
+by additional planes perpendicular to them. Collapses are applied in passes of independent edges sorted by their cost,
+collapses flipping a triangle or touching non-manifold vertices are rejected.
+*/
+
+/*! \fn std::vector<Triangle3ui> SimplifyMesh( const Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices, const int target_no_triangles, const float max_error, float * result_error )
+\brief Collapses edges of the mesh until it has at most \a target_no_triangles triangles or no collapse within \a max_error remains.
+\param max_error maximal deviation from the input mesh in object space units.
+\param result_error if not null, receives the largest distance of a removed vertex from the triangles around the vertex it was collapsed onto.
+\return Triangles of the simplified mesh indexing the same \a vertices.
+*/
+std::vector<Triangle3ui> SimplifyMesh( const Triangle3ui * indices, const int no_triangles, const Vertex * vertices, const int no_vertices,
+	const int target_no_triangles, const float max_error = FLT_MAX, float * result_error = nullptr );
+
+/*! \fn void GenerateLods( Surface * surface, const int no_lods, const float reduction = 0.25f )
+\brief Appends up to \a no_lods simplified levels of detail to the surface, each one is simplified from the previous level.
+Levels are no longer added once the surface is too small or the simplification stalls, their indices are optimized
+for the vertex cache.
+\param reduction ratio of the number of triangles of the successive levels.
+*/
+void GenerateLods( Surface * surface, const int no_lods, const float reduction = 0.25f );
+
+#endif
@@ -1,60 +1,108 @@
 #include "pch.h"
 #include "surface.h"
+#include "mymath.h"
+
+// vertices are welded when all attributes up to the padding (i.e. including the tangent) are bitwise equal,
+// the hash covers only the attributes read from OBJ files
+static const size_t kWeldCompareSize = offsetof( Vertex, pad );
+static const size_t kWeldHashSize = offsetof( Vertex, tangent );
 
 Surface * BuildSurface( const std::string & name, std::vector<Vertex> & face_vertices )
 {
-	const int no_vertices = static_cast< int >( face_vertices.size() );
+	const int no_face_vertices = static_cast< int >( face_vertices.size() );
 
-	assert( ( no_vertices > 0 ) && ( no_vertices % 3 == 0 ) );
+	assert( ( no_face_vertices > 0 ) && ( no_face_vertices % 3 == 0 ) );
 
-	const int no_triangles = no_vertices / 3;
+	const int no_triangles = no_face_vertices / 3;
 
-	Surface * surface = new Surface( name, no_triangles );
+	// open addressing hash table of indices into the pool of unique vertices, at most half full
+	size_t table_size = 1;
+	while ( table_size < 2 * face_vertices.size() ) table_size <<= 1;
+	std::vector<int> table( table_size, -1 );
 
-	// koprovn dat
-	for ( int i = 0; i < no_triangles; ++i )
-	{		
-		surface->get_triangles()[i] = Triangle( face_vertices[i * 3],
-			face_vertices[i * 3 + 1], face_vertices[i * 3 + 2], surface );
+	std::vector<Vertex> vertices;
+	vertices.reserve( face_vertices.size() );
+	std::vector<unsigned int> indices( face_vertices.size() );
+
+	for ( int i = 0; i < no_face_vertices; ++i )
+	{
+		const Vertex & vertex = face_vertices[i];
+		size_t slot = QuickHash( reinterpret_cast<const BYTE *>( &vertex ), kWeldHashSize ) & ( table_size - 1 );
+
+		while ( table[slot] >= 0 && memcmp( &vertices[table[slot]], &vertex, kWeldCompareSize ) != 0 )
+		{
+			slot = ( slot + 1 ) & ( table_size - 1 );
+		}
+
+		if ( table[slot] < 0 )
+		{
+			table[slot] = static_cast<int>( vertices.size() );
+			vertices.push_back( vertex );
+		}
+
+		indices[i] = static_cast<unsigned int>( table[slot] );
 	}
 
+	Surface * surface = new Surface( name, static_cast<int>( vertices.size() ), no_triangles );
+
+	// koprovn dat
+	std::copy( vertices.begin(), vertices.end(), surface->get_vertices() );
+	memcpy( surface->get_indices(), indices.data(), sizeof( Triangle3ui ) * no_triangles );
+
 	return surface;
 }
 
 Surface::Surface()
 {
 	n_ = 0;
-	triangles_ = NULL;
+	indices_ = NULL;
 }
 
-Surface::Surface( const std::string & name, const int n )
+Surface::Surface( const std::string & name, const int no_vertices, const int no_triangles )
 {
-	assert( n > 0 );
+	assert( ( no_vertices > 0 ) && ( no_triangles > 0 ) );
 
 	name_ = name;
 
-	n_ = n;
-	triangles_ = new Triangle[n_];
+	n_ = no_triangles;
+	indices_ = new Triangle3ui[n_];
+
+	no_vertices_ = no_vertices;
+	vertices_ = new Vertex[no_vertices_];
 }
 
 Surface::~Surface()
 {
-	if ( triangles_ )
+	if ( indices_ )
 	{
-		delete[] triangles_;
-		triangles_ = nullptr;
+		delete[] indices_;
+		indices_ = nullptr;
 	}
 	n_ = 0;
+
+	if ( vertices_ )
+	{
+		delete[] vertices_;
+		vertices_ = nullptr;
+	}
+	no_vertices_ = 0;
+}
+
+Triangle Surface::get_triangle( const int i )
+{
+	const Triangle3ui & triangle = indices_[i];
+
+	return Triangle( vertices_[triangle.v0], vertices_[triangle.v1], vertices_[triangle.v2], this );
 }
 
-Triangle & Surface::get_triangle( const int i )
+Vertex * Surface::get_vertices()
 {
-	return triangles_[i];
+	return vertices_;
 }
 
-Triangle * Surface::get_triangles()
+Triangle3ui * Surface::get_indices()
 {
-	return triangles_;
+	return indices_;
 }
 
 std::string Surface::get_name()
@@ -69,7 +117,7 @@ int Surface::no_triangles()
 
 int Surface::no_vertices()
 {
-	return 3 * n_;
+	return no_vertices_;
 }
 
 void Surface::set_material( Material * material )
@@ -81,3 +129,48 @@ Material * Surface::get_material() const
 {
 	return material_;
 }
+
+int Surface::no_lods() const
+{
+	return static_cast<int>( lods_.size() );
+}
+
+SurfaceLod & Surface::get_lod( const int i )
+{
+	return lods_[i];
+}
+
+void Surface::add_lod( SurfaceLod lod )
+{
+	assert( no_lods() + 1 < MAX_LODS );
+
+	lods_.push_back( std::move( lod ) );
+}
+
+SurfaceMeshlets & Surface::get_meshlets()
+{
+	return meshlets_;
+}
+
+void BoundingBox( Surface * surface, Vector3 & lower, Vector3 & upper )
+{
+	const Vertex * vertices = surface->get_vertices();
+	lower = vertices[0].position;
+	upper = vertices[0].position;
+
+	for ( int i = 1; i < surface->no_vertices(); ++i )
+	{
+		const Vector3 & p = vertices[i].position;
+		lower = Vector3( std::min( lower.x, p.x ), std::min( lower.y, p.y ), std::min( lower.z, p.z ) );
+		upper = Vector3( std::max( upper.x, p.x ), std::max( upper.y, p.y ), std::max( upper.z, p.z ) );
+	}
+}
+
+void BoundingSphere( Surface * surface, Vector3 & center, float & radius )
+{
+	Vector3 lower, upper;
+	BoundingBox( surface, lower, upper );
+
+	center = ( lower + upper ) * 0.5f;
+	radius = ( upper - lower ).L2Norm() * 0.5f;
+}
@@ -5,6 +5,50 @@
 #include "material.h"
 #include "triangle.h"
 
+#define MAX_LODS 5 // levels of detail of a surface including the full detail one
+
+/*! \struct SurfaceLod
+\brief Simplified level of detail of a surface, its triangles index the vertices of the surface.
+*/
+struct SurfaceLod
+{
+	std::vector<Triangle3ui> indices; /*!< Vertex indices of the triangles of the level. */
+	float error{ 0.0f }; /*!< Estimated deviation from the full detail surface in object space units. */
+};
+
+#define MAX_MESHLET_VERTICES 64 // local indices of the meshlet vertices fit into 8 bits
+#define MAX_MESHLET_TRIANGLES 124
+
+/*! \struct Meshlet
+\brief Cluster of adjacent triangles of a surface with bounds for culling.
+All triangles of the meshlet face away from the camera at \f$\mathbf{e}\f$ if
+\f$\frac{\mathbf{a}-\mathbf{e}}{\|\mathbf{a}-\mathbf{e}\|}\cdot\mathbf{n}\geq c\f$,
+where \f$\mathbf{a}\f$ is cone_apex, \f$\mathbf{n}\f$ cone_axis and \f$c\f$ cone_cutoff.
+*/
+struct Meshlet
+{
+	unsigned int vertex_offset{ 0 }; /*!< Position of the first vertex of the meshlet in SurfaceMeshlets::vertices. */
+	unsigned int triangle_offset{ 0 }; /*!< Position of the first triangle of the meshlet in the indices of the surface. */
+	unsigned char no_vertices{ 0 }; /*!< Number of vertices of the meshlet. */
+	unsigned char no_triangles{ 0 }; /*!< Number of triangles of the meshlet. */
+	Vector3 center; /*!< Center of the bounding sphere in object space. */
+	float radius{ 0.0f }; /*!< Radius of the bounding sphere. */
+	Vector3 cone_apex; /*!< Apex of the cone containing the normals of all triangles. */
+	Vector3 cone_axis; /*!< Unit axis of the normal cone. */
+	float cone_cutoff{ 1.0f }; /*!< Sine of the half angle of the normal cone, 1 if the meshlet cannot be back-face culled. */
+};
+
+/*! \struct SurfaceMeshlets
+\brief Decomposition of a surface into meshlets, the triangles of the surface are stored in the meshlet order.
+*/
+struct SurfaceMeshlets
+{
+	std::vector<Meshlet> meshlets; /*!< Meshlets covering all triangles of the surface in their order. */
+	std::vector<unsigned int> vertices; /*!< Indices of the vertices of the surface referenced by the meshlets. */
+	std::vector<unsigned char> triangles; /*!< Three local indices into the vertices of the meshlet for each triangle of the surface. */
+	bool closed{ false }; /*!< Every edge joins two triangles of opposite orientation and the normals point outwards, so the back faces are hidden from outside. */
+};
+
 /*! \class Surface
 \brief A class representing a triangular mesh.
 
@@ -26,9 +70,10 @@ public:
 	Inicializuje vertex podle zadanch hodnot parametr.
 
 	\param name nzev plochy.
-	\param n poet trojhelnk tvocch s.
+	\param no_vertices number of unique vertices of the mesh.
+	\param no_triangles poet trojhelnk tvocch s.
 	*/
-	Surface( const std::string & name, const int n );
+	Surface( const std::string & name, const int no_vertices, const int no_triangles );
 
 	//! Destruktor.
 	/*!
@@ -38,16 +83,24 @@ public:
 
 	//! Vrt poadovan trojhelnk.
 	/*!
+	The triangle is assembled from the vertices shared by the whole mesh, hence it is returned by value.
+
 	\param i index trojhelnka.
 	\return Trojhelnk.
 	*/
-	Triangle & get_triangle( const int i );
+	Triangle get_triangle( const int i );
 
-	//! Vrt pole vech trojhelnk.
+	//! Returns the pool of unique vertices of the mesh.
 	/*!	
-	\return Pole vech trojhelnk.
+	\return Array of no_vertices() vertices.
 	*/
-	Triangle * get_triangles();
+	Vertex * get_vertices();
+
+	//! Returns vertex indices of all triangles.
+	/*!	
+	\return Array of no_triangles() index triplets pointing to get_vertices().
+	*/
+	Triangle3ui * get_indices();
 
 	//! Vrt nzev plochy.
 	/*!	
@@ -61,9 +114,9 @@ public:
 	*/
 	int no_triangles();
 
-	//! Vrt poet vech vrchol v sti.
+	//! Returns the number of unique vertices of the mesh.
 	/*!	
-	\return Poet vech vrchol v sti.
+	\return Number of unique vertices of the mesh.
 	*/
 	int no_vertices();	
 
@@ -85,23 +138,66 @@ public:
 	*/
 	Material * get_material() const;
 
+	//! Returns the number of simplified levels of detail.
+	/*!
+	\return Number of levels of detail not counting the full detail surface.
+	*/
+	int no_lods() const;
+
+	//! Returns the simplified level of detail.
+	/*!
+	\param i index of the level, the level i is drawn instead of the full detail surface as level i + 1.
+	\return Level of detail.
+	*/
+	SurfaceLod & get_lod( const int i );
+
+	//! Appends a coarser level of detail.
+	/*!
+	\param lod level of detail sharing the vertices of the surface.
+	*/
+	void add_lod( SurfaceLod lod );
+
+	//! Returns the meshlets of the full detail surface.
+	/*!
+	\return Meshlets, empty if the surface was not decomposed.
+	*/
+	SurfaceMeshlets & get_meshlets();
+
 protected:
 
 private:
 	int n_{ 0 }; /*!< Poet trojhelnk v sti. */
-	Triangle * triangles_{ nullptr }; /*!< Trojhelnkov s. */
+	Triangle3ui * indices_{ nullptr }; /*!< Vertex indices of individual triangles. */
+
+	int no_vertices_{ 0 }; /*!< Number of unique vertices of the mesh. */
+	Vertex * vertices_{ nullptr }; /*!< Vertices shared by triangles of the mesh. */
 
 	std::string name_{ "unknown" }; /*!< Nzev plochy. */
 
 	//Matrix4x4 transformation_; /*!< Transforman matice pro pechod z modelovho do svtovho souadnho systmu. */
 	Material * material_{ nullptr }; /*!< Materil plochy. */
+
+	std::vector<SurfaceLod> lods_; /*!< Simplified levels of detail from the finest to the coarsest. */
+
+	SurfaceMeshlets meshlets_; /*!< Clusters of the triangles for culling. */
 };
 
 /*! \fn Surface * BuildSurface( const std::string & name, std::vector<Vertex> & face_vertices )
 \brief Sestaven plochy z pole trojic vrchol.
+Vertices with the same position, normal, color and texture coordinates are welded into one.
 \param name nzev plochy.
 \param face_vertices pole trojic vrchol.
 */
 Surface * BuildSurface( const std::string & name, std::vector<Vertex> & face_vertices );
 
+/*! \fn void BoundingBox( Surface * surface, Vector3 & lower, Vector3 & upper )
+\brief Axis aligned bounding box of the vertices of the surface.
+*/
+void BoundingBox( Surface * surface, Vector3 & lower, Vector3 & upper );
+
+/*! \fn void BoundingSphere( Surface * surface, Vector3 & center, float & radius )
+\brief Sphere around the axis aligned bounding box of the vertices of the surface.
+*/
+void BoundingSphere( Surface * surface, Vector3 & center, float & radius );
+
 #endif
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "tangents.h"
+#include "mymath.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <memory>
+
+/* projection of v onto the plane perpendicular to the unit vector n */
+static Vector3 Project( const Vector3 & v, const Vector3 & n )
+{
+	return v - n * n.DotProduct( v );
+}
+
+/* arbitrary unit vector perpendicular to the unit vector n */
+static Vector3 Perpendicular( const Vector3 & n )
+{
+	Vector3 t = ( fabsf( n.x ) < 0.9f ) ? Vector3( 1.0f, 0.0f, 0.0f ).CrossProduct( n ) : Vector3( 0.0f, 1.0f, 0.0f ).CrossProduct( n );
+
+	return ( t.Normalize() > 0.0f ) ? t : Vector3( 1.0f, 0.0f, 0.0f );
+}
+
+void GenerateTangents( Surface * surface, std::vector<Vertex> & face_vertices, ThreadPool & thread_pool )
+{
+	const int no_vertices = surface->no_vertices();
+	const int no_triangles = surface->no_triangles();
+	const size_t no_corners = size_t( no_triangles ) * 3;
+	const Vertex * vertices = surface->get_vertices();
+	const Triangle3ui * triangles = surface->get_indices();
+	const size_t block_size = 1 << 14;
+
+	assert( face_vertices.size() == no_corners );
+
+	auto vertex_index = [triangles]( const size_t corner )
+	{
+		return ( &triangles[corner / 3].v0 )[corner % 3];
+	};
+
+	// --- weighted tangents of the corners ---
+	std::vector<Vector3> corner_tangents( no_corners );
+	std::vector<unsigned char> orientations( no_triangles ); // 1 for the positive orientation (bitangent sign +1)
+	std::vector<unsigned char> degenerate( no_triangles );
+
+	thread_pool.ParallelForBlocks( no_triangles, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t t = first; t < last; ++t )
+		{
+			const unsigned int * index = &triangles[t].v0;
+			const Vector3 & p0 = vertices[index[0]].position;
+			const Coord2f & uv0 = vertices[index[0]].texture_coords[0];
+			const Vector3 d1 = vertices[index[1]].position - p0;
+			const Vector3 d2 = vertices[index[2]].position - p0;
+			const float s1 = vertices[index[1]].texture_coords[0].u - uv0.u, t1 = vertices[index[1]].texture_coords[0].v - uv0.v;
+			const float s2 = vertices[index[2]].texture_coords[0].u - uv0.u, t2 = vertices[index[2]].texture_coords[0].v - uv0.v;
+
+			// direction of increasing s, scaled by the sign of the area so that it points the same way for mirrored triangles
+			const float signed_area = s1 * t2 - t1 * s2;
+			Vector3 os = d1 * t2 - d2 * t1;
+			orientations[t] = signed_area > 0.0f;
+			degenerate[t] = fabsf( signed_area ) <= FLT_MIN || os.Normalize() <= FLT_MIN;
+
+			if ( degenerate[t] )
+			{
+				continue;
+			}
+
+			if ( !orientations[t] )
+			{
+				os = -os;
+			}
+
+			// angle weights are measured in the tangent plane of each vertex as in MikkTSpace
+			for ( int k = 0; k < 3; ++k )
+			{
+				const Vertex & v = vertices[index[k]];
+				Vector3 e1 = Project( vertices[index[( k + 1 ) % 3]].position - v.position, v.normal );
+				Vector3 e2 = Project( vertices[index[( k + 2 ) % 3]].position - v.position, v.normal );
+				Vector3 tangent = Project( os, v.normal );
+
+				if ( e1.Normalize() > 0.0f && e2.Normalize() > 0.0f && tangent.Normalize() > 0.0f )
+				{
+					const float angle = acosf( clamp( e1.DotProduct( e2 ), -1.0f, 1.0f ) );
+					corner_tangents[3 * t + k] = tangent * angle;
+				}
+			}
+		}
+	}, block_size );
+
+	// --- corners around each vertex (compressed rows), the slots are taken by atomic increments ---
+	std::unique_ptr<std::atomic<int>[]> counters( new std::atomic<int>[no_vertices + 1]() );
+
+	thread_pool.ParallelForBlocks( no_corners, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t c = first; c < last; ++c )
+		{
+			counters[vertex_index( c )].fetch_add( 1, std::memory_order_relaxed );
+		}
+	} );
+
+	std::vector<int> offsets( no_vertices + 1 );
+	int no_adjacent_corners = 0;
+	for ( int v = 0; v < no_vertices; ++v )
+	{
+		offsets[v] = no_adjacent_corners;
+		no_adjacent_corners += counters[v].load( std::memory_order_relaxed );
+		counters[v].store( offsets[v], std::memory_order_relaxed );
+	}
+	offsets[no_vertices] = no_adjacent_corners;
+
+	std::vector<int> adjacent_corners( no_adjacent_corners );
+
+	thread_pool.ParallelForBlocks( no_corners, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t c = first; c < last; ++c )
+		{
+			adjacent_corners[counters[vertex_index( c )].fetch_add( 1, std::memory_order_relaxed )] = static_cast<int>( c );
+		}
+	} );
+
+	// --- accumulated tangents of each vertex, separately for both orientations of the texture space ---
+	std::vector<Vector3> tangents( 2 * size_t( no_vertices ) );
+
+	thread_pool.ParallelForBlocks( no_vertices, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t v = first; v < last; ++v )
+		{
+			const auto begin = adjacent_corners.begin() + offsets[v];
+			const auto end = adjacent_corners.begin() + offsets[v + 1];
+
+			// the sums are taken in the order of the triangles, so they do not depend on the scheduling
+			std::sort( begin, end );
+
+			for ( auto corner = begin; corner != end; ++corner )
+			{
+				tangents[2 * v + orientations[*corner / 3]] += corner_tangents[*corner];
+			}
+		}
+	}, block_size );
+
+	// --- tangents of the corners ---
+	thread_pool.ParallelForBlocks( no_triangles, [&]( const size_t first, const size_t last )
+	{
+		for ( size_t t = first; t < last; ++t )
+		{
+			const unsigned int * index = &triangles[t].v0;
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				const Vertex & v = vertices[index[k]];
+				Vertex & face_vertex = face_vertices[3 * t + k];
+
+				// degenerate triangles prefer the positive orientation of their neighbours
+				bool orientation = degenerate[t] ? true : orientations[t] != 0;
+				Vector3 tangent = tangents[2 * size_t( index[k] ) + ( orientation ? 1 : 0 )];
+				if ( degenerate[t] && tangent.SqrL2Norm() == 0.0f )
+				{
+					orientation = false;
+					tangent = tangents[2 * size_t( index[k] )];
+				}
+
+				face_vertex.tangent = ( tangent.Normalize() > 0.0f ) ? tangent : Perpendicular( v.normal );
+				face_vertex.tangent_sign = orientation ? 1.0f : -1.0f;
+			}
+		}
+	}, block_size );
+}
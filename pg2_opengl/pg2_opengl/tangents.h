@@ -0,0 +1,24 @@
+#ifndef TANGENTS_H_
+#define TANGENTS_H_
+
+#include "surface.h"
+
+class ThreadPool;
+
+/*! \fn void GenerateTangents( Surface * surface, std::vector<Vertex> & face_vertices )
+\brief Computes tangents and bitangent signs of all corners of the surface in the way of MikkTSpace.
+
+Each triangle gets its tangent from the texture coordinate derivatives, the tangents are projected onto the plane
+of the vertex normal and averaged with angle weights over the triangles sharing a vertex of the surface and having
+the same orientation in texture space (mirrored texture coordinates get the opposite bitangent sign). Triangles with
+degenerate texture coordinates take the tangent of their neighbours or an arbitrary one perpendicular to the normal.
+The bitangent is reconstructed as tangent_sign * cross( normal, tangent ).
+
+\param surface welded surface, its vertices are only read.
+\param face_vertices vertices of the corners of the surface in the order of its indices (as passed to BuildSurface),
+their tangent and tangent_sign are set, the surface has to be built again from them as vertices may split.
+\param thread_pool pool running the passes over the triangles and vertices in blocks, it may be the pool of the caller's ParallelFor.
+*/
+void GenerateTangents( Surface * surface, std::vector<Vertex> & face_vertices, ThreadPool & thread_pool );
+
+#endif
@@ -1,9 +1,25 @@
 #include "pch.h"
 #include "texture.h"
 #include "mymath.h"
+#include "profiler.h"
 
-Texture::Texture( const char * file_name )
+Texture::Texture( const char * file_name, const bool deferred, const bool single_channel )
 {
+	file_name_ = file_name;
+	single_channel_ = single_channel;
+
+	if ( !deferred )
+	{
+		Load();
+	}
+}
+
+void Texture::Load()
+{
+	PROFILE_ZONE( "Texture::Load" );
+
+	const char * file_name = file_name_.c_str();
+
 	// image format
 	FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
 	// pointer to the image, once loaded
@@ -26,6 +42,15 @@ Texture::Texture( const char * file_name )
 		{
 			dib = FreeImage_Load( fif, file_name );
 		}
+		// single channel maps are converted to 8-bit grey values, 16-bit images keep their precision
+		if ( dib && single_channel_ )
+		{
+			const FREE_IMAGE_TYPE type = FreeImage_GetImageType( dib );
+			FIBITMAP * grey = ( type == FIT_UINT16 || type == FIT_RGB16 || type == FIT_RGBA16 ) ?
+				FreeImage_ConvertToUINT16( dib ) : FreeImage_ConvertToGreyscale( dib );
+			FreeImage_Unload( dib );
+			dib = grey;
+		}
 		// if the image loaded
 		if ( dib )
 		{			
@@ -40,10 +65,21 @@ Texture::Texture( const char * file_name )
 				scan_width_ = FreeImage_GetPitch( dib ); // in bytes
 				pixel_size_ = FreeImage_GetBPP( dib ) / 8; // in bytes				
 
-				data_ = new BYTE[scan_width_ * height_]; // BGR(A) format									
+				data_ = new BYTE[scan_width_ * height_]; // BGR(A) format or grey values									
 				
-				FreeImage_ConvertToRawBits( data_, dib, scan_width_, pixel_size_ * 8,
-					FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, TRUE );
+				if ( FreeImage_GetImageType( dib ) == FIT_BITMAP )
+				{
+					FreeImage_ConvertToRawBits( data_, dib, scan_width_, pixel_size_ * 8,
+						FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, TRUE );
+				}
+				else
+				{
+					// 16-bit grey values, ConvertToRawBits supports only standard bitmaps, rows are flipped the same way
+					for ( int y = 0; y < height_; ++y )
+					{
+						memcpy( data_ + y * scan_width_, FreeImage_GetScanLine( dib, height_ - 1 - y ), scan_width_ );
+					}
+				}
 			}
 
 			FreeImage_Unload( dib );			
@@ -110,6 +146,20 @@ Color3f Texture::texel( const float u, const float v, const bool linearize ) con
 	const float kx = x - x0;
 	const float ky = y - y0;
 
+	if ( single_channel_ )
+	{
+		auto grey = [this]( const BYTE * p )
+		{
+			return ( pixel_size_ == 2 ) ? *reinterpret_cast<const unsigned short *>( p ) / 65535.0f : *p / 255.0f;
+		};
+
+		const float value = grey( p1 ) * ( 1 - kx ) * ( 1 - ky ) + grey( p2 ) * kx * ( 1 - ky ) +
+			grey( p3 ) * ( 1 - kx ) * ky + grey( p4 ) * kx * ky;
+		const Color3f texel = Color3f{ value, value, value };
+
+		return linearize ? texel.linear() : texel;
+	}
+
 	if ( pixel_size_ < 12 )
 	{
 		Color3f texel = ( Color3f::make_from_bgr<BYTE>( p1 ) * ( 1 - kx ) * ( 1 - ky ) +
@@ -167,4 +217,17 @@ BYTE * Texture::data()
 	return this->data_;
 }
 
+int Texture::pixel_size() const
+{
+	return pixel_size_;
+}
+
+bool Texture::single_channel() const
+{
+	return single_channel_;
+}
 
+const std::string & Texture::file_name() const
+{
+	return file_name_;
+}
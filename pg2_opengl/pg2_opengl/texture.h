@@ -14,9 +14,14 @@
 class Texture
 {
 public:
-	Texture( const char * file_name );
+	/* the image is decoded immediately unless deferred, deferred textures are decoded later by Load,
+	single channel textures (opacity, roughness, metallicness) keep only 8-bit or 16-bit grey values */
+	Texture( const char * file_name, const bool deferred = false, const bool single_channel = false );
 	~Texture();
 
+	/* decodes the image file, textures are independent so Load may run on worker threads concurrently */
+	void Load();
+
 	/* returns interpolated texel in linear format */
 	Color3f texel( const float u, const float v, const bool linearize ) const;
 
@@ -25,6 +30,14 @@ public:
 
 	BYTE* data();
 
+	/* size of each pixel in bytes, 1 or 2 for single channel textures */
+	int pixel_size() const;
+
+	bool single_channel() const;
+
+	/* path of the image file the texture was loaded from */
+	const std::string & file_name() const;
+
 	void CopyTo( BYTE * data, const int pixel_size = 3);
 
 private:	
@@ -33,7 +46,10 @@ private:
 	int scan_width_{ 0 }; // size of image row (bytes)
 	int pixel_size_{ 0 }; // size of each pixel (bytes)
 
-	BYTE * data_{ nullptr }; // image data in BGR format
+	BYTE * data_{ nullptr }; // image data in BGR format or grey values of single channel textures
+	bool single_channel_{ false }; // store only 8-bit or 16-bit grey values
+
+	std::string file_name_; // source image file
 
 	Texture( const Texture & ) = delete;
 	Texture & operator=( const Texture & ) = delete;
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "threadpool.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool( const int no_threads )
+{
+	const int n = ( no_threads > 0 ) ? no_threads : std::max( 1, int( std::thread::hardware_concurrency() ) );
+
+	for ( int i = 0; i < n; ++i )
+	{
+		threads_.push_back( std::thread( &ThreadPool::Worker, this ) );
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stop_ = true;
+	}
+	task_queued_.notify_all();
+
+	for ( std::thread & thread : threads_ )
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Enqueue( std::function<void()> task )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		tasks_.push( std::move( task ) );
+		++no_unfinished_tasks_;
+	}
+	task_queued_.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+	tasks_finished_.wait( lock, [this] { return no_unfinished_tasks_ == 0; } );
+}
+
+void ThreadPool::ParallelFor( const int n, const std::function<void( const int )> & body )
+{
+	if ( n <= 0 )
+	{
+		return;
+	}
+
+	struct State
+	{
+		std::atomic<int> next{ 0 }; // next iteration to be taken
+		std::atomic<int> done{ 0 }; // number of finished iterations
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+
+	// helpers that start late see next >= n and return without touching body
+	auto run = [state, n, &body]()
+	{
+		for ( int i = state->next++; i < n; i = state->next++ )
+		{
+			body( i );
+
+			if ( ++state->done == n )
+			{
+				std::lock_guard<std::mutex> lock( state->mutex );
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	const int no_helpers = std::min( n, no_threads() ) - 1;
+	for ( int i = 0; i < no_helpers; ++i )
+	{
+		Enqueue( run );
+	}
+
+	run();
+
+	std::unique_lock<std::mutex> lock( state->mutex );
+	state->finished.wait( lock, [&state, n] { return state->done == n; } );
+}
+
+void ThreadPool::ParallelForBlocks( const size_t n, const std::function<void( const size_t, const size_t )> & body, const size_t block_size )
+{
+	const int no_blocks = static_cast<int>( ( n + block_size - 1 ) / block_size );
+
+	ParallelFor( no_blocks, [&]( const int i )
+	{
+		body( i * block_size, std::min( n, ( i + 1 ) * block_size ) );
+	} );
+}
+
+int ThreadPool::no_threads() const
+{
+	return static_cast<int>( threads_.size() );
+}
+
+void ThreadPool::Worker()
+{
+	Profiler::SetThreadName( "worker" );
+
+	for ( ;; )
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+			task_queued_.wait( lock, [this] { return stop_ || !tasks_.empty(); } );
+
+			if ( tasks_.empty() )
+			{
+				return; // stop_ was requested and there is nothing left to do
+			}
+
+			task = std::move( tasks_.front() );
+			tasks_.pop();
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			--no_unfinished_tasks_;
+		}
+		tasks_finished_.notify_all();
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+
+/*! \class ThreadPool
+\brief Fixed set of worker threads executing queued tasks.
+*/
+class ThreadPool
+{
+public:
+	/* no_threads = 0 creates one worker per hardware thread */
+	ThreadPool( const int no_threads = 0 );
+	~ThreadPool();
+
+	/* queues the task for asynchronous execution */
+	void Enqueue( std::function<void()> task );
+
+	/* blocks until all queued tasks are finished */
+	void Wait();
+
+	/* calls body( i ) for all i in <0, n) in parallel, the calling thread takes part in the work
+	and the call returns once all n iterations are done (other queued tasks are not waited for) */
+	void ParallelFor( const int n, const std::function<void( const int )> & body );
+
+	/* calls body( first, last ) for blocks of block_size items of the range <0, n) in parallel, see ParallelFor */
+	void ParallelForBlocks( const size_t n, const std::function<void( const size_t, const size_t )> & body, const size_t block_size = 1 << 16 );
+
+	int no_threads() const;
+
+private:
+	void Worker();
+
+	std::vector<std::thread> threads_;
+	std::queue<std::function<void()>> tasks_;
+
+	std::mutex mutex_;
+	std::condition_variable task_queued_;
+	std::condition_variable tasks_finished_;
+	int no_unfinished_tasks_{ 0 }; // queued or running tasks
+	bool stop_{ false };
+
+	ThreadPool( const ThreadPool & ) = delete;
+	ThreadPool & operator=( const ThreadPool & ) = delete;
+};
+
+#endif
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "uploadqueue.h"
+#include "texture.h"
+
+/* rows of the textures are 4-byte aligned, it matches FreeImage's pitch and the default GL_UNPACK_ALIGNMENT */
+static size_t RowPitch( const int width, const int pixel_size )
+{
+	return ( size_t( width ) * pixel_size + 3 ) & ~size_t( 3 );
+}
+
+/* 2x2 box filter of one row of the next mip level, the last row and column of odd sized levels are repeated */
+static void DownsampleRow( const GLubyte * src, const int src_width, const int src_height, GLubyte * dst, const int width,
+	const int y, const int pixel_size, const int channel_size )
+{
+	const size_t src_pitch = RowPitch( src_width, pixel_size );
+	const GLubyte * row0 = src + std::min( 2 * y, src_height - 1 ) * src_pitch;
+	const GLubyte * row1 = src + std::min( 2 * y + 1, src_height - 1 ) * src_pitch;
+	const int no_channels = pixel_size / channel_size;
+
+	for ( int x = 0; x < width; ++x )
+	{
+		const int x0 = std::min( 2 * x, src_width - 1 ) * pixel_size;
+		const int x1 = std::min( 2 * x + 1, src_width - 1 ) * pixel_size;
+
+		for ( int c = 0; c < no_channels; ++c )
+		{
+			if ( channel_size == 2 )
+			{
+				auto p = []( const GLubyte * row, const int offset ) { return *reinterpret_cast<const GLushort *>( row + offset ); };
+				const int o = c * 2;
+				reinterpret_cast<GLushort *>( dst + x * pixel_size )[c] = static_cast<GLushort>(
+					( p( row0, x0 + o ) + p( row0, x1 + o ) + p( row1, x0 + o ) + p( row1, x1 + o ) + 2 ) >> 2 );
+			}
+			else
+			{
+				dst[x * pixel_size + c] = static_cast<GLubyte>(
+					( row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2 ) >> 2 );
+			}
+		}
+	}
+}
+
+UploadQueue::~UploadQueue()
+{
+	Release();
+}
+
+void UploadQueue::Init( const size_t staging_size )
+{
+	assert( staging_buffer_ == 0 );
+
+	staging_size_ = staging_size;
+
+	// coherent mapping makes the writes visible to the copy commands issued afterwards without explicit flushes
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers( 1, &staging_buffer_ );
+	glNamedBufferStorage( staging_buffer_, staging_size_, nullptr, flags );
+	staging_data_ = static_cast<GLubyte *>( glMapNamedBufferRange( staging_buffer_, 0, staging_size_, flags ) );
+}
+
+void UploadQueue::Release()
+{
+	buffer_jobs_.clear();
+	texture_jobs_.clear();
+
+	for ( auto & fence : fences_ )
+	{
+		glDeleteSync( fence.first );
+	}
+	fences_.clear();
+
+	if ( staging_buffer_ != 0 )
+	{
+		glUnmapNamedBuffer( staging_buffer_ );
+		glDeleteBuffers( 1, &staging_buffer_ );
+		staging_buffer_ = 0;
+		staging_data_ = nullptr;
+	}
+
+	head_ = used_ = frame_bytes_ = 0;
+}
+
+void UploadQueue::EnqueueBuffer( const GLuint buffer, const size_t offset, const void * data, const size_t size,
+	std::shared_ptr<const void> owner, std::function<void()> on_uploaded )
+{
+	Job job;
+	job.target = buffer;
+	job.data = static_cast<const GLubyte *>( data );
+	job.size = size;
+	job.offset = offset;
+	job.owner = std::move( owner );
+	job.on_uploaded = std::move( on_uploaded );
+
+	buffer_jobs_.push_back( std::move( job ) );
+}
+
+void UploadQueue::RetargetBuffer( const GLuint buffer, const GLuint new_buffer )
+{
+	for ( Job & job : buffer_jobs_ )
+	{
+		if ( job.target == buffer )
+		{
+			job.target = new_buffer;
+		}
+	}
+}
+
+void UploadQueue::EnqueueTexture( const GLuint target, Texture * texture, const GLenum format, const GLenum type,
+	std::function<void()> on_uploaded )
+{
+	assert( texture && texture->data() );
+
+	Job job;
+	job.target = target;
+	job.texture = texture;
+	job.format = format;
+	job.type = type;
+	job.on_uploaded = std::move( on_uploaded );
+
+	texture_jobs_.push_back( std::move( job ) );
+}
+
+void UploadQueue::Process( const double budget_ms )
+{
+	const auto t0 = std::chrono::high_resolution_clock::now();
+
+	RetireFences();
+
+	while ( !empty() &&
+		std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - t0 ).count() < budget_ms )
+	{
+		std::deque<Job> & jobs = buffer_jobs_.empty() ? texture_jobs_ : buffer_jobs_;
+		Job & job = jobs.front();
+
+		if ( !( job.texture ? UploadTextureRows( job ) : UploadBufferChunk( job ) ) )
+		{
+			break; // the staging buffer is full, continue in the next frame
+		}
+
+		const bool finished = job.texture ?
+			job.level == no_levels( job.texture->width(), job.texture->height() ) : job.size == 0;
+
+		if ( finished )
+		{
+			if ( job.on_uploaded )
+			{
+				job.on_uploaded();
+			}
+			jobs.pop_front();
+		}
+	}
+
+	if ( frame_bytes_ > 0 )
+	{
+		fences_.push_back( std::make_pair( glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ), frame_bytes_ ) );
+		frame_bytes_ = 0;
+	}
+}
+
+size_t UploadQueue::staging_size() const
+{
+	return staging_size_;
+}
+
+bool UploadQueue::empty() const
+{
+	return buffer_jobs_.empty() && texture_jobs_.empty();
+}
+
+int UploadQueue::no_levels( const int width, const int height )
+{
+	int no_levels = 1;
+	for ( int size = std::max( width, height ); size > 1; size >>= 1 )
+	{
+		++no_levels;
+	}
+
+	return no_levels;
+}
+
+bool UploadQueue::UploadBufferChunk( Job & job )
+{
+	const size_t size = std::min( job.size, staging_size_ / 4 );
+	size_t offset = 0;
+
+	if ( !Allocate( size, offset ) )
+	{
+		return false;
+	}
+
+	memcpy( staging_data_ + offset, job.data, size );
+	glCopyNamedBufferSubData( staging_buffer_, job.target, offset, job.offset, size );
+
+	job.data += size;
+	job.size -= size;
+	job.offset += size;
+
+	return true;
+}
+
+bool UploadQueue::UploadTextureRows( Job & job )
+{
+	Texture * texture = job.texture;
+	const int pixel_size = texture->pixel_size();
+	const int channel_size = ( job.type == GL_UNSIGNED_SHORT ) ? 2 : 1;
+	const int width = std::max( 1, texture->width() >> job.level );
+	const int height = std::max( 1, texture->height() >> job.level );
+	const size_t pitch = RowPitch( width, pixel_size );
+	assert( pitch <= staging_size_ / 4 );
+
+	const int no_rows = std::min( height - job.row, std::max( 1, int( staging_size_ / 4 / pitch ) ) );
+	size_t offset = 0;
+
+	if ( !Allocate( no_rows * pitch, offset ) )
+	{
+		return false;
+	}
+
+	if ( job.level == 0 )
+	{
+		memcpy( staging_data_ + offset, texture->data() + job.row * pitch, no_rows * pitch );
+	}
+	else
+	{
+		// the first level is filtered straight from the image, the next ones from the previous level
+		const GLubyte * src = ( job.level == 1 ) ? texture->data() : job.source_level.data();
+		const int src_width = std::max( 1, texture->width() >> ( job.level - 1 ) );
+		const int src_height = std::max( 1, texture->height() >> ( job.level - 1 ) );
+
+		job.current_level.resize( pitch * height );
+		for ( int y = job.row; y < job.row + no_rows; ++y )
+		{
+			DownsampleRow( src, src_width, src_height, &job.current_level[y * pitch], width, y, pixel_size, channel_size );
+		}
+		memcpy( staging_data_ + offset, &job.current_level[job.row * pitch], no_rows * pitch );
+	}
+
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, staging_buffer_ );
+	glTextureSubImage2D( job.target, job.level, 0, job.row, width, no_rows, job.format, job.type,
+		reinterpret_cast<const void *>( offset ) );
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	job.row += no_rows;
+	if ( job.row == height )
+	{
+		if ( job.level > 0 )
+		{
+			job.source_level.swap( job.current_level );
+		}
+		++job.level;
+		job.row = 0;
+	}
+
+	return true;
+}
+
+bool UploadQueue::Allocate( const size_t size, size_t & offset )
+{
+	assert( size <= staging_size_ );
+
+	// 16-byte alignment satisfies both the buffer copies and the pixel transfers of all used types
+	size_t padding = ( 16 - head_ % 16 ) % 16;
+	if ( head_ + padding + size > staging_size_ )
+	{
+		padding = staging_size_ - head_; // wrap around, the rest of the ring stays unused this round
+	}
+
+	if ( used_ + padding + size > staging_size_ )
+	{
+		RetireFences();
+
+		if ( used_ + padding + size > staging_size_ )
+		{
+			return false;
+		}
+	}
+
+	offset = ( head_ + padding ) % staging_size_;
+	head_ = offset + size;
+	used_ += padding + size;
+	frame_bytes_ += padding + size;
+
+	return true;
+}
+
+void UploadQueue::RetireFences()
+{
+	while ( !fences_.empty() )
+	{
+		const GLenum status = glClientWaitSync( fences_.front().first, 0, 0 );
+
+		if ( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+		{
+			break;
+		}
+
+		glDeleteSync( fences_.front().first );
+		used_ -= fences_.front().second;
+		fences_.pop_front();
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef UPLOAD_QUEUE_H_
+#define UPLOAD_QUEUE_H_
+
+#include <deque>
+#include <memory>
+
+class Texture;
+
+/*! \class UploadQueue
+\brief Streams buffer ranges and texture levels to the GPU through a persistently mapped staging buffer.
+
+Data are copied in chunks into a ring buffer and transferred by glCopyNamedBufferSubData or glTextureSubImage2D
+from the pixel unpack buffer. Process spends at most the given time per frame, parts of the ring are reused once
+the fence issued at the end of the frame which filled them is signaled. Mip levels of the textures are built on
+the CPU row by row from the previous level so that no glGenerateMipmap stalls the render thread.
+Buffer ranges take precedence over textures.
+*/
+class UploadQueue
+{
+public:
+	UploadQueue() { }
+	~UploadQueue();
+
+	/* creates and maps the staging buffer, needs the current GL context */
+	void Init( const size_t staging_size = 32 << 20 );
+
+	/* drops pending jobs and deletes the staging buffer */
+	void Release();
+
+	/* copies size bytes of data to the buffer at the given offset, owner keeps the data alive until the copy is issued,
+	on_uploaded is called (on the render thread) once all commands of the job were issued */
+	void EnqueueBuffer( const GLuint buffer, const size_t offset, const void * data, const size_t size,
+		std::shared_ptr<const void> owner, std::function<void()> on_uploaded = nullptr );
+
+	/* uploads all levels of the texture created with no_levels( width, height ) levels of immutable storage,
+	the texture must stay alive until on_uploaded is called */
+	void EnqueueTexture( const GLuint target, Texture * texture, const GLenum format, const GLenum type,
+		std::function<void()> on_uploaded = nullptr );
+
+	/* redirects the pending copies to the buffer to another one, e.g. to the larger buffer replacing it */
+	void RetargetBuffer( const GLuint buffer, const GLuint new_buffer );
+
+	/* issues uploads until the queue is empty, the staging buffer is full or budget_ms elapsed */
+	void Process( const double budget_ms );
+
+	/* no pending jobs */
+	bool empty() const;
+
+	/* size of the staging buffer (bytes) */
+	size_t staging_size() const;
+
+	/* number of mip levels of the full chain */
+	static int no_levels( const int width, const int height );
+
+private:
+	struct Job
+	{
+		GLuint target{ 0 }; // destination buffer or texture
+		std::function<void()> on_uploaded;
+
+		// buffer range
+		const GLubyte * data{ nullptr }; // rest of the data to be copied
+		size_t size{ 0 };
+		size_t offset{ 0 }; // byte offset in the destination buffer
+		std::shared_ptr<const void> owner;
+
+		// texture
+		Texture * texture{ nullptr };
+		GLenum format{ GL_BGR };
+		GLenum type{ GL_UNSIGNED_BYTE };
+		int level{ 0 }; // level being uploaded
+		int row{ 0 }; // first row of the level not uploaded yet
+		std::vector<GLubyte> source_level; // previous level the current one is filtered from (level > 1)
+		std::vector<GLubyte> current_level;
+	};
+
+	/* returns false if the staging buffer has no room for the chunk */
+	bool UploadBufferChunk( Job & job );
+	bool UploadTextureRows( Job & job );
+
+	/* reserves size bytes of the staging buffer, false if they are still used by the GPU */
+	bool Allocate( const size_t size, size_t & offset );
+
+	/* releases parts of the staging buffer which were already consumed by the GPU */
+	void RetireFences();
+
+	GLuint staging_buffer_{ 0 };
+	GLubyte * staging_data_{ nullptr }; // persistently mapped
+	size_t staging_size_{ 0 };
+	size_t head_{ 0 }; // next free byte
+	size_t used_{ 0 }; // bytes waiting for the GPU (including the padding at the end of the ring)
+	size_t frame_bytes_{ 0 }; // bytes allocated since the last fence
+	std::deque<std::pair<GLsync, size_t>> fences_; // fence and the number of bytes it guards
+
+	std::deque<Job> buffer_jobs_; // served first so that the geometry shows up before the textures
+	std::deque<Job> texture_jobs_;
+
+	UploadQueue( const UploadQueue & ) = delete;
+	UploadQueue & operator=( const UploadQueue & ) = delete;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "vertex.h"
+#include "mymath.h"
 
 Vertex::Vertex( const Vector3 position, const Vector3 normal, Vector3 color,Coord2f * texture_coords )
 {
@@ -13,24 +14,48 @@ Vertex::Vertex( const Vector3 position, const Vector3 normal, Vector3 color,Coor
 		{
 			this->texture_coords[i] = texture_coords[i];
 		}
-	}	
-}
-
-MyVertex::MyVertex(Vertex v, int material_index,Color3f amb,Color3f spec)
-{
-	this->position = v.position;
-	this->color = v.color;
-	this->normal = v.normal;
-	if (v.texture_coords != NULL)
+	}
+	else
 	{
-		for (int i = 0; i < NO_TEXTURE_COORDS; ++i)
+		// defined values are needed for welding of identical vertices in BuildSurface
+		for ( int i = 0; i < NO_TEXTURE_COORDS; ++i )
 		{
-			this->texture_coords[i] = v.texture_coords[i];
+			this->texture_coords[i] = Coord2f{ 0.0f, 0.0f };
 		}
 	}
+}
+
+const VertexAttribute gl_vertex_format[NO_GL_VERTEX_ATTRIBUTES] =
+{
+	{ 0, 3, GL_FLOAT, GL_FALSE, false, offsetof( GLVertex, position ) }, // in_position
+	{ 1, 2, GL_SHORT, GL_TRUE, false, offsetof( GLVertex, normal ) }, // in_normal, decoded in the shader
+	{ 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, false, offsetof( GLVertex, color ) }, // in_color, alpha holds the bitangent sign
+	{ 3, 2, GL_HALF_FLOAT, GL_FALSE, false, offsetof( GLVertex, texture_coords ) }, // in_texcoord
+	{ 4, 2, GL_SHORT, GL_TRUE, false, offsetof( GLVertex, tangent ) }, // in_tangent, decoded in the shader
+	{ 5, 1, GL_UNSIGNED_SHORT, GL_FALSE, true, offsetof( GLVertex, material_index ) } // in_material_index
+};
+
+GLVertex::GLVertex( const Vertex & v, const int material_index )
+{
+	position = v.position;
+
+	const Coord2f n = OctahedralEncode( v.normal );
+	normal[0] = static_cast<GLshort>( roundf( clamp( n.u, -1.0f, 1.0f ) * 32767.0f ) );
+	normal[1] = static_cast<GLshort>( roundf( clamp( n.v, -1.0f, 1.0f ) * 32767.0f ) );
+
+	// surfaces without generated tangents keep zero tangents
+	const Coord2f t = OctahedralEncode( ( v.tangent.SqrL2Norm() > 0.0f ) ? v.tangent : Vector3( 1.0f, 0.0f, 0.0f ) );
+	tangent[0] = static_cast<GLshort>( roundf( clamp( t.u, -1.0f, 1.0f ) * 32767.0f ) );
+	tangent[1] = static_cast<GLshort>( roundf( clamp( t.v, -1.0f, 1.0f ) * 32767.0f ) );
+
+	color[0] = static_cast<GLubyte>( roundf( clamp( v.color.x, 0.0f, 1.0f ) * 255.0f ) );
+	color[1] = static_cast<GLubyte>( roundf( clamp( v.color.y, 0.0f, 1.0f ) * 255.0f ) );
+	color[2] = static_cast<GLubyte>( roundf( clamp( v.color.z, 0.0f, 1.0f ) * 255.0f ) );
+	color[3] = ( v.tangent_sign < 0.0f ) ? 0 : 255;
 
-	this->material_index = material_index;
-	this->ambient = Vector3(amb.r,amb.g,amb.b);
-	this->specular = Vector3(spec.r, spec.g, spec.b);
+	texture_coords[0] = FloatToHalf( v.texture_coords[0].u );
+	texture_coords[1] = FloatToHalf( v.texture_coords[0].v );
 
+	assert( ( material_index >= 0 ) && ( material_index <= 0xffff ) );
+	this->material_index = static_cast<GLushort>( material_index );
 }
@@ -26,7 +26,8 @@ public:
 	Vector3 color; /*!< RGB barva vertexu <0, 1>^3. */
 	Coord2f texture_coords[NO_TEXTURE_COORDS]; /*!< Texturovac souadnice. */
 	Vector3 tangent; /*!< Prvn osa souadnho systmu tangenta-bitangenta-normla. */
-	char pad[8]; // doplnn na 64 byt, mlo by to mt alespo 4 byty, aby se sem veel 32-bitov ukazatel
+	float tangent_sign{ 1.0f }; /*!< Bitangent is tangent_sign * cross( normal, tangent ), see GenerateTangents. */
+	alignas( 8 ) char pad[8]; // room for the pointer to the surface stored by Triangle, aligned for a 64-bit pointer (the vertex takes 72 B)
 
 	//! Vchoz konstruktor.
 	/*!
@@ -48,19 +49,44 @@ public:
 	//void Print();
 };
 
-struct /*ALIGN*/ MyVertex
+/*! \struct VertexAttribute
+\brief Description of a single vertex attribute for glVertexAttribPointer or glVertexAttribIPointer.
+*/
+struct VertexAttribute
 {
-public:
-	Vector3 position; /*!< Pozice vertexu. */
-	Vector3 normal; /*!< Normla vertexu. */
-	Vector3 color; /*!< RGB barva vertexu <0, 1>^3. */
-	Coord2f texture_coords[NO_TEXTURE_COORDS]; /*!< Texturovac souadnice. */
-	Vector3 ambient;
-	Vector3 specular;
-	int material_index{0};
+	GLuint location; /*!< Attribute location in the vertex shader. */
+	GLint size; /*!< Number of components. */
+	GLenum type; /*!< Type of components. */
+	GLboolean normalized; /*!< Fixed point components are mapped to <0, 1> or <-1, 1>. */
+	bool integer; /*!< The attribute is read as an integer (glVertexAttribIPointer). */
+	size_t offset; /*!< Offset of the first component from the beginning of the vertex. */
+};
 
+/*! \def NO_GL_VERTEX_ATTRIBUTES
+\brief Number of attributes of GLVertex.
+*/
+#define NO_GL_VERTEX_ATTRIBUTES 6
+
+/*! \struct GLVertex
+\brief Packed vertex uploaded to the GPU (32 bytes), the layout is described by gl_vertex_format.
 
-	MyVertex(Vertex v,int material_index,Color3f amb,Color3f spec);
+Material colors are read from the SSBO of materials using the material index.
+*/
+struct GLVertex
+{
+public:
+	Vector3 position; /*!< Position, 3 * 4 B. */
+	GLshort normal[2]; /*!< Octahedral encoded unit normal, snorm 2 * 2 B. */
+	GLshort tangent[2]; /*!< Octahedral encoded unit tangent, snorm 2 * 2 B. */
+	GLubyte color[4]; /*!< RGB color of the vertex and the bitangent sign (0 for -1, 255 for +1), unorm 4 * 1 B. */
+	GLushort texture_coords[2]; /*!< Texture coordinates, half float 2 * 2 B. */
+	GLushort material_index{ 0 }; /*!< Index into the SSBO of materials. */
+	GLushort pad{ 0 }; /*!< Padding to a multiple of 4 B. */
+
+	GLVertex() { }
+	GLVertex( const Vertex & v, const int material_index );
 };
 
+extern const VertexAttribute gl_vertex_format[NO_GL_VERTEX_ATTRIBUTES]; /*!< Attributes of GLVertex, see basic_shader.vert. */
+
 #endif